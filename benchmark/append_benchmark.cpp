@@ -0,0 +1,69 @@
+// Insert rate and memory of ascending keys (auto-increment ids), of
+// timestamps that arrive slightly out of order, and of random keys, next to
+// BulkLoad and a plain std::vector append as the floor for the same entries.
+// Ascending inserts take the append fast path: no descent, and splits of the
+// last leaf and of internal nodes on the right edge leave the old node
+// (nearly) full.
+//
+// usage: append_benchmark [keys]   (default: 16M keys)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+
+static void report(const char *name, size_t num_keys, double seconds, size_t bytes, double fill) {
+  std::printf("%-12s %14.0f %12.2f %10.2f\n", name, num_keys / seconds, static_cast<double>(bytes) / num_keys, fill);
+}
+
+static void runInserts(const char *name, const std::vector<int> &keys) {
+  Tree tree;
+  auto start = Clock::now();
+  for (size_t i = 0; i < keys.size(); i++) tree.Insert(keys[i], RecordPointer(static_cast<int>(i / 64), 0));
+  double seconds = secondsSince(start);
+  report(name, keys.size(), seconds, tree.GetAllocatorStats().bytes_live, tree.GetShape().AverageLeafFill());
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 24;
+
+  std::printf("%-12s %14s %12s %10s\n", "input", "inserts/s", "bytes/entry", "leaf fill");
+
+  std::vector<std::pair<int, RecordPointer>> entries;
+  entries.reserve(num_keys);
+  auto start = Clock::now();
+  for (size_t i = 0; i < num_keys; i++) entries.emplace_back(static_cast<int>(i), RecordPointer(static_cast<int>(i / 64), 0));
+  report("vector", num_keys, secondsSince(start), entries.capacity() * sizeof(entries[0]), 1.0);
+
+  {
+    Tree tree;
+    start = Clock::now();
+    tree.BulkLoad(entries);
+    report("bulk load", num_keys, secondsSince(start), tree.GetAllocatorStats().bytes_live,
+           tree.GetShape().AverageLeafFill());
+  }
+  entries = {};
+
+  std::vector<int> keys(num_keys);
+  for (size_t i = 0; i < num_keys; i++) keys[i] = static_cast<int>(i);
+  runInserts("ascending", keys);
+
+  // timestamps: ascending, but one in eight is up to 64 behind the newest
+  std::mt19937_64 rng(3);
+  for (size_t i = 0; i < num_keys; i++) {
+    keys[i] = static_cast<int>(2 * i);
+    if (rng() % 8 == 0 && i >= 64) keys[i] -= 2 * static_cast<int>(rng() % 64) + 1;
+  }
+  runInserts("jittered", keys);
+
+  for (size_t i = 0; i < num_keys; i++) keys[i] = static_cast<int>(i);
+  std::shuffle(keys.begin(), keys.end(), rng);
+  runInserts("random", keys);
+  return 0;
+}
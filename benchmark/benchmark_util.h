@@ -0,0 +1,10 @@
+// Timing shared by the programs in benchmark/
+#pragma once
+
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+inline double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
@@ -0,0 +1,59 @@
+// Random-order ingest into a plain BPlusTree (one Insert per key) against
+// BufferedBPlusTree with buffers of several sizes, followed by point lookups
+// while the buffer still holds messages. The buffered ingest time includes
+// the final Flush.
+//
+// usage: buffered_benchmark [keys]   (default: 8M keys)
+#include "include/buffered_b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+constexpr size_t kLookups = 1 << 21;
+
+template <typename Index>
+static double lookupRate(Index &index, const std::vector<int> &keys) {
+  std::mt19937_64 rng(29);
+  RecordPointer value;
+  size_t hits = 0;
+  auto start = Clock::now();
+  for (size_t i = 0; i < kLookups; i++) hits += index.GetValue(keys[rng() % keys.size()], value);
+  double rate = kLookups / secondsSince(start);
+  if (hits != kLookups) std::printf("lost keys!\n");
+  return rate;
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 23;
+  std::mt19937_64 rng(3);
+  std::vector<int> keys(num_keys);
+  for (size_t i = 0; i < num_keys; i++) keys[i] = static_cast<int>(i);
+  std::shuffle(keys.begin(), keys.end(), rng);
+
+  std::printf("%-16s %14s %14s %10s\n", "index", "inserts/s", "lookups/s", "leaf hits");
+  {
+    BPlusTree<int, RecordPointer> tree;
+    auto start = Clock::now();
+    for (int key : keys) tree.Insert(key, RecordPointer(key, 0));
+    double insert_rate = num_keys / secondsSince(start);
+    std::printf("%-16s %14.0f %14.0f\n", "plain", insert_rate, lookupRate(tree, keys));
+  }
+  for (size_t buffer_entries : {1 << 14, 1 << 16, 1 << 18}) {
+    BufferedBPlusTree<int, RecordPointer> tree(buffer_entries);
+    auto start = Clock::now();
+    for (int key : keys) tree.Insert(key, RecordPointer(key, 0));
+    double seconds = secondsSince(start);
+    double lookup_rate = lookupRate(tree, keys);
+    start = Clock::now();
+    tree.Flush();
+    seconds += secondsSince(start);
+    char name[32];
+    std::snprintf(name, sizeof(name), "buffered %zuK", buffer_entries >> 10);
+    std::printf("%-16s %14.0f %14.0f %10.3f\n", name, num_keys / seconds, lookup_rate, tree.FlushStats().HitRate());
+  }
+  return 0;
+}
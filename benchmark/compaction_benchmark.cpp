@@ -0,0 +1,88 @@
+// Online compaction after a delete-heavy phase. Loads keys in random order,
+// removes most of them at random, then runs Compact in bounded slices with a
+// batch of foreground lookups between slices, as if both shared one core.
+// Prints the tree shape (height, nodes, leaf fill histogram), lookup and scan
+// rates and bytes per entry before and after, and the slice latencies.
+//
+// usage: compaction_benchmark [keys] [removed fraction] [leaves per slice]
+//        (default: 2M keys, 0.75, 64)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+
+static double lookupRate(Tree &tree, const std::vector<int> &keys, std::mt19937_64 &rng) {
+  const size_t num_lookups = 1 << 20;
+  RecordPointer value;
+  size_t hits = 0;
+  auto start = Clock::now();
+  for (size_t i = 0; i < num_lookups; i++) hits += tree.GetValue(keys[rng() % keys.size()], value);
+  double rate = num_lookups / secondsSince(start);
+  if (hits != num_lookups) std::printf("lost keys!\n");
+  return rate;
+}
+
+static double scanRate(Tree &tree) {
+  size_t scanned = 0;
+  auto start = Clock::now();
+  tree.ForEach(0, std::numeric_limits<int>::max(), [&](const int &, const RecordPointer &) {
+    scanned++;
+    return true;
+  });
+  return scanned / secondsSince(start);
+}
+
+static void report(const char *phase, Tree &tree, const std::vector<int> &keys, std::mt19937_64 &rng) {
+  NodeAllocatorStats stats = tree.GetAllocatorStats();
+  std::printf("%-8s lookups/s %.0f  scanned/s %.0f  bytes/entry %.2f\n", phase, lookupRate(tree, keys, rng),
+              scanRate(tree), static_cast<double>(stats.bytes_live) / tree.size);
+  std::printf("%-8s shape %s\n", phase, tree.GetShape().ToJson().c_str());
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 21;
+  double removed = argc > 2 ? std::atof(argv[2]) : 0.75;
+  size_t budget = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+
+  std::mt19937_64 rng(42);
+  std::vector<int> keys(num_keys);
+  for (size_t i = 0; i < num_keys; i++) keys[i] = static_cast<int>(i);
+  std::shuffle(keys.begin(), keys.end(), rng);
+  Tree tree;
+  for (int key : keys) tree.Insert(key, RecordPointer(key / 64, key % 64));
+  report("loaded", tree, keys, rng);
+
+  size_t num_removed = static_cast<size_t>(removed * num_keys);
+  std::shuffle(keys.begin(), keys.end(), rng);
+  for (size_t i = 0; i < num_removed; i++) tree.Remove(keys[i]);
+  keys.erase(keys.begin(), keys.begin() + num_removed);
+  report("purged", tree, keys, rng);
+
+  // slices alternate with foreground lookups until one pass is complete
+  std::vector<double> slice_us;
+  size_t freed = 0;
+  RecordPointer value;
+  auto start = Clock::now();
+  while (true) {
+    auto slice_start = Clock::now();
+    CompactResult result = tree.Compact(budget);
+    slice_us.push_back(secondsSince(slice_start) * 1e6);
+    freed += result.leaves_freed;
+    if (result.done) break;
+    for (int i = 0; i < 1000; i++) tree.GetValue(keys[rng() % keys.size()], value);
+  }
+  double total = secondsSince(start);
+  std::sort(slice_us.begin(), slice_us.end());
+  std::printf("compact  %zu slices of %zu leaves in %.3f s, %zu leaves freed, slice p50 %.1f us p99 %.1f us max %.1f us\n",
+              slice_us.size(), budget, total, freed, slice_us[slice_us.size() / 2],
+              slice_us[slice_us.size() * 99 / 100], slice_us.back());
+  report("compacted", tree, keys, rng);
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Throughput of the thread-safe mode against a tree behind one global mutex,
+// for several thread counts and read/write mixes over uniform random keys.
+//
+// usage: concurrency_benchmark [keys] [ops per thread]   (default: 1M keys, 1M ops)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+
+// every other key is preloaded, writes insert and remove the odd keys
+static void preload(Tree &tree, size_t num_keys) {
+  std::vector<std::pair<int, RecordPointer>> entries;
+  entries.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    entries.emplace_back(static_cast<int>(i * 2), RecordPointer(static_cast<int>(i), 0));
+  }
+  tree.BulkLoad(entries, 0.7);
+}
+
+template <typename Lock>
+static void worker(Tree &tree, Lock &lock, size_t num_keys, size_t ops, int read_percent, unsigned seed) {
+  std::mt19937_64 rng(seed);
+  RecordPointer value;
+  for (size_t i = 0; i < ops; i++) {
+    int key = static_cast<int>(rng() % (num_keys * 2));
+    int dice = static_cast<int>(rng() % 100);
+    std::lock_guard<Lock> guard(lock);
+    if (dice < read_percent) {
+      tree.GetValue(key, value);
+      continue;
+    }
+    // look first so the tree does not log duplicate or missing keys
+    bool present = tree.GetValue(key | 1, value);
+    if (dice % 2 == 0 && !present) {
+      tree.Insert(key | 1, RecordPointer(key, 0));
+    } else if (dice % 2 == 1 && present) {
+      tree.Remove(key | 1);
+    }
+  }
+}
+
+// lock used when the tree does its own latching
+struct NoLock {
+  void lock() {}
+  void unlock() {}
+};
+
+template <typename Lock>
+static double run(bool thread_safe, int threads, int read_percent, size_t num_keys, size_t ops) {
+  Tree tree;
+  preload(tree, num_keys);
+  tree.SetThreadSafe(thread_safe);
+  Lock lock;
+  std::vector<std::thread> workers;
+  auto start = Clock::now();
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] { worker(tree, lock, num_keys, ops, read_percent, 1234 + t); });
+  }
+  for (auto &w : workers) w.join();
+  return threads * ops / secondsSince(start) / 1e6;
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 20;
+  size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1 << 20;
+  int max_threads = static_cast<int>(std::thread::hardware_concurrency());
+  if (max_threads < 1) max_threads = 1;
+
+  std::printf("%7s %6s %14s %14s %8s\n", "threads", "reads", "mutex Mops/s", "OLC Mops/s", "speedup");
+  for (int read_percent : {100, 95, 50}) {
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      double mutex_rate = run<std::mutex>(false, threads, read_percent, num_keys, ops);
+      double olc_rate = run<NoLock>(true, threads, read_percent, num_keys, ops);
+      std::printf("%7d %5d%% %14.2f %14.2f %7.2fx\n", threads, read_percent, mutex_rate, olc_rate,
+                  olc_rate / mutex_rate);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,46 @@
+// Builds a file-backed index that is larger than its buffer pool, then runs
+// random lookups with several pool sizes and reports the buffer pool traffic.
+//
+// usage: disk_benchmark [index file] [keys]   (default: /tmp/disk_benchmark.db, 4M keys)
+#include "include/disk_b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using Tree = DiskBPlusTree<int, RecordPointer>;
+
+// distinct keys in random order: odd multipliers permute the 31-bit range
+static int keyAt(size_t i) { return static_cast<int>((i * 2654435761ULL) & 0x7fffffff); }
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "/tmp/disk_benchmark.db";
+  size_t num_keys = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1 << 22;
+  const size_t num_lookups = 1 << 20;
+  std::remove(path);
+
+  auto start = Clock::now();
+  {
+    Tree tree(path, 1024);
+    if (!tree.IsOpen()) return 1;
+    for (size_t i = 0; i < num_keys; i++) tree.Insert(keyAt(i), RecordPointer(static_cast<int>(i), 0));
+  }
+  std::printf("built %zu keys in %.2fs\n", num_keys, secondsSince(start));
+
+  std::printf("%10s %12s %10s %10s %10s\n", "pool MiB", "lookups/s", "hit %", "swizzled %", "misses");
+  for (size_t pool_pages : {256, 4096, 65536}) {
+    Tree tree(path, pool_pages);
+    std::mt19937_64 rng(7);
+    RecordPointer value;
+    start = Clock::now();
+    for (size_t i = 0; i < num_lookups; i++) tree.GetValue(keyAt(rng() % num_keys), value);
+    double secs = secondsSince(start);
+    BufferPoolStats stats = tree.GetBufferPoolStats();
+    double fetches = static_cast<double>(stats.hits + stats.swizzled_hits + stats.misses);
+    std::printf("%10.1f %12.0f %10.1f %10.1f %10zu\n", pool_pages * kPageSize / 1048576.0, num_lookups / secs,
+                100.0 * (stats.hits + stats.swizzled_hits) / fetches, 100.0 * stats.swizzled_hits / fetches,
+                stats.misses);
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Point lookups and read-modify-write cycles (Remove, then Insert of the
+// same key) through a Finger against the plain tree calls, for key streams
+// with decreasing locality: a sequential sweep, a random walk that moves a
+// few keys at a time, a walk that jumps to a random key now and then, and
+// uniform random keys. Prints both rates and the finger's hit rate.
+//
+// usage: finger_benchmark [keys]   (default: 4M keys)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+
+constexpr size_t kProbes = 1 << 21;
+
+// probe stream over [0, num_keys): a walk of steps up to max_step, which
+// jumps to a random key with probability jump; max_step 0 is uniform and
+// max_step -1 an ascending sweep
+static std::vector<int> makeProbes(size_t num_keys, int max_step, double jump) {
+  std::mt19937_64 rng(9);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<int> probes(kProbes);
+  long pos = 0;
+  for (int &probe : probes) {
+    if (max_step < 0) {
+      pos = (pos + 1) % static_cast<long>(num_keys);
+    } else if (max_step == 0 || unit(rng) < jump) {
+      pos = static_cast<long>(rng() % num_keys);
+    } else {
+      pos += static_cast<long>(rng() % (2 * max_step + 1)) - max_step;
+      pos = (pos % static_cast<long>(num_keys) + num_keys) % num_keys;
+    }
+    probe = static_cast<int>(pos);
+  }
+  return probes;
+}
+
+static void run(const char *name, Tree &tree, const std::vector<int> &probes) {
+  RecordPointer value;
+  size_t hits = 0;
+  auto start = Clock::now();
+  for (int probe : probes) hits += tree.GetValue(probe, value);
+  double tree_gets = probes.size() / secondsSince(start);
+
+  Tree::Finger finger = tree.MakeFinger();
+  start = Clock::now();
+  for (int probe : probes) hits -= finger.GetValue(probe, value);
+  double finger_gets = probes.size() / secondsSince(start);
+  double get_hit_rate = finger.Stats().HitRate();
+
+  start = Clock::now();
+  for (int probe : probes) {
+    tree.Remove(probe, &value);
+    tree.Insert(probe, value);
+  }
+  double tree_updates = probes.size() / secondsSince(start);
+
+  finger.ResetStats();
+  start = Clock::now();
+  for (int probe : probes) {
+    finger.Remove(probe, &value);
+    finger.Insert(probe, value);
+  }
+  double finger_updates = probes.size() / secondsSince(start);
+
+  std::printf("%-10s %12.0f %12.0f %8.3f %12.0f %12.0f %8.3f %s\n", name, tree_gets, finger_gets, get_hit_rate,
+              tree_updates, finger_updates, finger.Stats().HitRate(), hits == 0 ? "" : "(mismatch!)");
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 22;
+
+  std::vector<std::pair<int, RecordPointer>> entries;
+  entries.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; i++) entries.emplace_back(static_cast<int>(i), RecordPointer(static_cast<int>(i), 0));
+  Tree tree;
+  tree.BulkLoad(entries, 0.7);
+  entries = {};
+
+  std::printf("%-10s %12s %12s %8s %12s %12s %8s\n", "keys", "gets/s", "finger", "hit", "updates/s", "finger",
+              "hit");
+  run("sweep", tree, makeProbes(num_keys, -1, 0.0));
+  run("walk", tree, makeProbes(num_keys, 16, 0.0));
+  run("jumps", tree, makeProbes(num_keys, 16, 0.01));
+  run("uniform", tree, makeProbes(num_keys, 0, 0.0));
+  return 0;
+}
@@ -0,0 +1,82 @@
+// Point lookups, batched lookups and short range scans of the mutable tree
+// against its frozen snapshot (BPlusTree::Freeze), at several sizes. The
+// mutable tree is bulk loaded full, so both hold the same keys in about the
+// same leaf space and differ in how the levels above are laid out.
+//
+// usage: frozen_benchmark [keys ...]   (default: 64K 1M 8M keys)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+using Frozen = FrozenBPlusTree<int, RecordPointer>;
+
+constexpr size_t kLookups = 1 << 21;
+constexpr size_t kScans = 1 << 16;
+constexpr int kScanLength = 100;
+
+// keys are the even numbers, so half of the probes miss
+template <typename Index>
+static void run(const char *name, Index &index, size_t num_keys, size_t bytes) {
+  std::mt19937_64 rng(7);
+  std::vector<int> probes(kLookups);
+  for (int &probe : probes) probe = static_cast<int>(rng() % (2 * num_keys));
+
+  RecordPointer value;
+  size_t hits = 0;
+  auto start = Clock::now();
+  for (int probe : probes) hits += index.GetValue(probe, value);
+  double get_rate = kLookups / secondsSince(start);
+
+  std::vector<RecordPointer> results(kLookups);
+  std::vector<bool> found;
+  start = Clock::now();
+  size_t batch_hits = index.MultiGet(probes, results, found);
+  double multiget_rate = kLookups / secondsSince(start);
+
+  std::vector<RecordPointer> out;
+  size_t scanned = 0;
+  start = Clock::now();
+  for (size_t i = 0; i < kScans; i++) {
+    out.clear();
+    index.RangeScan(probes[i], probes[i] + 2 * kScanLength, out);
+    scanned += out.size();
+  }
+  double scan_rate = kScans / secondsSince(start);
+
+  std::printf("%-8s %10zu %12.2f %12.0f %12.0f %12.0f %s\n", name, num_keys, static_cast<double>(bytes) / num_keys,
+              get_rate, multiget_rate, scan_rate, hits == batch_hits && scanned > 0 ? "" : "(mismatch!)");
+}
+
+int main(int argc, char **argv) {
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; i++) sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+  if (sizes.empty()) sizes = {1 << 16, 1 << 20, 1 << 23};
+
+  std::printf("%-8s %10s %12s %12s %12s %12s\n", "index", "keys", "bytes/entry", "gets/s", "multiget/s",
+              "scans/s");
+  for (size_t num_keys : sizes) {
+    std::vector<std::pair<int, RecordPointer>> entries;
+    entries.reserve(num_keys);
+    for (size_t i = 0; i < num_keys; i++) {
+      entries.emplace_back(static_cast<int>(2 * i), RecordPointer(static_cast<int>(i / 64), static_cast<int>(i % 64)));
+    }
+    Tree tree;
+    tree.BulkLoad(entries);
+    entries = {};
+    run("mutable", tree, num_keys, tree.GetAllocatorStats().bytes_live);
+
+    auto start = Clock::now();
+    Frozen frozen = tree.Freeze();
+    double freeze_seconds = secondsSince(start);
+    tree.Clear();
+    run("frozen", frozen, num_keys, frozen.MemoryBytes());
+    std::printf("%-8s %10zu froze in %.3f s, height %d\n", "", num_keys, freeze_seconds, frozen.Height());
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Insert/delete churn with eager and lazy deletes (SetLazyDeletes). The tree
+// starts with random keys; every round removes a burst of random live keys
+// and then inserts as many new ones, so the leaves the deletes thin out are
+// refilled right after. Prints the churn rate, the leaf count and fill after
+// the churn, and for lazy deletes the Compact pass that packs the leaves
+// again.
+//
+// usage: lazy_delete_benchmark [keys] [rounds] [burst fraction]
+//        (default: 2M keys, 8 rounds, 0.25)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+
+static void report(const char *phase, Tree &tree) {
+  TreeShape shape = tree.GetShape();
+  std::printf("%-8s leaves %zu  leaf fill %.3f  bytes/entry %.2f\n", phase, shape.leaf_nodes, shape.AverageLeafFill(),
+              static_cast<double>(tree.GetAllocatorStats().bytes_live) / shape.entries);
+}
+
+static void run(bool lazy, size_t num_keys, int rounds, double burst) {
+  std::mt19937_64 rng(23);
+  Tree tree;
+  tree.SetLazyDeletes(lazy);
+  // live keys, in no particular order
+  std::vector<int> live;
+  live.reserve(num_keys);
+  while (live.size() < num_keys) {
+    int key = static_cast<int>(rng() >> 33);
+    if (tree.Insert(key, RecordPointer(key, 0))) live.push_back(key);
+  }
+
+  size_t burst_keys = static_cast<size_t>(burst * num_keys);
+  size_t ops = 0;
+  auto start = Clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (size_t i = 0; i < burst_keys; i++) {
+      size_t victim = rng() % live.size();
+      tree.Remove(live[victim]);
+      live[victim] = live.back();
+      live.pop_back();
+    }
+    while (live.size() < num_keys) {
+      int key = static_cast<int>(rng() >> 33);
+      if (tree.Insert(key, RecordPointer(key, 0))) live.push_back(key);
+      ops++;
+    }
+    ops += burst_keys;
+  }
+  double seconds = secondsSince(start);
+  std::printf("%s deletes: %.0f ops/s\n", lazy ? "lazy" : "eager", ops / seconds);
+  report("churned", tree);
+  if (lazy) {
+    start = Clock::now();
+    while (!tree.Compact(1 << 16).done) {
+    }
+    std::printf("compact  %.3f s\n", secondsSince(start));
+    report("packed", tree);
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 21;
+  int rounds = argc > 2 ? std::atoi(argv[2]) : 8;
+  double burst = argc > 3 ? std::atof(argv[3]) : 0.25;
+  run(false, num_keys, rounds, burst);
+  run(true, num_keys, rounds, burst);
+  return 0;
+}
@@ -0,0 +1,79 @@
+// Memory per entry, point lookups and range scans of plain leaves against
+// packed leaves (PackedLeafFormat), for trees built by BulkLoad and by random
+// inserts. Keys are dense and 64 records share a page, like a clustered table.
+//
+// usage: leaf_compression_benchmark [keys]   (default: 4M keys)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+// every slot once in random order: the multiplier is prime, so it is coprime
+// to num_keys
+static size_t slotAt(size_t i, size_t num_keys) { return (i * 2654435761ULL) % num_keys; }
+
+static RecordPointer recordFor(size_t i) { return RecordPointer(static_cast<int>(i / 64), static_cast<int>(i % 64)); }
+
+template <typename Tree>
+static void run(const char *name, int fanout, bool bulk, size_t num_keys) {
+  Tree tree;
+  if (bulk) {
+    std::vector<std::pair<int, RecordPointer>> entries;
+    entries.reserve(num_keys);
+    for (size_t i = 0; i < num_keys; i++) entries.emplace_back(static_cast<int>(i), recordFor(i));
+    tree.BulkLoad(entries);
+  } else {
+    // slot 0 comes first and is loaded, so Insert never reports an empty tree
+    std::vector<std::pair<int, RecordPointer>> first{{0, recordFor(0)}};
+    tree.BulkLoad(first);
+    for (size_t i = 1; i < num_keys; i++) {
+      size_t slot = slotAt(i, num_keys);
+      tree.Insert(static_cast<int>(slot), recordFor(slot));
+    }
+  }
+  NodeAllocatorStats stats = tree.GetAllocatorStats();
+
+  const size_t num_lookups = 1 << 21;
+  std::mt19937_64 rng(42);
+  RecordPointer value;
+  size_t hits = 0;
+  auto start = Clock::now();
+  for (size_t i = 0; i < num_lookups; i++) hits += tree.GetValue(static_cast<int>(rng() % num_keys), value);
+  double lookup_rate = num_lookups / secondsSince(start);
+
+  size_t scanned = 0;
+  long long checksum = 0;
+  start = Clock::now();
+  tree.ForEach(0, static_cast<int>(num_keys), [&](const int &, const RecordPointer &record) {
+    scanned++;
+    checksum += record.record_id;
+    return true;
+  });
+  double scan_rate = scanned / secondsSince(start);
+
+  std::printf("%-7s %7d %-7s %12.2f %12.0f %14.0f %s\n", name, fanout, bulk ? "bulk" : "insert",
+              static_cast<double>(stats.bytes_live) / tree.size, lookup_rate, scan_rate,
+              hits == num_lookups && checksum >= 0 ? "" : "(lost keys!)");
+}
+
+template <int Fanout>
+static void runFanout(size_t num_keys) {
+  for (bool bulk : {true, false}) {
+    run<BPlusTree<int, RecordPointer, Fanout>>("plain", Fanout, bulk, num_keys);
+    run<PackedBPlusTree<int, Fanout>>("packed", Fanout, bulk, num_keys);
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 22;
+
+  std::printf("%-7s %7s %-7s %12s %12s %14s\n", "leaves", "fanout", "build", "bytes/entry", "lookups/s",
+              "scanned/s");
+  runFanout<kFanoutForNodeBytes<int, RecordPointer, kDefaultNodeBytes>>(num_keys);
+  runFanout<kFanoutForNodeBytes<int, RecordPointer, 4096>>(num_keys);
+  return 0;
+}
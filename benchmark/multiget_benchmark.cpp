@@ -0,0 +1,60 @@
+// Compares batched MultiGet against a loop of GetValue calls on trees that do
+// not fit in the last level cache.
+//
+// usage: multiget_benchmark [keys ...]      (default: 1M 4M 16M keys)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+template <int Fanout>
+static void runSize(size_t num_keys, size_t num_lookups) {
+  using Tree = BPlusTree<int, RecordPointer, Fanout>;
+  Tree tree;
+  std::vector<std::pair<int, RecordPointer>> entries;
+  entries.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    entries.emplace_back(static_cast<int>(i * 2), RecordPointer(static_cast<int>(i), 0));
+  }
+  tree.BulkLoad(entries, 0.7);
+  entries.clear();
+  entries.shrink_to_fit();
+
+  std::mt19937_64 rng(42);
+  std::vector<int> keys(num_lookups);
+  for (auto &key : keys) key = static_cast<int>(rng() % (num_keys * 2));
+  std::vector<RecordPointer> results(num_lookups);
+  std::vector<bool> found;
+
+  auto start = Clock::now();
+  size_t loop_hits = 0;
+  for (size_t i = 0; i < num_lookups; i++) loop_hits += tree.GetValue(keys[i], results[i]);
+  double loop_secs = secondsSince(start);
+
+  start = Clock::now();
+  size_t batch_hits = tree.MultiGet(keys, results, found);
+  double batch_secs = secondsSince(start);
+
+  NodeAllocatorStats stats = tree.GetAllocatorStats();
+  std::printf("%4d %10zu %8.1f %12.2f %12.2f %7.2fx %s\n", Fanout, num_keys, stats.bytes_live / 1048576.0,
+              num_lookups / loop_secs / 1e6, num_lookups / batch_secs / 1e6, loop_secs / batch_secs,
+              loop_hits == batch_hits ? "" : "MISMATCH");
+}
+
+int main(int argc, char **argv) {
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; i++) sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+  if (sizes.empty()) sizes = {1 << 20, 1 << 22, 1 << 24};
+  const size_t num_lookups = 1 << 22;
+
+  std::printf("%4s %10s %8s %12s %12s %8s\n", "fan", "keys", "MiB", "GetValue M/s", "MultiGet M/s", "speedup");
+  for (size_t num_keys : sizes) {
+    runSize<kFanoutForNodeBytes<int, RecordPointer, 256>>(num_keys, num_lookups);
+    runSize<kFanoutForNodeBytes<int, RecordPointer, 1024>>(num_keys, num_lookups);
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+// Cost of the node layout on the three paths it shapes: random point lookups
+// in a bulk loaded tree, inserts into full leaves (nearly every one splits a
+// leaf, and one in Fanout/2 an internal node too), and removes from half-full
+// leaves (nearly every one borrows or merges). Prints the node sizes, the
+// time per operation and, where perf_event_open is allowed, the last level
+// cache misses per lookup, per split and per merge.
+//
+// usage: node_layout_benchmark [keys]   (default: 8M keys)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+
+// Cache misses of this thread, or nothing if perf events are not permitted
+class CacheMisses {
+ public:
+  CacheMisses() {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+  ~CacheMisses() {
+    if (fd_ >= 0) ::close(fd_);
+  }
+  bool Available() const { return fd_ >= 0; }
+  uint64_t Read() const {
+    uint64_t count = 0;
+    if (fd_ < 0 || ::read(fd_, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) return 0;
+    return count;
+  }
+
+ private:
+  int fd_;
+};
+
+static size_t nodes(const Tree &tree) {
+  NodeAllocatorStats stats = tree.GetAllocatorStats();
+  return stats.leaf_nodes + stats.internal_nodes;
+}
+
+static void report(const char *phase, size_t ops, size_t events, double seconds, uint64_t misses,
+                   const CacheMisses &counter) {
+  std::printf("%-8s %10zu ops %10zu nodes %9.1f ns/op", phase, ops, events, seconds * 1e9 / ops);
+  if (counter.Available()) std::printf(" %8.2f misses/op", static_cast<double>(misses) / ops);
+  std::printf("\n");
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 23;
+  std::printf("fanout %d, leaf %zu bytes (align %zu), internal %zu bytes (align %zu)\n", Tree::MAX_FANOUT,
+              sizeof(Tree::LeafNodeType), alignof(Tree::LeafNodeType), sizeof(Tree::InternalNodeType),
+              alignof(Tree::InternalNodeType));
+  CacheMisses counter;
+  if (!counter.Available()) std::printf("perf events unavailable, timing only\n");
+  std::mt19937_64 rng(31);
+
+  // even keys, so odd ones can go in between
+  std::vector<std::pair<int, RecordPointer>> entries(num_keys);
+  for (size_t i = 0; i < num_keys; i++) entries[i] = {static_cast<int>(2 * i), RecordPointer(static_cast<int>(i), 0)};
+  {
+    Tree tree;
+    tree.BulkLoad(entries);
+    size_t lookups = 1 << 22;
+    std::vector<int> probes(lookups);
+    for (int &probe : probes) probe = static_cast<int>(2 * (rng() % num_keys));
+    RecordPointer value;
+    size_t found = 0;
+    uint64_t misses = counter.Read();
+    auto start = Clock::now();
+    for (int key : probes) found += tree.GetValue(key, value);
+    double seconds = secondsSince(start);
+    report("lookup", lookups, 0, seconds, counter.Read() - misses, counter);
+    if (found != lookups) std::printf("lost keys!\n");
+
+    // an eighth as many inserts as leaves, so few land in a leaf split before
+    size_t inserts = tree.GetAllocatorStats().leaf_nodes / 8;
+    for (int &probe : probes) probe = static_cast<int>(2 * (rng() % num_keys) + 1);
+    size_t before = nodes(tree);
+    misses = counter.Read();
+    start = Clock::now();
+    for (size_t i = 0; i < inserts; i++) tree.Insert(probes[i], value);
+    seconds = secondsSince(start);
+    report("split", inserts, nodes(tree) - before, seconds, counter.Read() - misses, counter);
+  }
+  {
+    // half-full leaves: a remove from one that has not grown yet rebalances
+    Tree tree;
+    tree.BulkLoad(entries, 0.5);
+    size_t removes = tree.GetAllocatorStats().leaf_nodes / 8;
+    std::vector<int> victims(removes);
+    for (int &victim : victims) victim = static_cast<int>(2 * (rng() % num_keys));
+    size_t before = nodes(tree);
+    uint64_t misses = counter.Read();
+    auto start = Clock::now();
+    for (int key : victims) tree.Remove(key);
+    double seconds = secondsSince(start);
+    report("merge", removes, before - nodes(tree), seconds, counter.Read() - misses, counter);
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Point lookups with the three in-node searches: a branchless scalar search
+// (a plain comparator, which rules out SIMD), the default binary narrowing
+// plus SIMD count (std::less), and interpolation (InterpolatingLess), on
+// uniform, clustered and skewed integer keys, for 256 byte and 4 KiB nodes.
+//
+// usage: node_search_benchmark [keys]   (default: 4M keys)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+// same order as std::less, but not recognized by node_search.h
+struct ScalarLess {
+  bool operator()(int a, int b) const { return a < b; }
+};
+
+// sorted, unique keys
+static std::vector<int> makeKeys(const char *distribution, size_t num_keys) {
+  std::mt19937_64 rng(11);
+  std::vector<int> keys;
+  keys.reserve(num_keys + num_keys / 8);
+  while (keys.size() < num_keys) {
+    size_t missing = num_keys - keys.size();
+    if (distribution[0] == 'u') {
+      // uniform over the whole int range
+      for (size_t i = 0; i < missing; i++) keys.push_back(static_cast<int>(rng()));
+    } else if (distribution[0] == 'c') {
+      // runs of 1000 consecutive keys at uniform starting points
+      for (size_t i = 0; i < missing; i += 1000) {
+        int base = static_cast<int>(rng() % (std::numeric_limits<int>::max() - 1000));
+        for (int j = 0; j < 1000; j++) keys.push_back(base + j);
+      }
+    } else {
+      // skewed: a power law bunching most keys near zero
+      std::uniform_real_distribution<double> unit(0.0, 1.0);
+      for (size_t i = 0; i < missing; i++) {
+        keys.push_back(static_cast<int>(std::pow(unit(rng), 4.0) * std::numeric_limits<int>::max()));
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  }
+  keys.resize(num_keys);
+  return keys;
+}
+
+template <typename Compare, int Fanout>
+struct Index {
+  BPlusTree<int, RecordPointer, Fanout, Compare> tree;
+
+  explicit Index(const std::vector<int> &keys) {
+    std::vector<std::pair<int, RecordPointer>> entries;
+    entries.reserve(keys.size());
+    for (int key : keys) entries.emplace_back(key, RecordPointer(key, 0));
+    tree.BulkLoad(entries);
+  }
+
+  double LookupRate(const std::vector<int> &probes) {
+    RecordPointer value;
+    size_t hits = 0;
+    auto start = Clock::now();
+    for (int probe : probes) hits += tree.GetValue(probe, value);
+    double rate = probes.size() / secondsSince(start);
+    if (hits != probes.size()) std::printf("lost keys!\n");
+    return rate;
+  }
+};
+
+// the three trees are built first and measured in turns, best of kRounds, so
+// none of them is favoured by running first
+template <int Fanout>
+static void runFanout(const char *distribution, const std::vector<int> &keys, const std::vector<int> &probes) {
+  constexpr int kRounds = 3;
+  Index<ScalarLess, Fanout> scalar(keys);
+  Index<std::less<int>, Fanout> simd(keys);
+  Index<InterpolatingLess<int>, Fanout> interpolation(keys);
+  double rates[3] = {0, 0, 0};
+  for (int round = 0; round < kRounds; round++) {
+    rates[0] = std::max(rates[0], scalar.LookupRate(probes));
+    rates[1] = std::max(rates[1], simd.LookupRate(probes));
+    rates[2] = std::max(rates[2], interpolation.LookupRate(probes));
+  }
+  std::printf("%-10s %7d %14.0f %14.0f %14.0f\n", distribution, Fanout, rates[0], rates[1], rates[2]);
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 22;
+  constexpr size_t kProbes = 1 << 21;
+
+  std::printf("%-10s %7s %14s %14s %14s   (lookups/s)\n", "keys", "fanout", "scalar", "simd", "interpolation");
+  for (const char *distribution : {"uniform", "clustered", "skewed"}) {
+    std::vector<int> keys = makeKeys(distribution, num_keys);
+    std::mt19937_64 rng(5);
+    std::vector<int> probes(kProbes);
+    for (int &probe : probes) probe = keys[rng() % keys.size()];
+    runFanout<kFanoutForNodeBytes<int, RecordPointer, kDefaultNodeBytes>>(distribution, keys, probes);
+    runFanout<kFanoutForNodeBytes<int, RecordPointer, 4096>>(distribution, keys, probes);
+  }
+  return 0;
+}
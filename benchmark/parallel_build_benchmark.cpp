@@ -0,0 +1,71 @@
+// Building a tree from an unsorted dump with duplicate keys: one Insert per
+// row, std::stable_sort plus BulkLoad, and ParallelBulkLoad on pools of 1, 2,
+// 4, ... threads up to the hardware thread count. Every build keeps the
+// first row of a key, so all of them end up with the same entries.
+//
+// usage: parallel_build_benchmark [rows] [max threads]
+//        (default: 16M rows, hardware threads)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+using Entry = std::pair<int, RecordPointer>;
+
+static void report(const char *name, size_t rows, double seconds, const Tree &tree) {
+  std::printf("%-14s %10.3f %14.0f %12zu\n", name, seconds, rows / seconds, static_cast<size_t>(tree.size));
+}
+
+int main(int argc, char **argv) {
+  size_t num_rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 24;
+  size_t max_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+  max_threads = std::max<size_t>(1, max_threads);
+
+  // keys drawn from a range a bit larger than the row count, so about a third
+  // of the rows repeat an earlier key
+  std::mt19937_64 rng(17);
+  std::vector<Entry> rows(num_rows);
+  for (size_t i = 0; i < num_rows; i++) {
+    rows[i] = Entry(static_cast<int>(rng() % (num_rows + num_rows / 7)), RecordPointer(static_cast<int>(i / 64), 0));
+  }
+
+  std::printf("%-14s %10s %14s %12s\n", "build", "seconds", "rows/s", "entries");
+  {
+    Tree tree;
+    auto start = Clock::now();
+    for (const Entry &row : rows) tree.Insert(row.first, row.second);
+    report("inserts", num_rows, secondsSince(start), tree);
+  }
+  {
+    Tree tree;
+    auto start = Clock::now();
+    std::vector<Entry> sorted = rows;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Entry &a, const Entry &b) { return a.first < b.first; });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(),
+                             [](const Entry &a, const Entry &b) { return a.first == b.first; }),
+                 sorted.end());
+    tree.BulkLoad(sorted);
+    report("sort+bulk", num_rows, secondsSince(start), tree);
+  }
+
+  std::vector<size_t> thread_counts;
+  for (size_t threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+  thread_counts.push_back(max_threads);
+  for (size_t threads : thread_counts) {
+    WorkStealingPool pool(threads);
+    Tree tree;
+    auto start = Clock::now();
+    tree.ParallelBulkLoad(rows, pool);
+    char name[32];
+    std::snprintf(name, sizeof(name), "parallel x%zu", threads);
+    report(name, num_rows, secondsSince(start), tree);
+  }
+  return 0;
+}
@@ -0,0 +1,88 @@
+// Full-range scans on one thread (RangeScan, and a ForEach sum) against
+// ParallelRangeScan and ParallelReduce (count, sum, min/max) on pools of 1, 2,
+// 4, ... threads up to the hardware thread count. Wall time should drop with
+// the thread count until memory bandwidth runs out.
+//
+// usage: parallel_scan_benchmark [keys] [max threads]
+//        (default: 16M keys, hardware threads)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+
+struct Aggregate {
+  size_t count = 0;
+  long long sum = 0;
+  int min = INT_MAX;
+  int max = INT_MIN;
+};
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 24;
+  size_t max_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+  max_threads = std::max<size_t>(1, max_threads);
+
+  std::vector<std::pair<int, RecordPointer>> entries;
+  entries.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    entries.emplace_back(static_cast<int>(i), RecordPointer(static_cast<int>(i % 1000), 0));
+  }
+  Tree tree;
+  tree.BulkLoad(entries);
+  entries = {};
+
+  std::vector<RecordPointer> serial;
+  auto start = Clock::now();
+  tree.RangeScan(INT_MIN, INT_MAX, serial);
+  double scan_seconds = secondsSince(start);
+  long long serial_sum = 0;
+  start = Clock::now();
+  tree.ForEach(INT_MIN, INT_MAX, [&serial_sum](const int &, const RecordPointer &value) {
+    serial_sum += value.page_id;
+    return true;
+  });
+  double sum_seconds = secondsSince(start);
+  std::printf("%-8s %12s %14s %12s %14s\n", "threads", "scan s", "entries/s", "reduce s", "entries/s");
+  std::printf("%-8s %12.3f %14.0f %12.3f %14.0f\n", "serial", scan_seconds, num_keys / scan_seconds, sum_seconds,
+              num_keys / sum_seconds);
+
+  std::vector<size_t> thread_counts;
+  for (size_t threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+  thread_counts.push_back(max_threads);
+  for (size_t threads : thread_counts) {
+    WorkStealingPool pool(threads);
+    std::vector<std::vector<RecordPointer>> out;
+    start = Clock::now();
+    size_t scanned = tree.ParallelRangeScan(INT_MIN, INT_MAX, pool, out);
+    scan_seconds = secondsSince(start);
+
+    start = Clock::now();
+    Aggregate total = tree.ParallelReduce(
+        INT_MIN, INT_MAX, pool, Aggregate(),
+        [](Aggregate &a, const int &key, const RecordPointer &value) {
+          a.count++;
+          a.sum += value.page_id;
+          a.min = std::min(a.min, key);
+          a.max = std::max(a.max, key);
+        },
+        [](Aggregate &a, const Aggregate &b) {
+          a.count += b.count;
+          a.sum += b.sum;
+          a.min = std::min(a.min, b.min);
+          a.max = std::max(a.max, b.max);
+        });
+    sum_seconds = secondsSince(start);
+    bool ok = scanned == serial.size() && total.count == num_keys && total.sum == serial_sum;
+    std::printf("%-8zu %12.3f %14.0f %12.3f %14.0f %s\n", threads, scan_seconds, num_keys / scan_seconds, sum_seconds,
+                num_keys / sum_seconds, ok ? "" : "(mismatch!)");
+  }
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Short scans out of large ranges: the last N entries before a key, and a
+// page of N entries after skipping an offset, each asked for at random
+// positions of a bulk loaded tree. Compares collecting the whole range with
+// RangeScan and dropping what is not needed against pushing the order,
+// limit and offset down into the scan.
+//
+// usage: scan_limit_benchmark [keys] [range]   (default: 8M keys, ranges of 4096 entries)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+using Tree = BPlusTree<int, RecordPointer>;
+
+constexpr size_t kQueries = 1 << 16;
+constexpr size_t kLimit = 10;
+
+// Runs query(low, high, out) on kQueries random ranges of range entries and
+// returns the microseconds per query
+template <typename Query>
+static double timeQueries(size_t num_keys, size_t range, Query &&query) {
+  std::mt19937_64 rng(17);
+  std::vector<RecordPointer> out;
+  size_t returned = 0;
+  auto start = Clock::now();
+  for (size_t q = 0; q < kQueries; q++) {
+    int low = static_cast<int>(2 * (rng() % (num_keys - range)));
+    out.clear();
+    query(low, low + static_cast<int>(2 * range), out);
+    returned += out.size();
+  }
+  double micros = secondsSince(start) * 1e6 / kQueries;
+  if (returned != kQueries * kLimit) std::printf("wrong result size!\n");
+  return micros;
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 23;
+  size_t range = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4096;
+  std::vector<std::pair<int, RecordPointer>> entries(num_keys);
+  for (size_t i = 0; i < num_keys; i++) entries[i] = {static_cast<int>(2 * i), RecordPointer(static_cast<int>(i), 0)};
+  Tree tree;
+  tree.BulkLoad(entries);
+  size_t offset = range / 2;
+
+  std::printf("%-22s %14s %14s\n", "query", "collect us", "pushdown us");
+  double collect = timeQueries(num_keys, range, [&](int low, int high, std::vector<RecordPointer> &out) {
+    std::vector<RecordPointer> all;
+    tree.RangeScan(low, high, all);
+    out.assign(all.end() - kLimit, all.end());
+  });
+  double pushdown = timeQueries(num_keys, range, [&](int low, int high, std::vector<RecordPointer> &out) {
+    tree.ReverseRangeScan(low, high, out, kLimit);
+  });
+  std::printf("%-22s %14.2f %14.2f\n", "last 10 before key", collect, pushdown);
+
+  collect = timeQueries(num_keys, range, [&](int low, int high, std::vector<RecordPointer> &out) {
+    std::vector<RecordPointer> all;
+    tree.RangeScan(low, high, all);
+    out.assign(all.begin() + offset, all.begin() + offset + kLimit);
+  });
+  pushdown = timeQueries(num_keys, range, [&](int low, int high, std::vector<RecordPointer> &out) {
+    tree.RangeScan(low, high, out, kLimit, offset);
+  });
+  std::printf("%-22s %14.2f %14.2f\n", "10 after offset", collect, pushdown);
+  return 0;
+}
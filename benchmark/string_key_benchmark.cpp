@@ -0,0 +1,69 @@
+// Memory per entry, inserts, point lookups and range scans of std::string keys
+// in plain leaves against StringBPlusTree (StringKey keys, slotted leaves with
+// prefix compression, suffix-truncated separators). Keys are URL-like, so the
+// keys of a leaf share a long prefix.
+//
+// usage: string_key_benchmark [keys]   (default: 1M keys)
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::string keyFor(size_t i) {
+  static const char *const kHosts[] = {"https://www.example.com/", "https://shop.example.org/", "https://cdn.example.net/"};
+  return std::string(kHosts[i % 3]) + "items/" + std::to_string(i / 3 % 1000) + "/" + std::to_string(i);
+}
+
+template <typename Key, typename Tree>
+static void run(const char *name, size_t num_keys) {
+  std::vector<std::string> keys;
+  keys.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; i++) keys.push_back(keyFor(i));
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(7));
+
+  Tree tree;
+  auto start = Clock::now();
+  // the first key is loaded, so Insert never reports an empty tree
+  std::vector<std::pair<Key, RecordPointer>> first{{keys[0], RecordPointer(0, 0)}};
+  tree.BulkLoad(first);
+  for (size_t i = 1; i < num_keys; i++) {
+    tree.Insert(keys[i], RecordPointer(static_cast<int>(i / 64), static_cast<int>(i % 64)));
+  }
+  double insert_rate = num_keys / secondsSince(start);
+  NodeAllocatorStats stats = tree.GetAllocatorStats();
+
+  const size_t num_lookups = 1 << 20;
+  std::mt19937_64 rng(42);
+  std::vector<Key> probes;
+  probes.reserve(num_lookups);
+  for (size_t i = 0; i < num_lookups; i++) probes.emplace_back(keys[rng() % num_keys]);
+  RecordPointer value;
+  size_t hits = 0;
+  start = Clock::now();
+  for (const auto &probe : probes) hits += tree.GetValue(probe, value);
+  double lookup_rate = num_lookups / secondsSince(start);
+
+  size_t scanned = 0;
+  start = Clock::now();
+  for (auto cursor = tree.Begin(); cursor.Valid(); cursor.Next()) scanned++;
+  double scan_rate = scanned / secondsSince(start);
+
+  std::printf("%-10s %16.2f %12.0f %12.0f %14.0f %s\n", name, static_cast<double>(stats.bytes_live) / tree.size,
+              insert_rate, lookup_rate, scan_rate, hits == num_lookups && scanned == num_keys ? "" : "(lost keys!)");
+}
+
+int main(int argc, char **argv) {
+  size_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 20;
+
+  // node bytes only count the tree: std::string keys also own heap buffers
+  // for keys longer than the small-string buffer
+  std::printf("%-10s %16s %12s %12s %14s\n", "keys", "node bytes/entry", "inserts/s", "lookups/s", "scanned/s");
+  run<std::string, BPlusTree<std::string, RecordPointer, 64>>("string", num_keys);
+  run<StringKey, StringBPlusTree<>>("StringKey", num_keys);
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Insert throughput of the in-memory tree without a log, and of
+// DurableBPlusTree with each WAL sync mode, for several writer thread counts.
+//
+// usage: wal_benchmark [log path prefix] [inserts per thread]
+//        (default: /tmp/wal_benchmark, 20000 inserts per thread)
+#include "include/durable_b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Durable = DurableBPlusTree<int, RecordPointer>;
+
+// distinct keys in random order: odd multipliers permute the 31-bit range
+static int keyAt(size_t i) { return static_cast<int>((i * 2654435761ULL) & 0x7fffffff); }
+
+template <typename InsertFn>
+static double runThreads(int threads, size_t per_thread, InsertFn insert) {
+  std::vector<std::thread> workers;
+  auto start = Clock::now();
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      for (size_t i = 0; i < per_thread; i++) insert(keyAt(t * per_thread + i));
+    });
+  }
+  for (auto &w : workers) w.join();
+  return threads * per_thread / secondsSince(start);
+}
+
+static double runNoLog(int threads, size_t per_thread) {
+  BPlusTree<int, RecordPointer> tree;
+  tree.SetThreadSafe(true);
+  return runThreads(threads, per_thread, [&](int key) { tree.Insert(key, RecordPointer(key, 0)); });
+}
+
+static double runDurable(const std::string &path, WalSyncMode mode, int threads, size_t per_thread,
+                         size_t &syncs) {
+  std::remove((path + ".ckpt").c_str());
+  std::remove((path + ".wal").c_str());
+  WalOptions options;
+  options.sync_mode = mode;
+  Durable tree(path, options);
+  if (!tree.Recover()) return 0;
+  tree.Tree().SetThreadSafe(true);
+  double rate = runThreads(threads, per_thread, [&](int key) { tree.Insert(key, RecordPointer(key, 0)); });
+  syncs = tree.LogSyncs();
+  return rate;
+}
+
+int main(int argc, char **argv) {
+  std::string path = argc > 1 ? argv[1] : "/tmp/wal_benchmark";
+  size_t per_thread = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000;
+
+  std::printf("%7s %12s %14s %14s %14s %14s\n", "threads", "no log/s", "no sync/s", "group/s", "every op/s",
+              "syncs g/e");
+  for (int threads : {1, 4, 16}) {
+    size_t group_syncs = 0, every_syncs = 0, unused = 0;
+    double none = runNoLog(threads, per_thread);
+    double nosync = runDurable(path, WalSyncMode::kNoSync, threads, per_thread, unused);
+    double group = runDurable(path, WalSyncMode::kGroupCommit, threads, per_thread, group_syncs);
+    double every = runDurable(path, WalSyncMode::kEveryCommit, threads, per_thread, every_syncs);
+    std::printf("%7d %12.0f %14.0f %14.0f %14.0f %7zu/%zu\n", threads, none, nosync, group, every, group_syncs,
+                every_syncs);
+  }
+  std::remove((path + ".ckpt").c_str());
+  std::remove((path + ".wal").c_str());
+  return 0;
+}
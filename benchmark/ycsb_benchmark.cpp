@@ -0,0 +1,491 @@
+// YCSB-style workloads on BPlusTree at several fanouts, with std::map and a
+// sorted vector as reference points. Prints one JSON document to stdout with
+// throughput, p50/p99/p999 latency and bytes per key for every combination of
+// index, tree size, workload and key distribution; progress goes to stderr.
+//
+// Workloads (YCSB core workloads, plus churn for Remove):
+//   A  50% read, 50% update          B  95% read, 5% update
+//   C  100% read                     D  95% read of recent keys, 5% insert
+//   E  95% scan of up to 100 keys,   F  50% read, 50% read-modify-write
+//      5% insert                     churn  50% read, 25% insert, 25% remove
+// Updates use InsertOrAssign. Inserts append new keys and churn removes the
+// oldest ones, so records stay dense and churn keeps the size constant.
+//
+// Distributions pick which live record an operation touches: uniform,
+// zipfian (theta 0.99, scrambled so hot keys spread over the key space; D
+// counts back from the newest key unscrambled, like YCSB's latest) and
+// sequential (one pass after the other over the keys in order).
+//
+// The default sizes hold 1/16, 1 and 10 times the last level cache in raw
+// 12 byte entries; the largest needs several GiB for std::map.
+//
+// usage: ycsb_benchmark [--ops=N] [--sizes=N,N,...] [--max-keys=N]
+//                       [--workloads=A,B,C,D,E,F,churn]
+//                       [--distributions=uniform,zipfian,sequential]
+//                       [--indexes=bplustree,map,sorted_vector] [--fanouts=8,19,64,256]
+#include "include/b_plus_tree.h"
+#include "benchmark/benchmark_util.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using Entry = std::pair<int, RecordPointer>;
+
+// latency is timed on every kSampleEvery-th operation, so the clock reads
+// barely show in the throughput
+constexpr size_t kSampleEvery = 8;
+constexpr int kMaxScanLength = 100;
+// sorted_vector removes the smallest key with an O(n) erase: churn on it is
+// skipped above this size
+constexpr size_t kSortedVectorChurnLimit = 1 << 20;
+
+enum class Op { kRead, kUpdate, kInsert, kScan, kReadModifyWrite, kRemove };
+
+struct Workload {
+  const char *name;
+  // cumulative shares in the order of Op
+  double mix[6];
+  // reads count back from the newest key
+  bool latest;
+  // the key set changes, so the next workload starts from a fresh load
+  bool mutates;
+
+  Op Pick(double p) const {
+    for (int op = 0; op < 6; op++) {
+      if (p < mix[op]) return static_cast<Op>(op);
+    }
+    return Op::kRead;
+  }
+};
+
+static const Workload kWorkloads[] = {
+    {"A", {0.5, 1.0, 1.0, 1.0, 1.0, 1.0}, false, false},
+    {"B", {0.95, 1.0, 1.0, 1.0, 1.0, 1.0}, false, false},
+    {"C", {1.0, 1.0, 1.0, 1.0, 1.0, 1.0}, false, false},
+    {"D", {0.95, 0.95, 1.0, 1.0, 1.0, 1.0}, true, true},
+    {"E", {0.0, 0.0, 0.05, 1.0, 1.0, 1.0}, false, true},
+    {"F", {0.5, 0.5, 0.5, 0.5, 1.0, 1.0}, false, false},
+    {"churn", {0.5, 0.5, 0.75, 0.75, 0.75, 1.0}, false, true},
+};
+
+enum class Distribution { kUniform, kZipfian, kSequential };
+
+static const char *distributionName(Distribution dist) {
+  switch (dist) {
+    case Distribution::kUniform:
+      return "uniform";
+    case Distribution::kZipfian:
+      return "zipfian";
+    default:
+      return "sequential";
+  }
+}
+
+/*
+ * Zipfian ranks over [0, n) after Gray et al., "Quickly generating
+ * billion-record synthetic databases", as used by YCSB. Rank 0 is the most
+ * popular.
+ */
+class ZipfianGenerator {
+ public:
+  explicit ZipfianGenerator(uint64_t n, double theta = 0.99)
+      : n_(n), theta_(theta), alpha_(1.0 / (1.0 - theta)), zetan_(zeta(n, theta)) {
+    eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - zeta(2, theta) / zetan_);
+  }
+
+  template <typename Rng>
+  uint64_t Next(Rng &rng) {
+    double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    double uz = u * zetan_;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + std::pow(0.5, theta_)) return 1;
+    uint64_t rank = static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return std::min(rank, n_ - 1);
+  }
+
+ private:
+  static double zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    return sum;
+  }
+
+  uint64_t n_;
+  double theta_;
+  double alpha_;
+  double zetan_;
+  double eta_;
+};
+
+static uint64_t fnv1a(uint64_t value) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; i < 8; i++) {
+    hash ^= (value >> (i * 8)) & 0xff;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Offset into the live records [lo, hi) for the next operation
+class KeyChooser {
+ public:
+  KeyChooser(Distribution dist, ZipfianGenerator *zipf) : dist_(dist), zipf_(zipf) {}
+
+  template <typename Rng>
+  uint64_t Next(Rng &rng, uint64_t count, bool latest) {
+    switch (dist_) {
+      case Distribution::kUniform:
+        return rng() % count;
+      case Distribution::kZipfian: {
+        uint64_t rank = zipf_->Next(rng);
+        return latest ? rank % count : fnv1a(rank) % count;
+      }
+      default:
+        return next_++ % count;
+    }
+  }
+
+ private:
+  Distribution dist_;
+  ZipfianGenerator *zipf_;
+  uint64_t next_ = 0;
+};
+
+static RecordPointer recordFor(int key) { return RecordPointer(key / 64, key % 64); }
+
+/*
+ * Indexes under test. Each adapter loads sorted entries and exposes the
+ * operations of the workloads; update and remove are only called for keys
+ * that exist, insert only for keys that do not.
+ */
+template <int Fanout>
+class TreeIndex {
+ public:
+  static std::string Name() { return "bplustree"; }
+  static int FanoutOf() { return Fanout; }
+
+  void Load(const std::vector<Entry> &entries) {
+    tree_.reset();
+    tree_ = std::make_unique<Tree>();
+    // about the occupancy random inserts settle at
+    tree_->BulkLoad(entries, 0.7);
+  }
+  bool Get(int key, RecordPointer &value) { return tree_->GetValue(key, value); }
+  void Update(int key, const RecordPointer &value) { tree_->InsertOrAssign(key, value); }
+  void Insert(int key, const RecordPointer &value) { tree_->Insert(key, value); }
+  void Remove(int key) { tree_->Remove(key); }
+  size_t Scan(int from, int to, std::vector<RecordPointer> &out) {
+    out.clear();
+    tree_->RangeScan(from, to, out);
+    return out.size();
+  }
+  double BytesPerKey() const {
+    return static_cast<double>(tree_->GetAllocatorStats().bytes_live) / std::max(1, tree_->size.load());
+  }
+
+ private:
+  using Tree = BPlusTree<int, RecordPointer, Fanout>;
+  std::unique_ptr<Tree> tree_;
+};
+
+// bytes std::map asked its allocator for
+static size_t map_bytes = 0;
+
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+  CountingAllocator() = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U> &) {}
+  T *allocate(size_t n) {
+    map_bytes += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *ptr, size_t n) {
+    map_bytes -= n * sizeof(T);
+    std::allocator<T>().deallocate(ptr, n);
+  }
+  template <typename U>
+  bool operator==(const CountingAllocator<U> &) const {
+    return true;
+  }
+};
+
+class MapIndex {
+ public:
+  static std::string Name() { return "map"; }
+  static int FanoutOf() { return 0; }
+
+  void Load(const std::vector<Entry> &entries) {
+    map_.reset();
+    map_ = std::make_unique<Map>();
+    for (const Entry &entry : entries) map_->emplace_hint(map_->end(), entry);
+  }
+  bool Get(int key, RecordPointer &value) {
+    auto it = map_->find(key);
+    if (it == map_->end()) return false;
+    value = it->second;
+    return true;
+  }
+  void Update(int key, const RecordPointer &value) { map_->insert_or_assign(key, value); }
+  void Insert(int key, const RecordPointer &value) { map_->emplace(key, value); }
+  void Remove(int key) { map_->erase(key); }
+  size_t Scan(int from, int to, std::vector<RecordPointer> &out) {
+    out.clear();
+    for (auto it = map_->lower_bound(from); it != map_->end() && it->first < to; ++it) out.push_back(it->second);
+    return out.size();
+  }
+  double BytesPerKey() const { return static_cast<double>(map_bytes) / std::max<size_t>(1, map_->size()); }
+
+ private:
+  using Map = std::map<int, RecordPointer, std::less<int>, CountingAllocator<std::pair<const int, RecordPointer>>>;
+  std::unique_ptr<Map> map_;
+};
+
+class SortedVectorIndex {
+ public:
+  static std::string Name() { return "sorted_vector"; }
+  static int FanoutOf() { return 0; }
+
+  void Load(const std::vector<Entry> &entries) { entries_ = entries; }
+  bool Get(int key, RecordPointer &value) {
+    auto it = find(key);
+    if (it == entries_.end() || it->first != key) return false;
+    value = it->second;
+    return true;
+  }
+  void Update(int key, const RecordPointer &value) { find(key)->second = value; }
+  void Insert(int key, const RecordPointer &value) { entries_.emplace(find(key), key, value); }
+  void Remove(int key) { entries_.erase(find(key)); }
+  size_t Scan(int from, int to, std::vector<RecordPointer> &out) {
+    out.clear();
+    for (auto it = find(from); it != entries_.end() && it->first < to; ++it) out.push_back(it->second);
+    return out.size();
+  }
+  double BytesPerKey() const {
+    return static_cast<double>(entries_.capacity() * sizeof(Entry)) / std::max<size_t>(1, entries_.size());
+  }
+
+ private:
+  std::vector<Entry>::iterator find(int key) {
+    return std::lower_bound(entries_.begin(), entries_.end(), key,
+                            [](const Entry &entry, int k) { return entry.first < k; });
+  }
+
+  std::vector<Entry> entries_;
+};
+
+struct Options {
+  size_t ops = 1 << 20;
+  std::vector<size_t> sizes;
+  size_t max_keys = size_t(1) << 27;
+  std::vector<std::string> workloads;
+  std::vector<std::string> distributions;
+  std::vector<std::string> indexes;
+  std::vector<int> fanouts;
+};
+
+static bool selected(const std::vector<std::string> &list, const std::string &name) {
+  return list.empty() || std::find(list.begin(), list.end(), name) != list.end();
+}
+
+static std::vector<std::string> splitList(const char *text) {
+  std::vector<std::string> items;
+  std::string item;
+  for (const char *c = text;; c++) {
+    if (*c == ',' || *c == '\0') {
+      if (!item.empty()) items.push_back(item);
+      item.clear();
+      if (*c == '\0') return items;
+    } else {
+      item += *c;
+    }
+  }
+}
+
+static size_t lastLevelCacheBytes() {
+  long bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (bytes <= 0) bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  return bytes > 0 ? static_cast<size_t>(bytes) : size_t(32) << 20;
+}
+
+static uint64_t percentile(const std::vector<uint64_t> &sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+
+static bool first_result = true;
+
+template <typename Index>
+static void runWorkload(Index &index, const Workload &workload, Distribution dist, size_t num_keys, size_t num_ops,
+                        ZipfianGenerator &zipf) {
+  std::mt19937_64 rng(12345);
+  std::uniform_real_distribution<double> share(0.0, 1.0);
+  KeyChooser chooser(dist, &zipf);
+  // live keys are [lo, hi)
+  int lo = 0;
+  int hi = static_cast<int>(num_keys);
+  std::vector<uint64_t> latencies;
+  latencies.reserve(num_ops / kSampleEvery + 1);
+  std::vector<RecordPointer> scanned;
+  RecordPointer value;
+  size_t checksum = 0;
+
+  auto pick = [&]() {
+    uint64_t offset = chooser.Next(rng, static_cast<uint64_t>(hi - lo), workload.latest);
+    return workload.latest ? hi - 1 - static_cast<int>(offset) : lo + static_cast<int>(offset);
+  };
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < num_ops; i++) {
+    Op op = workload.Pick(share(rng));
+    bool sample = i % kSampleEvery == 0;
+    Clock::time_point op_start;
+    if (sample) op_start = Clock::now();
+    switch (op) {
+      case Op::kRead:
+        checksum += index.Get(pick(), value);
+        break;
+      case Op::kUpdate: {
+        int key = pick();
+        index.Update(key, RecordPointer(key / 64, static_cast<int>(i)));
+        break;
+      }
+      case Op::kInsert:
+        index.Insert(hi, recordFor(hi));
+        hi++;
+        break;
+      case Op::kScan: {
+        int from = pick();
+        checksum += index.Scan(from, from + 1 + static_cast<int>(rng() % kMaxScanLength), scanned);
+        break;
+      }
+      case Op::kReadModifyWrite: {
+        int key = pick();
+        if (index.Get(key, value)) {
+          value.record_id++;
+          index.Update(key, value);
+        }
+        break;
+      }
+      case Op::kRemove:
+        // keep one key so every pick has a target
+        if (hi - lo > 1) index.Remove(lo++);
+        break;
+    }
+    if (sample) {
+      latencies.push_back(
+          static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - op_start).count()));
+    }
+  }
+  double seconds = secondsSince(start);
+  std::sort(latencies.begin(), latencies.end());
+
+  std::printf("%s\n    {\"index\": \"%s\", \"fanout\": %d, \"keys\": %zu, \"workload\": \"%s\", "
+              "\"distribution\": \"%s\", \"ops\": %zu, \"throughput_ops_per_s\": %.0f, "
+              "\"latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"p999\": %llu}, \"bytes_per_key\": %.2f, "
+              "\"checksum\": %zu}",
+              first_result ? "" : ",", Index::Name().c_str(), Index::FanoutOf(), num_keys, workload.name,
+              distributionName(dist), num_ops, static_cast<double>(num_ops) / seconds,
+              static_cast<unsigned long long>(percentile(latencies, 0.50)),
+              static_cast<unsigned long long>(percentile(latencies, 0.99)),
+              static_cast<unsigned long long>(percentile(latencies, 0.999)), index.BytesPerKey(), checksum);
+  std::fflush(stdout);
+  first_result = false;
+}
+
+template <typename Index>
+static void runIndex(const Options &options, size_t num_keys, ZipfianGenerator &zipf) {
+  if (!selected(options.indexes, Index::Name())) return;
+  if (Index::FanoutOf() != 0 && !options.fanouts.empty() &&
+      std::find(options.fanouts.begin(), options.fanouts.end(), Index::FanoutOf()) == options.fanouts.end()) {
+    return;
+  }
+  std::vector<Entry> entries;
+  entries.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; i++) entries.emplace_back(static_cast<int>(i), recordFor(static_cast<int>(i)));
+
+  Index index;
+  bool loaded = false;
+  for (const Workload &workload : kWorkloads) {
+    if (!selected(options.workloads, workload.name)) continue;
+    if (std::is_same_v<Index, SortedVectorIndex> && std::strcmp(workload.name, "churn") == 0 &&
+        num_keys > kSortedVectorChurnLimit) {
+      std::fprintf(stderr, "skipping churn on sorted_vector with %zu keys\n", num_keys);
+      continue;
+    }
+    for (Distribution dist : {Distribution::kUniform, Distribution::kZipfian, Distribution::kSequential}) {
+      if (!selected(options.distributions, distributionName(dist))) continue;
+      if (!loaded) index.Load(entries);
+      std::fprintf(stderr, "%s/%d %zu keys: workload %s, %s\n", Index::Name().c_str(), Index::FanoutOf(), num_keys,
+                   workload.name, distributionName(dist));
+      runWorkload(index, workload, dist, num_keys, options.ops, zipf);
+      loaded = !workload.mutates;
+    }
+  }
+}
+
+template <int... Fanouts>
+static void runTrees(const Options &options, size_t num_keys, ZipfianGenerator &zipf) {
+  (runIndex<TreeIndex<Fanouts>>(options, num_keys, zipf), ...);
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *eq = std::strchr(arg, '=');
+    std::string flag = eq == nullptr ? arg : std::string(arg, eq);
+    const char *value = eq == nullptr ? "" : eq + 1;
+    if (flag == "--ops") {
+      options.ops = std::strtoull(value, nullptr, 10);
+    } else if (flag == "--sizes") {
+      for (const std::string &size : splitList(value)) options.sizes.push_back(std::strtoull(size.c_str(), nullptr, 10));
+    } else if (flag == "--max-keys") {
+      options.max_keys = std::strtoull(value, nullptr, 10);
+    } else if (flag == "--workloads") {
+      options.workloads = splitList(value);
+    } else if (flag == "--distributions") {
+      options.distributions = splitList(value);
+    } else if (flag == "--indexes") {
+      options.indexes = splitList(value);
+    } else if (flag == "--fanouts") {
+      for (const std::string &fanout : splitList(value)) options.fanouts.push_back(std::atoi(fanout.c_str()));
+    } else {
+      std::fprintf(stderr, "unknown option %s\n", arg);
+      return 1;
+    }
+  }
+  size_t llc_bytes = lastLevelCacheBytes();
+  if (options.sizes.empty()) {
+    for (size_t bytes : {llc_bytes / 16, llc_bytes, llc_bytes * 10}) options.sizes.push_back(bytes / sizeof(Entry));
+  }
+
+  std::printf("{\n  \"benchmark\": \"ycsb\",\n  \"llc_bytes\": %zu,\n  \"ops_per_run\": %zu,\n"
+              "  \"latency_sample_every\": %zu,\n  \"results\": [",
+              llc_bytes, options.ops, kSampleEvery);
+  for (size_t num_keys : options.sizes) {
+    num_keys = std::max<size_t>(1, std::min(num_keys, options.max_keys));
+    ZipfianGenerator zipf(num_keys);
+    runTrees<8, kFanoutForNodeBytes<int, RecordPointer, kDefaultNodeBytes>, 64, 256>(options, num_keys, zipf);
+    runIndex<MapIndex>(options, num_keys, zipf);
+    runIndex<SortedVectorIndex>(options, num_keys, zipf);
+  }
+  std::printf("\n  ]\n}\n");
+  return 0;
+}
@@ -0,0 +1,695 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/b_plus_tree.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "epoch_manager.h"
+#include "frozen_b_plus_tree.h"
+#include "node_allocator.h"
+#include "node_search.h"
+#include "optimistic_latch.h"
+#include "tree_diagnostics.h"
+#include "tree_shape.h"
+#include "tree_stats.h"
+#include "work_stealing_pool.h"
+
+using namespace std;
+
+// Value structure we insert into BPlusTree
+struct RecordPointer {
+  int page_id;
+  int record_id;
+  RecordPointer() : page_id(0), record_id(0){};
+  RecordPointer(int page, int record) : page_id(page), record_id(record){};
+};
+
+// Outcome of the status-returning Insert, InsertOrAssign, Upsert and Remove
+enum class WriteStatus {
+  // the key was new and is now in the tree
+  kInserted,
+  // the key was there and its value was replaced
+  kUpdated,
+  // the key was there and was left alone
+  kDuplicate,
+  kRemoved,
+  kNotFound,
+};
+
+// Where the operations through a BPlusTree::Finger found their leaf
+struct FingerStats {
+  // the remembered leaf covered the key
+  size_t hits = 0;
+  // the leaf before or after it held the key's range
+  size_t neighbor_hits = 0;
+  // a descent from the root was needed
+  size_t misses = 0;
+
+  size_t Operations() const { return hits + neighbor_hits + misses; }
+  double HitRate() const {
+    return Operations() == 0 ? 0.0 : static_cast<double>(hits + neighbor_hits) / Operations();
+  }
+};
+
+constexpr size_t kCacheLineSize = 64;
+
+/*
+ * BPlusTree Node. Nodes start on a cache line, with a 13 byte header in front
+ * of the keys, so a search reads the header and the first keys in one line.
+ * There is no parent pointer: writers keep the path of their descent instead
+ * (BPlusTree::Path), so splits and merges do not rewrite the children they
+ * move. KeyType and Fanout are unused here and kept only as a type tag, so
+ * trees of different configurations get distinct node types.
+ */
+template <typename KeyType, int Fanout>
+class alignas(kCacheLineSize) Node {
+public:
+  Node(bool leaf) : key_num(0), is_leaf(leaf){};
+  // version latch, only used when the tree is in thread-safe mode
+  OptimisticLatch latch;
+  int key_num;
+  bool is_leaf;
+};
+
+// internal b+ tree node
+template <typename KeyType, int Fanout>
+class InternalNode : public Node<KeyType, Fanout> {
+public:
+  InternalNode() : Node<KeyType, Fanout>(false) {};
+  KeyType keys[Fanout - 1];
+  Node<KeyType, Fanout>* children[Fanout];
+};
+
+/*
+ * Leaf node holding keys and values as plain arrays. The tree reaches the
+ * entries only through the accessors below, which PackedLeafNode implements
+ * for its compressed columns as well.
+ */
+template <typename KeyType, typename ValueType, int Fanout>
+class LeafNode : public Node<KeyType, Fanout> {
+public:
+  // every leaf has the same size, there is nothing to choose per allocation
+  struct Layout {};
+  static constexpr bool kFixedSize = true;
+
+  LeafNode() : Node<KeyType, Fanout>(true) {};
+  explicit LeafNode(const Layout &) : LeafNode() {};
+  // pointer to the next/prev leaf node, in the header's cache line
+  LeafNode *next_leaf = NULL;
+  LeafNode *prev_leaf = NULL;
+  // keys contiguous, then the values
+  KeyType keys[Fanout - 1];
+  ValueType pointers[Fanout - 1];
+
+  const KeyType &KeyAt(int i) const { return keys[i]; }
+  const ValueType &ValueAt(int i) const { return pointers[i]; }
+  void CopyValues(int from, int n, ValueType *out) const { std::copy(pointers + from, pointers + from + n, out); }
+  // n is passed in because optimistic readers clamp key_num themselves
+  template <typename Compare>
+  int LowerBound(int n, const KeyType &key, const Compare &comp) const {
+    return NodeLowerBound(keys, n, key, comp);
+  }
+  template <typename Compare>
+  int UpperBound(int n, const KeyType &key, const Compare &comp) const {
+    return NodeUpperBound(keys, n, key, comp);
+  }
+  // True if entry i holds key, without materializing the stored key
+  template <typename Compare>
+  bool KeyEquals(int i, const KeyType &key, const Compare &comp) const {
+    return !comp(keys[i], key) && !comp(key, keys[i]);
+  }
+
+  static Layout LayoutFor(const KeyType *, const ValueType *, int) { return Layout(); }
+  static size_t BytesFor(const Layout &) { return sizeof(LeafNode); }
+  size_t AllocatedBytes() const { return sizeof(LeafNode); }
+  bool CanHold(const Layout &) const { return true; }
+  bool Fits(const KeyType &, const ValueType &) const { return true; }
+  // Overwrite the value of entry i; false if the leaf cannot encode it
+  bool SetValueAt(int i, const ValueType &value) {
+    pointers[i] = value;
+    return true;
+  }
+
+  void InsertAt(int index, const KeyType &key, const ValueType &value) {
+    for (int i = this->key_num; i > index; i--) {
+      keys[i] = keys[i - 1];
+      pointers[i] = pointers[i - 1];
+    }
+    keys[index] = key;
+    pointers[index] = value;
+    this->key_num += 1;
+  }
+  void RemoveAt(int index) {
+    for (int i = index; i < this->key_num - 1; i++) {
+      keys[i] = keys[i + 1];
+      pointers[i] = pointers[i + 1];
+    }
+    keys[this->key_num - 1] = KeyType();
+    pointers[this->key_num - 1] = ValueType();
+    this->key_num -= 1;
+  }
+  // Replace the contents with n sorted entries
+  void Assign(const KeyType *new_keys, const ValueType *values, int n) {
+    std::copy(new_keys, new_keys + n, keys);
+    std::copy(values, values + n, pointers);
+    this->key_num = n;
+  }
+};
+
+// Leaf representation of a tree: plain arrays, or PackedLeafFormat
+struct PlainLeafFormat {
+  template <typename KeyType, typename ValueType, int Fanout>
+  using Leaf = LeafNode<KeyType, ValueType, Fanout>;
+};
+
+#include "packed_leaf_node.h"
+#include "string_leaf_node.h"
+
+/*
+ * Separator promoted when a leaf splits between left and right: any key k
+ * with left < k <= right keeps the tree correct. Key types overload this to
+ * promote something shorter than right (see string_key.h).
+ */
+template <typename KeyType>
+const KeyType &SeparatorKey(const KeyType &, const KeyType &right) {
+  return right;
+}
+
+/*
+ * Compile-time binary search for the largest fanout whose leaf and internal
+ * nodes both fit in NodeBytes. Never goes below the minimum fanout of 3.
+ */
+template <typename KeyType, typename ValueType, size_t NodeBytes, int Lo = 3,
+          int Hi = static_cast<int>(NodeBytes / sizeof(KeyType)) + 1>
+struct FanoutForNodeBytes {
+  static constexpr int kMid = (Lo + Hi + 1) / 2;
+  static constexpr bool kFits = sizeof(LeafNode<KeyType, ValueType, kMid>) <= NodeBytes &&
+                                sizeof(InternalNode<KeyType, kMid>) <= NodeBytes;
+  static constexpr int value =
+      FanoutForNodeBytes<KeyType, ValueType, NodeBytes, kFits ? kMid : Lo, kFits ? Hi : kMid - 1>::value;
+};
+
+template <typename KeyType, typename ValueType, size_t NodeBytes, int Fanout>
+struct FanoutForNodeBytes<KeyType, ValueType, NodeBytes, Fanout, Fanout> {
+  static constexpr int value = Fanout;
+};
+
+// e.g. kFanoutForNodeBytes<int64_t, RecordPointer, 4096> for page sized nodes
+template <typename KeyType, typename ValueType, size_t NodeBytes>
+inline constexpr int kFanoutForNodeBytes = FanoutForNodeBytes<KeyType, ValueType, NodeBytes>::value;
+
+// default node size: four cache lines
+constexpr size_t kDefaultNodeBytes = 4 * kCacheLineSize;
+
+template <typename KeyType, typename ValueType, size_t CacheLines>
+inline constexpr int kFanoutForCacheLines = kFanoutForNodeBytes<KeyType, ValueType, CacheLines * kCacheLineSize>;
+
+#define INDEX_TEMPLATE_ARGUMENTS                                                                             \
+  template <typename KeyType, typename ValueType, int Fanout, typename KeyComparator, typename NodeAllocator, \
+            typename LeafFormat>
+#define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, Fanout, KeyComparator, NodeAllocator, LeafFormat>
+
+/**
+ * Main class providing the API for the Interactive B+ Tree.
+ *
+ * Implementation of simple b+ tree data structure where internal pages direct
+ * the search and leaf pages contain record pointers
+ * (1) We only support (and test) UNIQUE key
+ * (2) Support insert & remove
+ * (3) Support range scan, return multiple values.
+ * (4) The structure should shrink and grow dynamically
+ *
+ * Key type, value type, fanout and key order are template parameters, so every
+ * instantiation is compiled with its own node layout and inlined comparisons.
+ * Nodes come from NodeAllocator (slabs by default), which also lets Clear()
+ * and the destructor drop the whole tree in one go. LeafFormat picks how
+ * leaves store their entries: plain arrays, or PackedLeafFormat for integer
+ * keys with RecordPointer values.
+ */
+template <typename KeyType = int, typename ValueType = RecordPointer,
+          int Fanout = kFanoutForNodeBytes<KeyType, ValueType, kDefaultNodeBytes>,
+          typename KeyComparator = std::less<KeyType>, typename NodeAllocator = SlabNodeAllocator,
+          typename LeafFormat = PlainLeafFormat>
+class BPlusTree {
+  static_assert(Fanout >= 3, "a B+ tree node needs a fanout of at least 3");
+
+ public:
+  static constexpr int MAX_FANOUT = Fanout;
+  using NodeType = Node<KeyType, Fanout>;
+  using InternalNodeType = InternalNode<KeyType, Fanout>;
+  using LeafNodeType = typename LeafFormat::template Leaf<KeyType, ValueType, Fanout>;
+
+  // every internal level at least doubles the number of leaves, so the 2^31
+  // entries that size can count never need more internal levels than this
+  static constexpr int kMaxHeight = 32;
+
+  /**
+   * The internal nodes a descent passed, root first, with the child slot it
+   * took in each. Nodes have no parent pointers, so a writer records the path
+   * on the way down and its splits and merges walk back up it.
+   */
+  struct Path {
+    struct Step {
+      InternalNodeType *node;
+      int slot;
+    };
+    void Push(InternalNodeType *node, int slot) { steps[depth++] = Step{node, slot}; }
+    Step Pop() { return steps[--depth]; }
+    Step &Back() { return steps[depth - 1]; }
+
+    Step steps[kMaxHeight];
+    int depth = 0;
+  };
+
+  std::atomic<int> size;
+  explicit BPlusTree(const KeyComparator &comp = KeyComparator(), NodeAllocator alloc = NodeAllocator())
+      : size(0), comp_(comp), alloc_(std::move(alloc)) {};
+  BPlusTree(const BPlusTree &) = delete;
+  BPlusTree &operator=(const BPlusTree &) = delete;
+  ~BPlusTree() { Clear(); }
+  // Returns true if this B+ tree has no keys and values
+  bool IsEmpty() const;
+
+  // Drop every node and leave an empty tree
+  void Clear();
+
+  // Bytes and node counts held by the node allocator
+  NodeAllocatorStats GetAllocatorStats() const;
+
+  // Switch between single-threaded and thread-safe operation. In thread-safe
+  // mode Insert, Remove, GetValue, MultiGet and RangeScan may run from many
+  // threads at once: readers use optimistic lock coupling, writers latch only
+  // the nodes they change, and unlinked nodes are freed through epochs.
+  // BulkLoad, Clear and the print helpers stay single-threaded, and the
+  // switch itself must not race with any other call. Returns false for key or
+  // value types that are not trivially copyable.
+  bool SetThreadSafe(bool enable);
+  bool IsThreadSafe() const { return concurrent_; }
+
+  // Lazy deletes: Remove leaves a leaf alone until it falls below
+  // kLazyMergeFill of its capacity rather than below half, and keeps the
+  // separators above it when its first key goes, so bursts of deletes that
+  // later inserts refill do not merge and split the same leaves. Compact is
+  // the pass that packs the thinned leaves again, in slices or at once. Like
+  // SetThreadSafe, the switch must not race with any other call.
+  void SetLazyDeletes(bool enable) { lazy_deletes_ = enable; }
+  bool LazyDeletes() const { return lazy_deletes_; }
+
+  // Counters, per-operation latency histograms and sampled hardware counters,
+  // collected when compiled with BPT_STATS=1 (see tree_stats.h)
+  TreeStatsSnapshot GetStats() const { return stats_.Snapshot(); }
+  void ResetStats() { stats_.Reset(); }
+  // Sample cache and branch misses around descents with perf_event_open.
+  // Returns false if the counters cannot be opened or stats are compiled out.
+  bool EnablePerfSampling(bool enable) { return stats_.EnablePerf(enable); }
+  // Pass a snapshot to sink every period from a background thread until
+  // StopStatsDump or destruction. Returns false if stats are compiled out or
+  // a dump is already running.
+  bool StartStatsDump(std::chrono::milliseconds period, StatsDumpSink sink = PrintStatsToStderr) {
+    return stats_.StartDump(period, std::move(sink));
+  }
+  void StopStatsDump() { stats_.StopDump(); }
+
+  // Height, node counts and leaf and internal fill histograms. Walks every
+  // node, so in thread-safe mode it must not run next to writers.
+  TreeShape GetShape() const;
+
+  // Online compaction after delete-heavy phases. Walks the leaf chain from
+  // where the previous call stopped, looking at up to budget leaves, and
+  // repacks runs of adjacent sibling leaves filled below target_fill into
+  // fewer leaves at about that fill; the emptied leaves leave their parent,
+  // whose separators are rewritten, and internal levels rebalance as in
+  // Remove. Calls are bounded slices that can be interleaved with other
+  // operations (and run next to them in thread-safe mode, under the
+  // structure latch for the length of the slice).
+  CompactResult Compact(size_t budget, double target_fill = 0.9);
+
+  // Copy the entries into an immutable snapshot with a pointer-free,
+  // cache-line laid out index (see frozen_b_plus_tree.h). The tree itself is
+  // left as it is; like GetShape this must not run next to writers.
+  FrozenBPlusTree<KeyType, ValueType, KeyComparator> Freeze() const;
+
+  // Insert a key-value pair into this B+ tree.
+  bool Insert(const KeyType &key, const ValueType &value);
+
+  // The status-returning writes below descend the tree once and never print.
+  // kInserted, or kDuplicate with the stored value copied to *existing
+  WriteStatus Insert(const KeyType &key, const ValueType &value, ValueType *existing);
+  // kInserted, or kUpdated with the replaced value copied to *old
+  WriteStatus InsertOrAssign(const KeyType &key, const ValueType &value, ValueType *old = nullptr);
+  // kInserted with value, or kUpdated after update(ValueType &) changed the
+  // stored value. In thread-safe mode update runs under a leaf latch and may
+  // run a second time on a fresh copy, so it should only touch its argument.
+  template <typename Update>
+  WriteStatus Upsert(const KeyType &key, const ValueType &value, Update &&update);
+
+  // Remove a key and its value from this B+ tree.
+  void Remove(const KeyType &key);
+  // kRemoved with the removed value copied to *old, or kNotFound
+  WriteStatus Remove(const KeyType &key, ValueType *old);
+  // remNode and the key at index leave the parent at the end of path
+  void RemoveFromParent(Path &path, NodeType* remNode, int index);
+
+  // return the value associated with a given key
+  bool GetValue(const KeyType &key, ValueType &result);
+
+  // Batched point lookups. Lookups advance through the tree in groups, one
+  // level at a time, prefetching every next child so the cache misses of
+  // independent keys overlap. results must hold at least keys.size() values;
+  // results[i] is written and found[i] set for every key that exists.
+  // Returns the number of keys found.
+  size_t MultiGet(std::span<const KeyType> keys, std::span<ValueType> results, std::vector<bool> &found);
+
+  // return the values within a key range [key_start, key_end) not included key_end,
+  // skipping the first offset of them and stopping after limit
+  void RangeScan(const KeyType &key_start, const KeyType &key_end,
+                 std::vector<ValueType> &result, size_t limit = std::numeric_limits<size_t>::max(),
+                 size_t offset = 0);
+  // RangeScan from the largest key down: the last limit entries before
+  // key_end, after skipping offset of them
+  void ReverseRangeScan(const KeyType &key_start, const KeyType &key_end,
+                        std::vector<ValueType> &result, size_t limit = std::numeric_limits<size_t>::max(),
+                        size_t offset = 0);
+
+  /**
+   * Cursor over the leaf chain, pulling one entry or one batch at a time
+   * instead of materializing the whole range. A forward cursor follows the
+   * next_leaf links and becomes invalid at the end key it was created with;
+   * a reverse cursor follows prev_leaf and becomes invalid below its start
+   * key. Seek() positions it at the boundary before the given key and
+   * SeekPast() at the boundary after it: a forward cursor lands on the first
+   * entry right of the boundary, a reverse one on the last entry left of it.
+   *
+   * A cursor holds a pointer into a leaf: any Insert, Remove, BulkLoad or Clear
+   * invalidates it, and cursors are not available in thread-safe mode (use
+   * ForEach or ReverseForEach there).
+   */
+  class Cursor {
+   public:
+    // Returns Valid()
+    bool Seek(const KeyType &key) { return seek(key, false); }
+    bool SeekPast(const KeyType &key) { return seek(key, true); }
+    bool Valid() const { return leaf_ != nullptr; }
+    // references into the leaf, or decoded copies for packed leaves
+    decltype(auto) Key() const { return leaf_->KeyAt(index_); }
+    decltype(auto) Value() const { return leaf_->ValueAt(index_); }
+    // Returns Valid()
+    bool Next();
+    // Copy values from the current position into out, one leaf slice at a
+    // time, and move past them. Returns the number copied; fewer than
+    // out.size() means the range is exhausted.
+    size_t NextBatch(std::span<ValueType> out);
+    // Move past n entries without reading them, a leaf slice at a time.
+    // Returns the number skipped; fewer than n means the range is exhausted.
+    size_t Skip(size_t n);
+
+   private:
+    friend class BPlusTree;
+    Cursor(BPlusTree* tree, std::optional<KeyType> end, bool reverse = false)
+        : tree_(tree), end_(std::move(end)), reverse_(reverse) {}
+    bool seek(const KeyType &key, bool past);
+    // Step over exhausted leaves and stop at the end key
+    void settle();
+    // Entries of the current leaf from index_ that are still before the end key
+    int sliceEnd() const;
+    // First entry of the current leaf that a reverse cursor still reaches
+    int sliceBegin() const;
+
+    BPlusTree* tree_;
+    LeafNodeType* leaf_ = nullptr;
+    int index_ = 0;
+    // where the cursor stops: the exclusive end key going forward, the
+    // inclusive start key in reverse
+    std::optional<KeyType> end_;
+    bool reverse_;
+  };
+
+  // Cursor over [key_start, key_end), positioned on the first entry
+  Cursor Scan(const KeyType &key_start, const KeyType &key_end);
+  // Cursor over [key_start, key_end) from the largest key down, positioned on
+  // the last entry
+  Cursor ReverseScan(const KeyType &key_start, const KeyType &key_end);
+  // Unbounded cursor positioned on the smallest key
+  Cursor Begin();
+  // Unbounded reverse cursor positioned on the largest key
+  Cursor ReverseBegin();
+  // Unbounded cursors positioned on the first key not less than key
+  // (LowerBound) or greater than key (UpperBound)
+  Cursor LowerBound(const KeyType &key);
+  Cursor UpperBound(const KeyType &key);
+
+  /**
+   * Handle for workloads whose successive keys land close together. It
+   * remembers the leaf its last operation used and the key range that leaf
+   * covers (the separators above it), and serves the next GetValue, Insert
+   * or Remove from that leaf, or from the leaf before or after it, without
+   * descending from the root.
+   *
+   * Splits, merges, borrows and separator updates anywhere in the tree
+   * invalidate every finger, which then descends once and remembers the leaf
+   * it lands in. In thread-safe mode a finger forwards to the tree.
+   */
+  class Finger {
+   public:
+    bool GetValue(const KeyType &key, ValueType &result);
+    bool Insert(const KeyType &key, const ValueType &value);
+    WriteStatus Insert(const KeyType &key, const ValueType &value, ValueType *existing);
+    WriteStatus InsertOrAssign(const KeyType &key, const ValueType &value, ValueType *old = nullptr);
+    WriteStatus Remove(const KeyType &key, ValueType *old = nullptr);
+    const FingerStats &Stats() const { return stats_; }
+    void ResetStats() { stats_ = FingerStats(); }
+
+   private:
+    friend class BPlusTree;
+    explicit Finger(BPlusTree* tree) : tree_(tree) {}
+    // Leaf that key belongs in, nullptr if the tree is empty
+    LeafNodeType* locate(const KeyType &key);
+    bool covers(const KeyType &key) const;
+    static std::optional<KeyType> separatorBeside(const Path &path, bool after);
+    // Move path to the leaf after (before) the one it leads to
+    static void stepPath(Path &path, bool forward);
+
+    BPlusTree* tree_;
+    LeafNodeType* leaf_ = nullptr;
+    // structure_version_ of the tree when leaf_, its path and its bounds were taken
+    uint64_t version_ = 0;
+    Path path_;
+    // the separators around leaf_: it holds the keys in [low_, high_), and
+    // a missing bound is open
+    std::optional<KeyType> low_;
+    std::optional<KeyType> high_;
+    FingerStats stats_;
+  };
+
+  Finger MakeFinger() { return Finger(this); }
+
+  // Call visit(key, value) for every entry in [key_start, key_end) in key
+  // order until it returns false, after skipping the first offset entries
+  // without reading them. Uses constant memory and works in thread-safe
+  // mode. Returns the number of entries visited.
+  template <typename Visitor>
+  size_t ForEach(const KeyType &key_start, const KeyType &key_end, Visitor &&visit, size_t offset = 0);
+  // ForEach from the largest key in the range down
+  template <typename Visitor>
+  size_t ReverseForEach(const KeyType &key_start, const KeyType &key_end, Visitor &&visit, size_t offset = 0);
+
+  /**
+   * Scans of [key_start, key_end) spread over a pool. The range is cut into
+   * sub-ranges at separator keys of the highest internal level with enough
+   * of them inside the range (partitions of them, by default four per pool
+   * thread), and every sub-range is one pool task running ForEach, so the
+   * pool's work stealing evens out partitions of different sizes.
+   *
+   * Outside thread-safe mode no writer may run at the same time.
+   */
+  // key_start, the cut keys in increasing order, key_end; at most partitions
+  // sub-ranges, fewer if the upper levels have too few separators
+  std::vector<KeyType> PartitionRange(const KeyType &key_start, const KeyType &key_end, size_t partitions);
+  // out[p] gets the values of sub-range p in key order, so out concatenated is
+  // what RangeScan returns. Returns the number of values.
+  size_t ParallelRangeScan(const KeyType &key_start, const KeyType &key_end, WorkStealingPool &pool,
+                           std::vector<std::vector<ValueType>> &out, size_t partitions = 0);
+  // Every sub-range folds its entries into a copy of init with
+  // accumulate(Result &, key, value); the partial results are then folded
+  // into init with combine(Result &, const Result &) in key order.
+  template <typename Result, typename Accumulate, typename Combine>
+  Result ParallelReduce(const KeyType &key_start, const KeyType &key_end, WorkStealingPool &pool, Result init,
+                        Accumulate &&accumulate, Combine &&combine, size_t partitions = 0);
+
+  // Replace the contents with (key, value) pairs given in strictly increasing
+  // key order, filling each node to fill_factor of its capacity. Returns false
+  // and leaves the tree empty if the input is unsorted or has duplicates.
+  template <typename Iterator>
+  bool BulkLoad(Iterator first, Iterator last, double fill_factor = 1.0);
+  template <typename Range>
+  bool BulkLoad(const Range &entries, double fill_factor = 1.0) {
+    return BulkLoad(std::begin(entries), std::end(entries), fill_factor);
+  }
+  // BulkLoad for entries in any order, built on pool: a parallel sample sort,
+  // duplicate keys dropped in parallel (the first in input order stays, as it
+  // would with one Insert after another), leaves filled and linked in
+  // parallel, then the internal levels bottom up. The tree gets the shape
+  // BulkLoad gives the sorted entries. Returns the number of entries kept.
+  size_t ParallelBulkLoad(std::vector<std::pair<KeyType, ValueType>> entries, WorkStealingPool &pool,
+                          double fill_factor = 1.0);
+  NodeType* findNode(NodeType* startNode, const KeyType &key);
+  // path leads to c, in case c has to be replaced
+  NodeType* insertIntoLeaf(NodeType* c,int index,const KeyType &key, const ValueType &value, Path &path);
+  // newNode goes right after parent, in the node at the end of path; append
+  // when the split began with an append to the last leaf
+  bool InsertIntoParent(Path &path,NodeType* parent,NodeType* newNode,const KeyType &kPrime,bool append);
+  void printRoot();
+  void printNode(NodeType* node);
+  static KeyType keyAt(NodeType* node, int i);
+  void printTreeSize() const;
+  void removeKeyFromParent(const Path &path,KeyType const &key,KeyType const &newKey);
+ private:
+  bool keyEqual(const KeyType &a, const KeyType &b) const { return !comp_(a, b) && !comp_(b, a); }
+  // a truncated separator is only known to sort right under the key type's own order
+  KeyType separatorKey(const KeyType &left, const KeyType &right) const {
+    if constexpr(std::is_same_v<KeyComparator, std::less<KeyType>>) return SeparatorKey(left, right);
+    else return right;
+  }
+  LeafNodeType* newLeaf(const KeyType* keys, const ValueType* values, int n);
+  LeafNodeType* allocLeaf(const typename LeafNodeType::Layout &layout);
+  InternalNodeType* newInternal();
+  static int copyLeaf(const LeafNodeType* leaf, KeyType* keys, ValueType* values);
+  // path leads to leaf
+  LeafNodeType* rebuildLeaf(LeafNodeType* leaf, const KeyType* keys, const ValueType* values, int n, Path &path);
+  void replaceLeaf(LeafNodeType* old, LeafNodeType* fresh, Path &path);
+  void setLeafValue(LeafNodeType* leaf, int index, const ValueType &value, Path &path);
+  // onExisting(ValueType &stored) returns true to write the changed value back;
+  // leaf, if given, is the leaf key belongs in and path, if given, leads to it
+  template <typename OnExisting>
+  WriteStatus insertEntry(const KeyType &key, const ValueType &value, OnExisting &&onExisting,
+                          LeafNodeType* leaf = nullptr, Path* path = nullptr);
+  WriteStatus removeEntry(const KeyType &key, ValueType* old, LeafNodeType* leaf, Path* path);
+  // findNode from the root that records the path to the leaf
+  LeafNodeType* findLeaf(const KeyType &key, Path &path);
+  // quiescent: no other thread can reach the node, so skip the epoch delay
+  void freeNode(NodeType* node, bool quiescent = false);
+  void releaseNode(NodeType* node);
+  void freeSubtree(NodeType* node);
+  static void prefetchNode(const NodeType* node);
+  static int fillTarget(double fill_factor, int capacity, int minimum);
+  static int leafTailSplit(int total);
+  void buildUpperLevels(std::vector<NodeType*> &level, std::vector<KeyType> &lowKeys, double fill_factor);
+  void sortUnique(std::vector<std::pair<KeyType, ValueType>> &entries, WorkStealingPool &pool, std::vector<KeyType> &keys,
+                  std::vector<ValueType> &values);
+  NodeType* leftmostLeaf() const;
+  NodeType* rightmostLeaf() const;
+  // ForEach and ReverseForEach
+  template <typename Visitor>
+  size_t forEachEntry(const KeyType &key_start, const KeyType &key_end, Visitor &visit, size_t offset, bool reverse);
+  // the last leaf if key sorts after every key in the tree, else nullptr
+  LeafNodeType* appendLeaf(const KeyType &key);
+  // every step of path takes the last child
+  static bool onRightEdge(const Path &path);
+  // fewest keys a non-root leaf keeps before Remove rebalances it
+  int leafUnderflow() const { return lazy_deletes_ ? kLazyMinKeys : MAX_FANOUT/2; }
+
+  // thread-safe mode
+  class StructureLatch;
+  NodeType* loadRoot() const { return __atomic_load_n(&root, __ATOMIC_ACQUIRE); }
+  void setRoot(NodeType* node) {
+    structure_version_++;
+    __atomic_store_n(&root, node, __ATOMIC_RELEASE);
+  }
+  static int clampKeyNum(const NodeType* node);
+  bool descendOptimistic(const KeyType &key, NodeType* &leaf, uint64_t &version);
+  bool getValueOptimistic(const KeyType &key, ValueType &result);
+  template <typename Visitor>
+  size_t forEachOptimistic(const KeyType &key_start, const KeyType &key_end, Visitor &visit, size_t offset,
+                           bool reverse);
+  // nullopt: the write needs the structure latch
+  template <typename OnExisting>
+  std::optional<WriteStatus> insertOptimistic(const KeyType &key, const ValueType &value, OnExisting &onExisting);
+  std::optional<WriteStatus> removeOptimistic(const KeyType &key, ValueType* old);
+  void latchNode(NodeType* node);
+  void releaseLatches();
+  void reclaimRetired(bool everything);
+
+  // lookups kept in flight together by MultiGet
+  static constexpr int kMultiGetGroup = 16;
+  // cache lines of a node requested ahead of the search in it
+  static constexpr size_t kPrefetchLines = 4;
+  // fill left behind in the last leaf when an append splits it; the slack
+  // takes keys that arrive slightly out of order without another split
+  static constexpr double kAppendSplitFill = 0.9;
+  // most sibling leaves Compact repacks together
+  static constexpr int kCompactRun = 8;
+  // leaf fill below which a lazy Remove rebalances
+  static constexpr double kLazyMergeFill = 0.125;
+  static constexpr int kLazyMinKeys = std::max(1, static_cast<int>(kLazyMergeFill*(MAX_FANOUT-1)));
+  // pool tasks per thread of parallel scans and builds, so stealing can
+  // even out tasks of different length
+  static constexpr size_t kTasksPerThread = 4;
+  // fewest entries worth a task of their own in ParallelBulkLoad
+  static constexpr size_t kParallelTaskEntries = 1 << 14;
+  // keys sampled per bucket to pick the sample sort's splitters
+  static constexpr size_t kSortSamplesPerBucket = 64;
+
+  // pointer to the root node.
+  NodeType *root = nullptr;
+  KeyComparator comp_;
+  NodeAllocator alloc_;
+  size_t leaf_count_ = 0;
+  size_t internal_count_ = 0;
+  // last leaf, kept for appends in single-threaded mode; freeNode clears it,
+  // and a split leaves it behind, which appendLeaf sees from next_leaf
+  LeafNodeType* last_leaf_ = nullptr;
+  // first key of the leaf the next Compact call starts from
+  std::optional<KeyType> compact_from_;
+  // bumped whenever a node is freed or a separator or the root changes,
+  // which is what stales the leaves and bounds fingers remember
+  uint64_t structure_version_ = 0;
+
+  bool concurrent_ = false;
+  bool lazy_deletes_ = false;
+  // serializes structure modifications: splits, merges, borrows, new roots
+  std::mutex structure_mutex_;
+  std::unique_ptr<EpochManager> epoch_;
+  // nodes write-latched by the structure modification in progress
+  std::vector<NodeType*> latched_;
+  // unlinked nodes and the epoch they were unlinked in
+  std::vector<std::pair<uint64_t, NodeType*>> retired_;
+  // empty unless BPT_STATS is set
+  [[no_unique_address]] TreeStats stats_;
+};
+
+// B+ tree with compressed leaves, see PackedLeafNode
+template <typename KeyType = int, int Fanout = kFanoutForNodeBytes<KeyType, RecordPointer, kDefaultNodeBytes>,
+          typename NodeAllocator = SlabNodeAllocator>
+using PackedBPlusTree = BPlusTree<KeyType, RecordPointer, Fanout, std::less<KeyType>, NodeAllocator, PackedLeafFormat>;
+
+// B+ tree keyed by variable-length strings, see StringLeafNode
+template <typename ValueType = RecordPointer, int Fanout = 64, typename NodeAllocator = SlabNodeAllocator>
+using StringBPlusTree = BPlusTree<StringKey, ValueType, Fanout, std::less<StringKey>, NodeAllocator, StringLeafFormat>;
+
+// the configuration para.h used to hard-wire, compiled once in b_plus_tree.cpp
+extern template class BPlusTree<int, RecordPointer>;
+
+#include "b_plus_tree_impl.h"
@@ -0,0 +1,2568 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/b_plus_tree_impl.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+// Member definitions of the BPlusTree template, included by b_plus_tree.h.
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <type_traits>
+
+/*
+ * Helper function to decide whether current b+tree is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsEmpty() const { return(size==0); }
+
+/*
+ * Drop every node of the tree. With a slab allocator the slabs are handed back
+ * as a whole instead of visiting each node.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Clear()
+{
+  reclaimRetired(true);
+  if constexpr(NodeAllocator::kBulkRelease && std::is_trivially_destructible_v<KeyType> &&
+               std::is_trivially_destructible_v<ValueType>)
+  {
+    alloc_.Reset();
+  }
+  else
+  {
+    freeSubtree(root);
+  }
+  setRoot(nullptr);
+  size = 0;
+  leaf_count_ = 0;
+  internal_count_ = 0;
+  compact_from_.reset();
+  last_leaf_ = nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+NodeAllocatorStats BPLUSTREE_TYPE::GetAllocatorStats() const
+{
+  NodeAllocatorStats stats = alloc_.Stats();
+  stats.leaf_nodes = leaf_count_;
+  stats.internal_nodes = internal_count_;
+  return stats;
+}
+
+/*
+ * Helper functions to get nodes from and return them to the allocator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::LeafNodeType* BPLUSTREE_TYPE::newLeaf(const KeyType* keys, const ValueType* values, int n)
+{
+  // packed leaves are sized for the entries they start with
+  LeafNodeType* leaf = allocLeaf(LeafNodeType::LayoutFor(keys,values,n));
+  leaf->Assign(keys,values,n);
+  return leaf;
+}
+
+/*
+ * Helper function to get an empty leaf laid out for layout
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::LeafNodeType* BPLUSTREE_TYPE::allocLeaf(const typename LeafNodeType::Layout &layout)
+{
+  leaf_count_++;
+  if constexpr(LeafNodeType::kFixedSize)
+  {
+    return alloc_.template New<LeafNodeType>();
+  }
+  else
+  {
+    return alloc_.template NewBytes<LeafNodeType>(LeafNodeType::BytesFor(layout),layout);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::InternalNodeType* BPLUSTREE_TYPE::newInternal()
+{
+  internal_count_++;
+  return alloc_.template New<InternalNodeType>();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::freeNode(NodeType* node, bool quiescent)
+{
+  if(node==last_leaf_) last_leaf_ = nullptr;
+  structure_version_++;
+  if(node->is_leaf) leaf_count_--;
+  else internal_count_--;
+  if(concurrent_ && !quiescent)
+  {
+    // readers may still be inside the node, free it once their epoch is over
+    latchNode(node);
+    node->latch.MarkObsolete();
+    retired_.emplace_back(epoch_->Current(),node);
+    return;
+  }
+  releaseNode(node);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::releaseNode(NodeType* node)
+{
+  if(!node->is_leaf) alloc_.Delete(static_cast<InternalNodeType*>(node));
+  else if constexpr(LeafNodeType::kFixedSize) alloc_.Delete(static_cast<LeafNodeType*>(node));
+  else
+  {
+    LeafNodeType* leaf = static_cast<LeafNodeType*>(node);
+    alloc_.DeleteBytes(leaf,leaf->AllocatedBytes());
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::freeSubtree(NodeType* node)
+{
+  if(node==nullptr) return;
+  if(!node->is_leaf)
+  {
+    InternalNodeType* nodePtr = static_cast<InternalNodeType*>(node);
+    for(int i=0;i<node->key_num+1;i++)
+    {
+      freeSubtree(nodePtr->children[i]);
+    }
+  }
+  freeNode(node,true);
+}
+
+/*
+ * Helper function to print tree size
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::printTreeSize() const
+{
+  std::cout<<"Tree size: "<<size<<"\n";
+}
+
+/*
+ * Helper function to print the root contents
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::printRoot()
+{
+  std::cout<<"Printing Root\n";
+  printNode(root);
+  return;
+}
+
+/*
+ * Helper function to print the node contents
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::printNode(NodeType* node)
+{
+  if(node==nullptr or size==0)
+  {
+    std::cout<<"Null pointer\n";
+    return;
+  }
+  if(node->key_num==0)
+  {
+    std::cout<<"Empty node\n";
+    return;
+  }
+  std::cout<<"Printing keys: "<<"\n";
+  for(int i=0;i<node->key_num;i++)
+  {
+    std::cout<<i+1<<" "<<keyAt(node,i)<<"\n";
+  }
+  if(!node->is_leaf)
+  {
+    InternalNodeType* nodePtr = static_cast<InternalNodeType*>(node);
+    std::cout<<"Printing 1st key of each child: "<<"\n";
+    for(int i=0;i<node->key_num+1;i++)
+    {
+      std::cout<<i+1<<" "<<keyAt(nodePtr->children[i],0)<<"\n";
+    }
+  }
+  return;
+}
+
+/*
+ * Helper function to read a key of either node type, for printing
+ */
+INDEX_TEMPLATE_ARGUMENTS
+KeyType BPLUSTREE_TYPE::keyAt(NodeType* node, int i)
+{
+  if(node->is_leaf) return static_cast<LeafNodeType*>(node)->KeyAt(i);
+  return static_cast<InternalNodeType*>(node)->keys[i];
+}
+
+/*
+ * Helper function to insert the key value pair in the leaf node at
+ * insertIndex, the position the caller's search found for key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::NodeType* BPLUSTREE_TYPE::insertIntoLeaf(NodeType* c,int insertIndex,const KeyType &key, const ValueType &value,
+                                                                    Path &path)
+ {
+   LeafNodeType* leaf = static_cast<LeafNodeType*>(c);
+   if(leaf->Fits(key,value))
+   {
+     leaf->InsertAt(insertIndex,key,value);
+     return leaf;
+   }
+   // the entry is outside what a packed leaf's columns can encode, so the
+   // leaf moves to a wider allocation
+   KeyType key_copy[MAX_FANOUT];
+   ValueType pointer_copy[MAX_FANOUT];
+   int len = copyLeaf(leaf,key_copy,pointer_copy);
+   for(int i=len;i>insertIndex;i--)
+   {
+     key_copy[i] = key_copy[i-1];
+     pointer_copy[i] = pointer_copy[i-1];
+   }
+   key_copy[insertIndex] = key;
+   pointer_copy[insertIndex] = value;
+   return rebuildLeaf(leaf,key_copy,pointer_copy,len+1,path);
+ }
+
+/*
+ * Helper function to copy the entries of a leaf into plain arrays
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::copyLeaf(const LeafNodeType* leaf, KeyType* keys, ValueType* values)
+{
+  for(int i=0;i<leaf->key_num;i++)
+  {
+    keys[i] = leaf->KeyAt(i);
+  }
+  leaf->CopyValues(0,leaf->key_num,values);
+  return leaf->key_num;
+}
+
+/*
+ * Helper function to replace the entries of a leaf. If the leaf's layout
+ * cannot hold them, a new leaf takes its place in the tree and is returned.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::LeafNodeType* BPLUSTREE_TYPE::rebuildLeaf(LeafNodeType* leaf, const KeyType* keys, const ValueType* values, int n,
+                                                                   Path &path)
+{
+  if(leaf->CanHold(LeafNodeType::LayoutFor(keys,values,n)))
+  {
+    leaf->Assign(keys,values,n);
+    return leaf;
+  }
+  LeafNodeType* fresh = newLeaf(keys,values,n);
+  replaceLeaf(leaf,fresh,path);
+  return fresh;
+}
+
+/*
+ * Helper function to put fresh where old is: the slot path ends in, leaf
+ * chain and root. old is freed (retired in thread-safe mode).
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::replaceLeaf(LeafNodeType* old, LeafNodeType* fresh, Path &path)
+{
+  stats_.Count(TreeCounter::kLeafReplacements);
+  latchNode(old);
+  latchNode(fresh);
+  fresh->prev_leaf = old->prev_leaf;
+  fresh->next_leaf = old->next_leaf;
+  if(fresh->prev_leaf!=nullptr)
+  {
+    latchNode(fresh->prev_leaf);
+    fresh->prev_leaf->next_leaf = fresh;
+  }
+  if(fresh->next_leaf!=nullptr)
+  {
+    latchNode(fresh->next_leaf);
+    fresh->next_leaf->prev_leaf = fresh;
+  }
+  if(path.depth==0)
+  {
+    setRoot(fresh);
+  }
+  else
+  {
+    latchNode(path.Back().node);
+    path.Back().node->children[path.Back().slot] = fresh;
+  }
+  freeNode(old);
+}
+
+/*
+ * Helper function to overwrite the value of entry index. A packed leaf whose
+ * columns cannot encode the value moves to a wider allocation.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::setLeafValue(LeafNodeType* leaf, int index, const ValueType &value, Path &path)
+{
+  if(leaf->SetValueAt(index,value)) return;
+  KeyType key_copy[MAX_FANOUT];
+  ValueType pointer_copy[MAX_FANOUT];
+  int len = copyLeaf(leaf,key_copy,pointer_copy);
+  pointer_copy[index] = value;
+  rebuildLeaf(leaf,key_copy,pointer_copy,len,path);
+}
+
+/*
+ * Helper function for the append fast path: an insert whose key sorts after
+ * the last key of the last leaf goes there without a descent
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::LeafNodeType* BPLUSTREE_TYPE::appendLeaf(const KeyType &key)
+{
+  if(concurrent_) return nullptr;
+  if(last_leaf_==nullptr || last_leaf_->next_leaf!=nullptr)
+  {
+    last_leaf_ = static_cast<LeafNodeType*>(rightmostLeaf());
+  }
+  if(last_leaf_->key_num==0 || !comp_(last_leaf_->KeyAt(last_leaf_->key_num-1),key)) return nullptr;
+  return last_leaf_;
+}
+
+/*
+ * Helper function to tell whether the node path leads to is the last child of
+ * its parent, its parent the last child of the grandparent, and so on up to
+ * the root
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::onRightEdge(const Path &path)
+{
+  for(int i=0;i<path.depth;i++)
+  {
+    if(path.steps[i].slot!=path.steps[i].node->key_num) return false;
+  }
+  return true;
+}
+
+ /*
+  * Helper function to traverse the BPlusTree and find the node corresponding to key
+  */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::NodeType* BPLUSTREE_TYPE::findNode(NodeType* startNode, const KeyType &key)
+{
+  if(startNode==nullptr or size==0)
+  {
+    return nullptr;
+  }
+  [[maybe_unused]] auto probe = stats_.ProbeDescent();
+  NodeType*c = startNode;
+  int levels = 0;
+  while(!c->is_leaf)
+  {
+    InternalNodeType* nodePtr = static_cast<InternalNodeType*>(c);
+    c = nodePtr->children[NodeUpperBound(nodePtr->keys, c->key_num, key, comp_)];
+    levels++;
+  }
+  stats_.CountDescent(levels);
+  return c;
+}
+
+/*
+ * Helper function to find the leaf for key like findNode, pushing every
+ * internal node on the way and the slot taken in it onto path
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::LeafNodeType* BPLUSTREE_TYPE::findLeaf(const KeyType &key, Path &path)
+{
+  path.depth = 0;
+  if(root==nullptr || size==0) return nullptr;
+  [[maybe_unused]] auto probe = stats_.ProbeDescent();
+  NodeType* c = root;
+  int levels = 0;
+  while(!c->is_leaf)
+  {
+    InternalNodeType* nodePtr = static_cast<InternalNodeType*>(c);
+    int i = NodeUpperBound(nodePtr->keys, c->key_num, key, comp_);
+    path.Push(nodePtr,i);
+    c = nodePtr->children[i];
+    levels++;
+  }
+  stats_.CountDescent(levels);
+  return static_cast<LeafNodeType*>(c);
+}
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+/*
+ * Return the only value that associated with input key
+ * This method is used for point query
+ * @return : true means key exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::GetValue(const KeyType &key, ValueType &result)
+{
+  [[maybe_unused]] auto timer = stats_.Time(TreeOp::kGetValue);
+  if(concurrent_) return getValueOptimistic(key,result);
+  if(IsEmpty()) return false;
+  LeafNodeType* leaf = static_cast<LeafNodeType*>(findNode(root,key));
+  int i = leaf->LowerBound(leaf->key_num, key, comp_);
+  if(i<leaf->key_num && leaf->KeyEquals(i,key,comp_))
+  {
+    result = leaf->ValueAt(i);
+    //std::cout<<"Key found: "<<key<<"\n";
+    return true;
+  }
+  //std::cout<<"Key not found: "<<key<<"\n";
+  return false;
+}
+
+/*
+ * Batched point query. Each group of kMultiGetGroup lookups descends level by
+ * level: the child for every key is located and prefetched before any of them
+ * is touched, so one key's miss is hidden behind the searches of the others.
+ * All leaves sit at the same depth, so a group reaches them together.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::MultiGet(std::span<const KeyType> keys, std::span<ValueType> results, std::vector<bool> &found)
+{
+  [[maybe_unused]] auto timer = stats_.Time(TreeOp::kMultiGet);
+  assert(results.size()>=keys.size());
+  found.assign(keys.size(),false);
+  if(concurrent_)
+  {
+    size_t hits = 0;
+    for(size_t i=0;i<keys.size();i++)
+    {
+      if(getValueOptimistic(keys[i],results[i]))
+      {
+        found[i] = true;
+        hits++;
+      }
+    }
+    return hits;
+  }
+  if(IsEmpty()) return 0;
+
+  size_t hits = 0;
+  NodeType* group[kMultiGetGroup];
+  for(size_t base=0;base<keys.size();base+=kMultiGetGroup)
+  {
+    int len = static_cast<int>(std::min<size_t>(kMultiGetGroup,keys.size()-base));
+    for(int i=0;i<len;i++)
+    {
+      group[i] = root;
+    }
+    int levels = 0;
+    while(!group[0]->is_leaf)
+    {
+      for(int i=0;i<len;i++)
+      {
+        InternalNodeType* nodePtr = static_cast<InternalNodeType*>(group[i]);
+        group[i] = nodePtr->children[NodeUpperBound(nodePtr->keys, nodePtr->key_num, keys[base+i], comp_)];
+        prefetchNode(group[i]);
+      }
+      levels++;
+    }
+    for(int i=0;i<len;i++)
+    {
+      stats_.CountDescent(levels);
+    }
+    for(int i=0;i<len;i++)
+    {
+      LeafNodeType* leaf = static_cast<LeafNodeType*>(group[i]);
+      int slot = leaf->LowerBound(leaf->key_num, keys[base+i], comp_);
+      if(slot<leaf->key_num && leaf->KeyEquals(slot,keys[base+i],comp_))
+      {
+        results[base+i] = leaf->ValueAt(slot);
+        found[base+i] = true;
+        hits++;
+      }
+    }
+  }
+  return hits;
+}
+
+/*
+ * Helper function to pull the first cache lines of a node towards the core.
+ * The node must not be read here, its type is not known before it arrives.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::prefetchNode(const NodeType* node)
+{
+  const char* bytes = reinterpret_cast<const char*>(node);
+  constexpr size_t nodeBytes = std::max(sizeof(LeafNodeType),sizeof(InternalNodeType));
+  constexpr size_t lines = std::min(kPrefetchLines,(nodeBytes+kCacheLineSize-1)/kCacheLineSize);
+  for(size_t i=0;i<lines;i++)
+  {
+    __builtin_prefetch(bytes+i*kCacheLineSize);
+  }
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * Insert constant key & value pair into b+ tree
+ * If current tree is empty, start new tree, otherwise insert into leaf Node.
+ * @return: since we only support unique key, if user try to insert duplicate
+ * keys return false, otherwise return true.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value)
+{
+  return Insert(key,value,nullptr)==WriteStatus::kInserted;
+}
+
+/*
+ * Insert that reports a duplicate key and the value stored under it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+WriteStatus BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, ValueType* existing)
+{
+  return insertEntry(key,value,[existing](ValueType &stored)
+  {
+    if(existing!=nullptr) *existing = stored;
+    return false;
+  });
+}
+
+/*
+ * Insert, or replace the value of a key that is already there
+ */
+INDEX_TEMPLATE_ARGUMENTS
+WriteStatus BPLUSTREE_TYPE::InsertOrAssign(const KeyType &key, const ValueType &value, ValueType* old)
+{
+  return insertEntry(key,value,[&](ValueType &stored)
+  {
+    if(old!=nullptr) *old = stored;
+    stored = value;
+    return true;
+  });
+}
+
+/*
+ * Insert, or let update change the value of a key that is already there
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename Update>
+WriteStatus BPLUSTREE_TYPE::Upsert(const KeyType &key, const ValueType &value, Update &&update)
+{
+  return insertEntry(key,value,[&](ValueType &stored)
+  {
+    update(stored);
+    return true;
+  });
+}
+
+/*
+ * Helper function behind every insert. One descent finds the leaf and the
+ * position of key in it; a present key goes to onExisting with a copy of its
+ * value, anything else is inserted at that position, splitting a full leaf.
+ * An append that skipped the descent takes one only when it needs the path.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename OnExisting>
+WriteStatus BPLUSTREE_TYPE::insertEntry(const KeyType &key, const ValueType &value, OnExisting &&onExisting,
+                                        LeafNodeType* leaf, Path* path)
+{
+  [[maybe_unused]] auto timer = stats_.Time(TreeOp::kInsert);
+  std::optional<StructureLatch> smo;
+  if(concurrent_)
+  {
+    // most inserts only touch one leaf, the rest serialize on the structure latch
+    std::optional<WriteStatus> fast = insertOptimistic(key,value,onExisting);
+    if(fast) return *fast;
+    smo.emplace(this);
+  }
+
+  if(IsEmpty())
+  {
+      LeafNodeType* L = newLeaf(&key,&value,1);
+      latchNode(L);
+      size+=1;
+      setRoot(L);
+      return WriteStatus::kInserted;
+  }
+  Path descent;
+  NodeType* c = leaf;
+  if(c==nullptr)
+  {
+    path = nullptr;
+    c = appendLeaf(key);
+    if(c!=nullptr)
+    {
+      stats_.Count(TreeCounter::kAppends);
+    }
+    else
+    {
+      c = findLeaf(key,descent);
+      path = &descent;
+    }
+    leaf = static_cast<LeafNodeType*>(c);
+  }
+  auto pathToLeaf = [&]() -> Path&
+  {
+    if(path==nullptr)
+    {
+      findLeaf(key,descent);
+      path = &descent;
+    }
+    return *path;
+  };
+  latchNode(c);
+  int insertIndex = leaf->LowerBound(c->key_num, key, comp_);
+  if(insertIndex<c->key_num && leaf->KeyEquals(insertIndex,key,comp_))
+  {
+    ValueType stored = leaf->ValueAt(insertIndex);
+    if(!onExisting(stored)) return WriteStatus::kDuplicate;
+    setLeafValue(leaf,insertIndex,stored,pathToLeaf());
+    return WriteStatus::kUpdated;
+  }
+  if(c->key_num<MAX_FANOUT-1)
+  {
+    // only an entry the leaf cannot encode replaces it
+    if(leaf->Fits(key,value)) leaf->InsertAt(insertIndex,key,value);
+    else insertIntoLeaf(c,insertIndex,key,value,pathToLeaf());
+    size+=1;
+    return WriteStatus::kInserted;
+  }
+
+  stats_.Count(TreeCounter::kLeafSplits);
+  KeyType key_copy[MAX_FANOUT];
+  ValueType pointer_copy[MAX_FANOUT];
+  int len = copyLeaf(leaf,key_copy,pointer_copy);
+  for(int i=len;i>insertIndex;i--)
+  {
+    key_copy[i] = key_copy[i-1];
+    pointer_copy[i] = pointer_copy[i-1];
+  }
+  key_copy[insertIndex] = key;
+  pointer_copy[insertIndex] = value;
+  // appending to the last leaf keeps it kAppendSplitFill full and moves only
+  // the rest on, so ascending inserts leave leaves nearly full, not half
+  bool append = insertIndex==len && leaf->next_leaf==nullptr;
+  int leftNum = append ? fillTarget(kAppendSplitFill,MAX_FANOUT-1,MAX_FANOUT/2) : MAX_FANOUT/2;
+  int rightNum = MAX_FANOUT-leftNum;
+
+  // the left half stays in c unless its packed columns have to widen
+  Path &leafPath = pathToLeaf();
+  LeafNodeType* nodePtr = rebuildLeaf(leaf,key_copy,pointer_copy,leftNum,leafPath);
+  c = nodePtr;
+  LeafNodeType* newNodePtr = newLeaf(key_copy+leftNum,pointer_copy+leftNum,rightNum);
+  latchNode(newNodePtr);
+  NodeType* newNode = newNodePtr;
+
+  newNodePtr->next_leaf = nodePtr->next_leaf;
+  newNodePtr->prev_leaf = nodePtr;
+  if(newNodePtr->next_leaf!=nullptr)
+  {
+    latchNode(newNodePtr->next_leaf);
+    newNodePtr->next_leaf->prev_leaf = newNodePtr;
+  }
+  nodePtr->next_leaf = newNodePtr;
+  if(newNodePtr->next_leaf==nullptr && !concurrent_) last_leaf_ = newNodePtr;
+  KeyType kPrime = separatorKey(key_copy[leftNum-1],key_copy[leftNum]);
+  if(!InsertIntoParent(leafPath,c,newNode,kPrime,append))
+  {
+    BPT_DIAGNOSTIC("Failed to link the split leaf for key "<<key);
+  }
+  size+=1;
+  return WriteStatus::kInserted;
+}
+
+/*
+ * Helper function to link new child to parent, taking the steps it walks up
+ * off path; append tells whether the split below was an append to the last leaf
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::InsertIntoParent(Path &path,NodeType* parent,NodeType* child,const KeyType &kPrime,bool append)
+{
+  structure_version_++;
+  if(path.depth==0)
+  {
+    stats_.Count(TreeCounter::kRootSplits);
+    NodeType* newRoot = newInternal();
+    latchNode(newRoot);
+    InternalNodeType* newRootPtr = static_cast<InternalNodeType*>(newRoot);
+    newRootPtr->children[0] = parent;
+    newRootPtr->children[1] = child;
+    newRootPtr->keys[0] = kPrime;
+    newRoot->key_num+=1;
+    setRoot(newRoot);
+    return true;
+  }
+  else{
+    parent = path.Pop().node;
+    latchNode(parent);
+    if(parent->key_num<MAX_FANOUT-1)
+    {
+          InternalNodeType* parentPtr = static_cast<InternalNodeType*>(parent);
+          int insertIndex = NodeUpperBound(parentPtr->keys, parent->key_num, kPrime, comp_);
+          int len = parent->key_num;
+          for(int j=parent->key_num;j>insertIndex;j--)
+          {
+            parentPtr->keys[j] = parentPtr->keys[j-1];
+          }
+          for(int j=len+1;j>insertIndex+1;j--)
+          {
+            parentPtr->children[j] = parentPtr->children[j-1];
+          }
+          parentPtr->keys[insertIndex] = kPrime;
+          parentPtr->children[insertIndex+1] = child;
+          parent->key_num+=1;
+          return true;
+    }
+    else
+    {
+          stats_.Count(TreeCounter::kInternalSplits);
+          NodeType* newNode = newInternal();
+          latchNode(newNode);
+          InternalNodeType* parentPtr = static_cast<InternalNodeType*>(parent);
+          KeyType key_copy[MAX_FANOUT];
+          for(int i=0;i<parent->key_num;i++)
+          {
+            key_copy[i] = parentPtr->keys[i];
+          }
+          int len = parent->key_num;
+          int insertIndex = NodeUpperBound(parentPtr->keys, parent->key_num, kPrime, comp_);
+
+          for(int j=len;j>insertIndex;j--)
+          {
+            key_copy[j] = key_copy[j-1];
+          }
+
+          key_copy[insertIndex] = kPrime;
+          NodeType* child_copy[MAX_FANOUT+1];
+          for(int i=0;i<parent->key_num+1;i++)
+          {
+            child_copy[i] = parentPtr->children[i];
+          }
+          for(int j=len+1;j>insertIndex+1;j--)
+          {
+            child_copy[j] = child_copy[j-1];
+          }
+          child_copy[insertIndex+1] = child;
+
+
+          // a split that started as a leaf append leaves the right-edge node
+          // full and moves only the last key and two children out, as leaf
+          // appends do; any other split halves it
+          if(append && insertIndex==len && onRightEdge(path))
+          {
+            parent->key_num = MAX_FANOUT-2;
+          }
+          else
+          {
+            parent->key_num = MAX_FANOUT/2;
+          }
+          newNode->key_num = MAX_FANOUT-1-parent->key_num;
+
+          for(int i=0;i<parent->key_num;i++)
+          {
+            parentPtr->keys[i] = key_copy[i];
+            parentPtr->children[i] = child_copy[i];
+          }
+          parentPtr->children[parent->key_num] = child_copy[parent->key_num];
+          KeyType kDoublePrime = key_copy[parent->key_num];
+
+          InternalNodeType* newNodePtr = static_cast<InternalNodeType*>(newNode);
+          for(int j=0;j<newNode->key_num;j++)
+          {
+            newNodePtr->keys[j] = key_copy[parent->key_num+j+1];
+            newNodePtr->children[j] = child_copy[parent->key_num+j+1];
+          }
+          newNodePtr->children[newNode->key_num] = child_copy[newNode->key_num+parent->key_num+1];
+          if(InsertIntoParent(path,parent,newNode,kDoublePrime,append))
+          {
+            return true;
+          }
+
+    }
+  }
+  return false;
+}
+/*
+ * Helper function to remove key from Internal Nodes after deleted from leaf node
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::removeKeyFromParent(const Path &path,KeyType const &key,KeyType const &newKey)
+{
+  for(int d=path.depth-1;d>=0;d--)
+  {
+    InternalNodeType* currPtr = path.steps[d].node;
+    int i = NodeLowerBound(currPtr->keys, currPtr->key_num, key, comp_);
+    if(i<currPtr->key_num && keyEqual(currPtr->keys[i],key))
+    {
+      latchNode(currPtr);
+      structure_version_++;
+      currPtr->keys[i]=newKey;
+      return;
+    }
+  }
+
+  return;
+}
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+/*
+ * Delete key & value pair associated with input key
+ * If current tree is empty, return immdiately.
+ * If not, User needs to first find the right leaf node as deletion target, then
+ * delete entry from leaf node. Remember to deal with redistribute or merge if
+ * necessary.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Remove(const KeyType &key)
+{
+  Remove(key,nullptr);
+}
+
+/*
+ * Remove that reports whether the key was there and the value it had
+ */
+INDEX_TEMPLATE_ARGUMENTS
+WriteStatus BPLUSTREE_TYPE::Remove(const KeyType &key, ValueType* old)
+{
+  return removeEntry(key,old,nullptr,nullptr);
+}
+
+/*
+ * Helper function behind Remove; leaf, if given, is the leaf key belongs in
+ * and path the descent that reached it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+WriteStatus BPLUSTREE_TYPE::removeEntry(const KeyType &key, ValueType* old, LeafNodeType* leaf, Path* path)
+{
+  [[maybe_unused]] auto timer = stats_.Time(TreeOp::kRemove);
+  std::optional<StructureLatch> smo;
+  if(concurrent_)
+  {
+    // deletes that leave the leaf at least half full skip the structure latch
+    std::optional<WriteStatus> fast = removeOptimistic(key,old);
+    if(fast) return *fast;
+    smo.emplace(this);
+  }
+  Path descent;
+  NodeType* curr = leaf;
+  if(curr==nullptr || path==nullptr)
+  {
+    curr = findLeaf(key,descent);
+    path = &descent;
+  }
+
+  if(curr==nullptr)
+  {
+    BPT_DIAGNOSTIC("Tree is empty, key not found for key "<<key);
+    return WriteStatus::kNotFound;
+  }
+  latchNode(curr);
+  LeafNodeType* currLeafPtr = static_cast<LeafNodeType*>(curr);
+  int deleteIndex = currLeafPtr->LowerBound(curr->key_num, key, comp_);
+  if(deleteIndex==curr->key_num || !currLeafPtr->KeyEquals(deleteIndex,key,comp_))
+  {
+    BPT_DIAGNOSTIC("Key not found for key "<<key);
+    return WriteStatus::kNotFound;
+  }
+  if(old!=nullptr) *old = currLeafPtr->ValueAt(deleteIndex);
+  currLeafPtr->RemoveAt(deleteIndex);
+  size-=1;
+
+  if(curr==root)
+  {
+    if(curr->key_num==0){
+      freeNode(curr);
+      setRoot(nullptr);
+    }
+    return WriteStatus::kRemoved;
+  }
+  //Case when the key of a leaf node is deleted but key exists in the  parent above
+  //(a stale separator still sorts below the leaf, so lazy deletes keep it)
+  if(deleteIndex==0 && curr->key_num>0 && !lazy_deletes_)
+  {
+    removeKeyFromParent(*path,key,currLeafPtr->KeyAt(0));
+  }
+
+  InternalNodeType* parentPtr = path->Back().node;
+  int nodeIndex = path->Back().slot;
+  int left = nodeIndex-1;
+  int right = nodeIndex+1;
+  if(curr->key_num < leafUnderflow())
+  {
+
+        if(left>=0)
+        {
+
+            NodeType* leftSib = parentPtr->children[left];
+            LeafNodeType* leftSibPtr = static_cast<LeafNodeType*>(leftSib);
+            latchNode(leftSib);
+            if(leftSib->key_num > MAX_FANOUT/2)
+            {
+              latchNode(parentPtr);
+              structure_version_++;
+
+                stats_.Count(TreeCounter::kLeafBorrows);
+                // the borrowed entry is the smallest, so it lands in front
+                int last = leftSib->key_num-1;
+                curr = insertIntoLeaf(curr,0,leftSibPtr->KeyAt(last),leftSibPtr->ValueAt(last),*path);
+                currLeafPtr = static_cast<LeafNodeType*>(curr);
+                leftSibPtr->RemoveAt(last);
+                parentPtr->keys[left] = currLeafPtr->KeyAt(0);
+
+                return WriteStatus::kRemoved;
+            }
+        }
+        if(right<=parentPtr->key_num)
+        {
+          NodeType* rightSib = parentPtr->children[right];
+          LeafNodeType* rightSibPtr = static_cast<LeafNodeType*>(rightSib);
+          latchNode(rightSib);
+          if(rightSib->key_num>MAX_FANOUT/2)
+          {
+            latchNode(parentPtr);
+            structure_version_++;
+            stats_.Count(TreeCounter::kLeafBorrows);
+            curr = insertIntoLeaf(curr,curr->key_num,rightSibPtr->KeyAt(0),rightSibPtr->ValueAt(0),*path);
+            rightSibPtr->RemoveAt(0);
+            parentPtr->keys[right-1] = rightSibPtr->KeyAt(0);
+            return WriteStatus::kRemoved;
+
+          }
+        }
+
+        KeyType key_copy[MAX_FANOUT];
+        ValueType pointer_copy[MAX_FANOUT];
+        if(left>=0)
+        {
+
+          NodeType* leftSib = parentPtr->children[left];
+          LeafNodeType* leftSibPtr = static_cast<LeafNodeType*>(leftSib);
+          stats_.Count(TreeCounter::kLeafMerges);
+          //Copy curr node to left node.
+          int len = copyLeaf(leftSibPtr,key_copy,pointer_copy);
+          len += copyLeaf(currLeafPtr,key_copy+len,pointer_copy+len);
+          path->Back().slot = left;
+          leftSibPtr = rebuildLeaf(leftSibPtr,key_copy,pointer_copy,len,*path);
+
+          leftSibPtr->next_leaf = currLeafPtr->next_leaf;
+          if(currLeafPtr->next_leaf!=nullptr)
+          {
+            latchNode(currLeafPtr->next_leaf);
+            currLeafPtr->next_leaf->prev_leaf = leftSibPtr;
+          }
+          RemoveFromParent(*path,curr,left);
+          freeNode(curr);
+          return WriteStatus::kRemoved;
+
+        }
+        if(right<=parentPtr->key_num)
+        {
+          NodeType* rightSib = parentPtr->children[right];
+          LeafNodeType* rightSibPtr = static_cast<LeafNodeType*>(rightSib);
+          stats_.Count(TreeCounter::kLeafMerges);
+          //Copy right node to curr
+          int len = copyLeaf(currLeafPtr,key_copy,pointer_copy);
+          len += copyLeaf(rightSibPtr,key_copy+len,pointer_copy+len);
+          currLeafPtr = rebuildLeaf(currLeafPtr,key_copy,pointer_copy,len,*path);
+          curr = currLeafPtr;
+
+          currLeafPtr->next_leaf = rightSibPtr->next_leaf;
+          if(rightSibPtr->next_leaf!=nullptr)
+          {
+            latchNode(rightSibPtr->next_leaf);
+            rightSibPtr->next_leaf->prev_leaf = currLeafPtr;
+          }
+          RemoveFromParent(*path,rightSib,right-1);
+          freeNode(rightSib);
+          return WriteStatus::kRemoved;
+        }
+  }
+  return WriteStatus::kRemoved;
+//end of REMOVE
+}
+
+/*
+ * Helper function to remove child from parent, the last step of path
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemoveFromParent(Path &path, NodeType* remNode, int index)
+{
+
+  InternalNodeType* currInternalPtr = path.Pop().node;
+  NodeType* curr = currInternalPtr;
+  latchNode(curr);
+  if(curr==root && curr->key_num==1)
+  {
+        stats_.Count(TreeCounter::kRootCollapses);
+        if(remNode==currInternalPtr->children[0])
+        {
+          setRoot(currInternalPtr->children[1]);
+          freeNode(curr);
+          return;
+        }
+        else if(remNode==currInternalPtr->children[1])
+        {
+          setRoot(currInternalPtr->children[0]);
+          freeNode(curr);
+          return;
+        }
+  }
+  
+  for(int i=index;i<curr->key_num-1;i++)
+  {
+    currInternalPtr->keys[i] = currInternalPtr->keys[i+1];
+  }
+  currInternalPtr->keys[curr->key_num-1] = KeyType();
+  int remIndex = -1;
+
+  for(int i=0;i<curr->key_num+1;i++)
+  {
+    if(currInternalPtr->children[i]==remNode)
+    {
+      remIndex = i;
+      break;
+    }
+  }
+  if(remIndex==-1)
+  {
+    BPT_DIAGNOSTIC("Node to be removed not found among children");
+    return;
+  }
+  for(int i=remIndex;i<curr->key_num;i++)
+  {
+    currInternalPtr->children[i] = currInternalPtr->children[i+1];
+  }
+  currInternalPtr->children[curr->key_num] = nullptr;
+  curr->key_num-=1;
+  // the root may hold fewer children than the minimum
+  if(curr==root) return;
+  if(curr->key_num+1< (MAX_FANOUT+1)/2)
+  {
+    InternalNodeType* parentPtr = path.Back().node;
+    int nodeIndex = path.Back().slot;
+    int left = nodeIndex-1;
+    int right = nodeIndex+1;
+
+            if(left>=0)
+            {
+              NodeType* leftSib = parentPtr->children[left];
+              InternalNodeType* leftSibPtr = static_cast<InternalNodeType*>(leftSib);
+              if(leftSib->key_num>MAX_FANOUT/2)
+              {
+                latchNode(leftSib);
+                latchNode(parentPtr);
+                stats_.Count(TreeCounter::kInternalBorrows);
+
+                for(int i=curr->key_num;i>0;i--)
+                {
+                  currInternalPtr->keys[i] = currInternalPtr->keys[i-1];
+                }
+                currInternalPtr->keys[0] = parentPtr->keys[left];
+                parentPtr->keys[left] = leftSibPtr->keys[leftSib->key_num-1];
+                leftSibPtr->keys[leftSib->key_num-1] = KeyType();
+                for(int i=curr->key_num+1;i>0;i--)
+                {
+                  currInternalPtr->children[i] = currInternalPtr->children[i-1];
+                }
+                currInternalPtr->children[0] = leftSibPtr->children[leftSib->key_num];
+                leftSibPtr->children[leftSib->key_num] = NULL;
+                curr->key_num++;
+                leftSib->key_num--;
+
+                return;
+              }
+
+            }
+
+            if(right<=parentPtr->key_num)
+            {
+              NodeType* rightSib = parentPtr->children[right];
+              InternalNodeType* rightSibPtr = static_cast<InternalNodeType*>(rightSib);
+              if(rightSib->key_num > MAX_FANOUT/2)
+              {
+                latchNode(rightSib);
+                latchNode(parentPtr);
+                stats_.Count(TreeCounter::kInternalBorrows);
+                currInternalPtr->children[curr->key_num+1] = rightSibPtr->children[0];
+                currInternalPtr->keys[curr->key_num] = parentPtr->keys[right-1];
+                parentPtr->keys[right-1] = rightSibPtr->keys[0];
+                for(int i=0;i<rightSib->key_num-1;i++)
+                {
+                  rightSibPtr->keys[i] = rightSibPtr->keys[i+1];
+                }
+                for(int i=0;i<rightSib->key_num;i++)
+                {
+                  rightSibPtr->children[i] = rightSibPtr->children[i+1];
+                }
+                rightSib->key_num--;
+                curr->key_num++;
+
+                return;
+              }
+            }
+
+            if(left>=0)
+            {
+
+              NodeType* leftSib = parentPtr->children[left];
+              InternalNodeType* leftSibPtr = static_cast<InternalNodeType*>(leftSib);
+              latchNode(leftSib);
+              stats_.Count(TreeCounter::kInternalMerges);
+              leftSibPtr->keys[leftSib->key_num] = parentPtr->keys[left];
+              for(int i=0;i<curr->key_num;i++)
+              {
+                leftSibPtr->keys[leftSib->key_num+i+1] = currInternalPtr->keys[i];
+              }
+              for(int i=0;i<curr->key_num+1;i++)
+              {
+                leftSibPtr->children[leftSib->key_num+1+i] = currInternalPtr->children[i];
+                currInternalPtr->children[i] = nullptr;
+              }
+              leftSib->key_num = leftSib->key_num + curr->key_num+1;
+              RemoveFromParent(path,curr,left);
+              freeNode(curr);
+              return;
+            }
+
+            if(right<=parentPtr->key_num)
+            {
+              NodeType* rightSib = parentPtr->children[right];
+              InternalNodeType* rightSibPtr = static_cast<InternalNodeType*>(rightSib);
+              latchNode(rightSib);
+              stats_.Count(TreeCounter::kInternalMerges);
+              currInternalPtr->keys[curr->key_num] = parentPtr->keys[right-1];
+              for(int i=0;i<rightSib->key_num;i++)
+              {
+                currInternalPtr->keys[curr->key_num + i+1] = rightSibPtr->keys[i];
+              }
+              for(int i=0;i<rightSib->key_num+1;i++)
+              {
+                currInternalPtr->children[curr->key_num + 1 + i] = rightSibPtr->children[i];
+                rightSibPtr->children[i] = nullptr;
+              }
+              curr->key_num = curr->key_num + rightSib->key_num+1;
+
+              RemoveFromParent(path,rightSib,right-1);
+              freeNode(rightSib);
+              return;
+
+            }
+  }
+
+}
+/*****************************************************************************
+ * COMPACTION
+ *****************************************************************************/
+/*
+ * Report height, node counts and fill histograms, one level at a time
+ */
+INDEX_TEMPLATE_ARGUMENTS
+TreeShape BPLUSTREE_TYPE::GetShape() const
+{
+  TreeShape shape;
+  std::vector<const NodeType*> level;
+  if(root!=nullptr) level.push_back(root);
+  std::vector<const NodeType*> below;
+  while(!level.empty())
+  {
+    shape.height++;
+    below.clear();
+    for(const NodeType* node : level)
+    {
+      if(node->is_leaf)
+      {
+        shape.leaf_nodes++;
+        shape.entries += node->key_num;
+        shape.leaf_slots += MAX_FANOUT-1;
+        shape.leaf_fill[TreeShape::FillBucket(node->key_num,MAX_FANOUT-1)]++;
+        continue;
+      }
+      const InternalNodeType* nodePtr = static_cast<const InternalNodeType*>(node);
+      shape.internal_nodes++;
+      shape.internal_fill[TreeShape::FillBucket(node->key_num+1,MAX_FANOUT)]++;
+      below.insert(below.end(),nodePtr->children,nodePtr->children+node->key_num+1);
+    }
+    level.swap(below);
+  }
+  return shape;
+}
+
+/*
+ * Repack runs of underfull sibling leaves, at most budget leaves per call.
+ * A run is a leaf below the target and the siblings after it under the same
+ * parent that are below the target too. The leaves it does not need are
+ * unlinked and removed from their parent, last first, through
+ * RemoveFromParent, which borrows and merges on the internal levels as a
+ * Remove would. Its entries are then spread evenly over the leaves that are
+ * left, at the target fill, and the separators between those are rewritten.
+ * Runs whose entries need as many leaves as they have are skipped.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+CompactResult BPLUSTREE_TYPE::Compact(size_t budget, double target_fill)
+{
+  CompactResult result;
+  std::optional<StructureLatch> smo;
+  if(concurrent_) smo.emplace(this);
+  NodeType* start = compact_from_ ? findNode(root,*compact_from_) : leftmostLeaf();
+  LeafNodeType* leaf = static_cast<LeafNodeType*>(start);
+  const int minimum = MAX_FANOUT/2;
+  const int target = fillTarget(target_fill,MAX_FANOUT-1,minimum);
+  std::vector<KeyType> key_copy;
+  std::vector<ValueType> pointer_copy;
+  while(leaf!=nullptr && result.leaves_visited<budget)
+  {
+    if(leaf==root || leaf->key_num>=target)
+    {
+      result.leaves_visited++;
+      leaf = leaf->next_leaf;
+      continue;
+    }
+    // writers that skip the structure latch may still change leaves, so
+    // count entries only once the leaf is latched
+    latchNode(leaf);
+    Path path;
+    findLeaf(leaf->KeyAt(0),path);
+    InternalNodeType* parentPtr = path.Back().node;
+    int first = path.Back().slot;
+    LeafNodeType* run[kCompactRun];
+    run[0] = leaf;
+    int count = 1;
+    int total = leaf->key_num;
+    while(count<kCompactRun && first+count<=parentPtr->key_num && result.leaves_visited+count<budget)
+    {
+      LeafNodeType* sibling = static_cast<LeafNodeType*>(parentPtr->children[first+count]);
+      latchNode(sibling);
+      if(sibling->key_num>=target) break;
+      run[count++] = sibling;
+      total += sibling->key_num;
+    }
+    // leaves thinned by lazy deletes may leave even the packed ones below
+    // minimum, which still beats more leaves below it
+    int keep = (total+target-1)/target;
+    if(keep>=count)
+    {
+      result.leaves_visited++;
+      leaf = leaf->next_leaf;
+      continue;
+    }
+    result.leaves_visited += count;
+
+    key_copy.resize(total);
+    pointer_copy.resize(total);
+    int len = 0;
+    for(int i=0;i<count;i++)
+    {
+      len += copyLeaf(run[i],key_copy.data()+len,pointer_copy.data()+len);
+    }
+    LeafNodeType* after = run[count-1]->next_leaf;
+    if(after!=nullptr) latchNode(after);
+    run[keep-1]->next_leaf = after;
+    if(after!=nullptr) after->prev_leaf = run[keep-1];
+
+    // every removal may move the rest of the run to another parent, so each
+    // leaf is found again by its first key while the separators still lead
+    // to the leaves they did
+    for(int i=count-1;i>=keep;i--)
+    {
+      stats_.Count(TreeCounter::kLeafMerges);
+      findLeaf(run[i]->KeyAt(0),path);
+      RemoveFromParent(path,run[i],path.Back().slot-1);
+      freeNode(run[i]);
+      result.leaves_freed++;
+    }
+    Path kept[kCompactRun];
+    for(int i=0;i<keep;i++)
+    {
+      findLeaf(run[i]->KeyAt(0),kept[i]);
+    }
+    int from = 0;
+    for(int i=0;i<keep;i++)
+    {
+      int to = total*(i+1)/keep;
+      run[i] = rebuildLeaf(run[i],key_copy.data()+from,pointer_copy.data()+from,to-from,kept[i]);
+      if(i>0)
+      {
+        // the separator before run[i] sits in the deepest step that does
+        // not take the first child
+        int d = kept[i].depth-1;
+        while(kept[i].steps[d].slot==0) d--;
+        InternalNodeType* owner = kept[i].steps[d].node;
+        latchNode(owner);
+        owner->keys[kept[i].steps[d].slot-1] = separatorKey(key_copy[from-1],key_copy[from]);
+      }
+      from = to;
+    }
+    leaf = after;
+  }
+  if(leaf==nullptr)
+  {
+    compact_from_.reset();
+    result.done = true;
+  }
+  else
+  {
+    compact_from_ = leaf->KeyAt(0);
+  }
+  return result;
+}
+
+/*
+ * Helper function to find the leaf holding the smallest keys
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::NodeType* BPLUSTREE_TYPE::leftmostLeaf() const
+{
+  NodeType* node = root;
+  if(node==nullptr) return nullptr;
+  while(!node->is_leaf)
+  {
+    node = static_cast<InternalNodeType*>(node)->children[0];
+  }
+  return node;
+}
+
+/*
+ * Helper function to find the leaf holding the largest keys
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::NodeType* BPLUSTREE_TYPE::rightmostLeaf() const
+{
+  NodeType* node = root;
+  if(node==nullptr) return nullptr;
+  while(!node->is_leaf)
+  {
+    node = static_cast<InternalNodeType*>(node)->children[node->key_num];
+  }
+  return node;
+}
+/*****************************************************************************
+ * FREEZE
+ *****************************************************************************/
+/*
+ * Copy the leaf chain into the contiguous arrays of a frozen snapshot, which
+ * builds its index levels from them
+ */
+INDEX_TEMPLATE_ARGUMENTS
+FrozenBPlusTree<KeyType, ValueType, KeyComparator> BPLUSTREE_TYPE::Freeze() const
+{
+  std::vector<KeyType> keys;
+  std::vector<ValueType> values;
+  keys.reserve(size);
+  values.reserve(size);
+  for(NodeType* node = leftmostLeaf();node!=nullptr;node = static_cast<LeafNodeType*>(node)->next_leaf)
+  {
+    const LeafNodeType* leaf = static_cast<const LeafNodeType*>(node);
+    size_t first = values.size();
+    values.resize(first+leaf->key_num);
+    leaf->CopyValues(0,leaf->key_num,values.data()+first);
+    for(int i=0;i<leaf->key_num;i++)
+    {
+      keys.push_back(leaf->KeyAt(i));
+    }
+  }
+  return FrozenBPlusTree<KeyType, ValueType, KeyComparator>(std::move(keys),std::move(values),comp_);
+}
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+/*
+ * Build the tree bottom-up from entries sorted by key in a single pass.
+ * Entries are staged up to two leaves ahead and every leaf is created once
+ * its contents are known, which lets packed leaves pick their layout. The
+ * last two leaves are rebalanced from the staging buffer so neither
+ * underflows, and the internal levels are then built from the first key of
+ * every child.
+ * @return: false (with an empty tree) if a key is not greater than the one
+ * before it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename Iterator>
+bool BPLUSTREE_TYPE::BulkLoad(Iterator first, Iterator last, double fill_factor)
+{
+  Clear();
+  const int minKeys = std::max(1, MAX_FANOUT/2);
+  const int leafTarget = fillTarget(fill_factor, MAX_FANOUT-1, minKeys);
+
+  std::vector<NodeType*> level;
+  std::vector<KeyType> lowKeys;
+  LeafNodeType* leaf = nullptr;
+  // the previous leaf's entries followed by the current leaf's
+  std::vector<KeyType> keys(2*leafTarget);
+  std::vector<ValueType> values(2*leafTarget);
+  int staged = 0;
+  auto flushLeaf = [&](int n)
+  {
+    LeafNodeType* next = newLeaf(keys.data(),values.data(),n);
+    if(leaf!=nullptr)
+    {
+      leaf->next_leaf = next;
+      next->prev_leaf = leaf;
+    }
+    lowKeys.push_back(leaf==nullptr ? keys[0] : separatorKey(leaf->KeyAt(leaf->key_num-1),keys[0]));
+    leaf = next;
+    level.push_back(leaf);
+    std::move(keys.begin()+n,keys.begin()+staged,keys.begin());
+    std::move(values.begin()+n,values.begin()+staged,values.begin());
+    staged -= n;
+  };
+  for(;first!=last;++first)
+  {
+    const auto &entry = *first;
+    if(staged>0 && !comp_(keys[staged-1],entry.first))
+    {
+      // nothing is linked under root yet, so drop the leaves directly
+      for(NodeType* node : level)
+      {
+        freeNode(node,true);
+      }
+      Clear();
+      return false;
+    }
+    if(staged==2*leafTarget)
+    {
+      flushLeaf(leafTarget);
+    }
+    keys[staged] = entry.first;
+    values[staged] = entry.second;
+    staged+=1;
+    size+=1;
+  }
+  if(staged==0) return true;
+
+  // a leaf was flushed only with a full buffer, so more than leafTarget
+  // entries are left whenever there is a leaf before the tail
+  if(staged>leafTarget)
+  {
+    flushLeaf(staged-leafTarget<minKeys ? leafTailSplit(staged) : leafTarget);
+  }
+  if(staged>0)
+  {
+    flushLeaf(staged);
+  }
+
+  buildUpperLevels(level,lowKeys,fill_factor);
+  return true;
+}
+
+/*
+ * The leaves are cut as BulkLoad cuts them. Their layouts are worked out and
+ * the leaves filled and linked in parallel; only taking them from the
+ * allocator, which is single-threaded, is a serial pass.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::ParallelBulkLoad(std::vector<std::pair<KeyType, ValueType>> entries, WorkStealingPool &pool,
+                                        double fill_factor)
+{
+  Clear();
+  if(entries.empty()) return 0;
+  std::vector<KeyType> keys;
+  std::vector<ValueType> values;
+  sortUnique(entries,pool,keys,values);
+  const size_t n = keys.size();
+
+  // leafTarget entries per leaf; a last leaf below the minimum shares the
+  // entries of the one before it
+  const int minKeys = std::max(1, MAX_FANOUT/2);
+  const int leafTarget = fillTarget(fill_factor, MAX_FANOUT-1, minKeys);
+  std::vector<size_t> starts;
+  for(size_t start=0;start<n;start+=leafTarget)
+  {
+    starts.push_back(start);
+  }
+  size_t tail = n-starts.back();
+  if(starts.size()>1 && tail<static_cast<size_t>(minKeys))
+  {
+    int total = leafTarget+static_cast<int>(tail);
+    starts.pop_back();
+    int first = leafTailSplit(total);
+    if(first<total) starts.push_back(starts.back()+first);
+  }
+  starts.push_back(n);
+
+  const size_t leaves = starts.size()-1;
+  const size_t tasks = std::clamp<size_t>(n/kParallelTaskEntries, 1, pool.Threads()*kTasksPerThread);
+  auto forLeaves = [&](auto &&build)
+  {
+    pool.ParallelFor(tasks,[&](size_t t)
+    {
+      for(size_t i=leaves*t/tasks;i<leaves*(t+1)/tasks;i++)
+      {
+        build(i,keys.data()+starts[i],values.data()+starts[i],static_cast<int>(starts[i+1]-starts[i]));
+      }
+    });
+  };
+  std::vector<typename LeafNodeType::Layout> layouts(leaves);
+  forLeaves([&](size_t i, const KeyType* k, const ValueType* v, int len) {
+    layouts[i] = LeafNodeType::LayoutFor(k,v,len);
+  });
+  std::vector<NodeType*> level(leaves);
+  for(size_t i=0;i<leaves;i++)
+  {
+    level[i] = allocLeaf(layouts[i]);
+  }
+  std::vector<KeyType> lowKeys(leaves);
+  forLeaves([&](size_t i, const KeyType* k, const ValueType* v, int len) {
+    LeafNodeType* leaf = static_cast<LeafNodeType*>(level[i]);
+    leaf->Assign(k,v,len);
+    leaf->prev_leaf = i>0 ? static_cast<LeafNodeType*>(level[i-1]) : nullptr;
+    leaf->next_leaf = i+1<leaves ? static_cast<LeafNodeType*>(level[i+1]) : nullptr;
+    lowKeys[i] = i==0 ? k[0] : separatorKey(k[-1],k[0]);
+  });
+  size = n;
+  buildUpperLevels(level,lowKeys,fill_factor);
+  return n;
+}
+
+/*
+ * Helper function for ParallelBulkLoad to sort entries into keys and values,
+ * keeping only the first entry, in input order, of every key. Splitters
+ * taken from a sample cut the key space into one bucket per task. Every task
+ * counts, then moves, its slice of the input into the buckets, so a bucket
+ * holds its entries in input order and equal keys always share a bucket; a
+ * stable sort of each bucket followed by std::unique then keeps the earliest
+ * entry of every key.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::sortUnique(std::vector<std::pair<KeyType, ValueType>> &entries, WorkStealingPool &pool,
+                                std::vector<KeyType> &keys, std::vector<ValueType> &values)
+{
+  using Entry = std::pair<KeyType, ValueType>;
+  const size_t n = entries.size();
+  const size_t tasks = std::clamp<size_t>(n/kParallelTaskEntries, 1, pool.Threads()*kTasksPerThread);
+
+  // the sample is spread over the input by a multiplicative hash, so input
+  // with a period does not skew it
+  std::vector<KeyType> splitters;
+  if(tasks>1)
+  {
+    std::vector<KeyType> sample;
+    for(size_t i=0;i<tasks*kSortSamplesPerBucket;i++)
+    {
+      sample.push_back(entries[(i*0x9E3779B97F4A7C15ull)%n].first);
+    }
+    std::sort(sample.begin(),sample.end(),comp_);
+    for(size_t b=1;b<tasks;b++)
+    {
+      splitters.push_back(sample[b*kSortSamplesPerBucket]);
+    }
+  }
+  auto sliceBegin = [&](size_t t) { return n*t/tasks; };
+
+  // counts[t*tasks+b]: entries of slice t that go to bucket b
+  std::vector<uint32_t> bucketOf(n);
+  std::vector<size_t> counts(tasks*tasks);
+  pool.ParallelFor(tasks,[&](size_t t)
+  {
+    std::vector<size_t> local(tasks,0);
+    for(size_t i=sliceBegin(t);i<sliceBegin(t+1);i++)
+    {
+      size_t b = std::upper_bound(splitters.begin(),splitters.end(),entries[i].first,comp_)-splitters.begin();
+      bucketOf[i] = static_cast<uint32_t>(b);
+      local[b]++;
+    }
+    std::copy(local.begin(),local.end(),counts.begin()+t*tasks);
+  });
+  // turn counts into the position of every slice's first entry in each bucket
+  std::vector<size_t> bucketBegin(tasks+1,0);
+  size_t position = 0;
+  for(size_t b=0;b<tasks;b++)
+  {
+    bucketBegin[b] = position;
+    for(size_t t=0;t<tasks;t++)
+    {
+      size_t count = counts[t*tasks+b];
+      counts[t*tasks+b] = position;
+      position += count;
+    }
+  }
+  bucketBegin[tasks] = n;
+
+  std::vector<Entry> sorted(n);
+  pool.ParallelFor(tasks,[&](size_t t)
+  {
+    std::vector<size_t> next(counts.begin()+t*tasks,counts.begin()+(t+1)*tasks);
+    for(size_t i=sliceBegin(t);i<sliceBegin(t+1);i++)
+    {
+      sorted[next[bucketOf[i]]++] = std::move(entries[i]);
+    }
+  });
+  entries = {};
+  bucketOf = {};
+
+  std::vector<size_t> kept(tasks+1,0);
+  pool.ParallelFor(tasks,[&](size_t b)
+  {
+    auto first = sorted.begin()+bucketBegin[b];
+    auto last = sorted.begin()+bucketBegin[b+1];
+    std::stable_sort(first,last,[this](const Entry &a, const Entry &c) { return comp_(a.first,c.first); });
+    last = std::unique(first,last,[this](const Entry &a, const Entry &c) { return keyEqual(a.first,c.first); });
+    kept[b+1] = last-first;
+  });
+  for(size_t b=0;b<tasks;b++)
+  {
+    kept[b+1] += kept[b];
+  }
+  keys.resize(kept[tasks]);
+  values.resize(kept[tasks]);
+  pool.ParallelFor(tasks,[&](size_t b)
+  {
+    for(size_t i=0;i<kept[b+1]-kept[b];i++)
+    {
+      keys[kept[b]+i] = std::move(sorted[bucketBegin[b]+i].first);
+      values[kept[b]+i] = std::move(sorted[bucketBegin[b]+i].second);
+    }
+  });
+}
+
+/*
+ * Helper function to turn a fill factor into a per-node entry count
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::fillTarget(double fill_factor, int capacity, int minimum)
+{
+  int target = static_cast<int>(fill_factor*capacity+0.5);
+  return std::min(capacity,std::max(minimum,target));
+}
+
+/*
+ * Helper function to split the entries of the last two leaves of a bulk
+ * load. Either both end up with at least the minimum number of keys, or
+ * everything goes to the left leaf. Returns the left leaf's share.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::leafTailSplit(int total)
+{
+  const int minKeys = std::max(1, MAX_FANOUT/2);
+  if(total<2*minKeys)
+  {
+    return total;
+  }
+  return total-total/2;
+}
+
+/*
+ * Helper function to stack internal levels on top of a row of nodes until a
+ * single root remains. lowKeys[i] separates level[i] from the node before it
+ * (its smallest key, or a truncated separator); the last two nodes of every
+ * level are balanced the same way as the leaves.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::buildUpperLevels(std::vector<NodeType*> &level, std::vector<KeyType> &lowKeys, double fill_factor)
+{
+  const int minChildren = (MAX_FANOUT+1)/2;
+  const int target = fillTarget(fill_factor, MAX_FANOUT, minChildren);
+  while(level.size()>1)
+  {
+    std::vector<int> groups(level.size()/target, target);
+    if(level.size()%target!=0)
+    {
+      groups.push_back(static_cast<int>(level.size()%target));
+    }
+    if(groups.size()>1 && groups.back()<minChildren)
+    {
+      int total = groups[groups.size()-2] + groups.back();
+      if(total>=2*minChildren)
+      {
+        groups[groups.size()-2] = total-total/2;
+        groups.back() = total/2;
+      }
+      else
+      {
+        groups.pop_back();
+        groups.back() = total;
+      }
+    }
+
+    std::vector<NodeType*> upper;
+    std::vector<KeyType> upperKeys;
+    upper.reserve(groups.size());
+    upperKeys.reserve(groups.size());
+    size_t next = 0;
+    for(int count : groups)
+    {
+      InternalNodeType* node = newInternal();
+      for(int i=0;i<count;i++)
+      {
+        node->children[i] = level[next+i];
+        if(i>0)
+        {
+          node->keys[i-1] = lowKeys[next+i];
+        }
+      }
+      node->key_num = count-1;
+      upper.push_back(node);
+      upperKeys.push_back(lowKeys[next]);
+      next += count;
+    }
+    level.swap(upper);
+    lowKeys.swap(upperKeys);
+  }
+  setRoot(level[0]);
+}
+
+/*****************************************************************************
+ * RANGE_SCAN
+ *****************************************************************************/
+/*
+ * Return the values that within the given key range
+ * Streams the range through ForEach into result, which stops the scan as
+ * soon as limit values are in.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RangeScan(const KeyType &key_start, const KeyType &key_end,std::vector<ValueType> &result,
+                               size_t limit, size_t offset)
+{
+  if(limit==0) return;
+  size_t taken = 0;
+  ForEach(key_start,key_end,[&](const KeyType &, const ValueType &value) {
+    result.push_back(value);
+    return ++taken<limit;
+  },offset);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReverseRangeScan(const KeyType &key_start, const KeyType &key_end,std::vector<ValueType> &result,
+                                      size_t limit, size_t offset)
+{
+  if(limit==0) return;
+  size_t taken = 0;
+  ReverseForEach(key_start,key_end,[&](const KeyType &, const ValueType &value) {
+    result.push_back(value);
+    return ++taken<limit;
+  },offset);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+template <typename Visitor>
+size_t BPLUSTREE_TYPE::ForEach(const KeyType &key_start, const KeyType &key_end, Visitor &&visit, size_t offset)
+{
+  return forEachEntry(key_start,key_end,visit,offset,false);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+template <typename Visitor>
+size_t BPLUSTREE_TYPE::ReverseForEach(const KeyType &key_start, const KeyType &key_end, Visitor &&visit, size_t offset)
+{
+  return forEachEntry(key_start,key_end,visit,offset,true);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+template <typename Visitor>
+size_t BPLUSTREE_TYPE::forEachEntry(const KeyType &key_start, const KeyType &key_end, Visitor &visit, size_t offset,
+                                    bool reverse)
+{
+  [[maybe_unused]] auto timer = stats_.Time(TreeOp::kRangeScan);
+  size_t visited = 0;
+  if(concurrent_)
+  {
+    visited = forEachOptimistic(key_start,key_end,visit,offset,reverse);
+  }
+  else
+  {
+    Cursor cursor = reverse ? ReverseScan(key_start,key_end) : Scan(key_start,key_end);
+    for(cursor.Skip(offset); cursor.Valid(); cursor.Next())
+    {
+      visited++;
+      if(!visit(cursor.Key(),cursor.Value())) break;
+    }
+  }
+  stats_.Count(TreeCounter::kScanEntries,visited);
+  return visited;
+}
+
+/*
+ * The cut keys are the separators strictly inside the range on one level.
+ * Levels are visited from the root, keeping only the nodes whose subtrees
+ * overlap the range, until a level has enough separators or the next one is
+ * the leaves; an even spread of that level's separators is returned.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::vector<KeyType> BPLUSTREE_TYPE::PartitionRange(const KeyType &key_start, const KeyType &key_end,
+                                                    size_t partitions)
+{
+  std::vector<KeyType> bounds{key_start};
+  std::vector<KeyType> cuts;
+  if(partitions>1 && comp_(key_start,key_end))
+  {
+    // internal nodes only change under the structure latch
+    std::optional<StructureLatch> smo;
+    if(concurrent_) smo.emplace(this);
+    std::vector<NodeType*> level;
+    if(root!=nullptr) level.push_back(root);
+    while(!level.empty() && !level[0]->is_leaf && cuts.size()+1<partitions)
+    {
+      cuts.clear();
+      std::vector<NodeType*> below;
+      for(NodeType* node : level)
+      {
+        InternalNodeType* nodePtr = static_cast<InternalNodeType*>(node);
+        int first = NodeUpperBound(nodePtr->keys, node->key_num, key_start, comp_);
+        int last = NodeLowerBound(nodePtr->keys, node->key_num, key_end, comp_);
+        for(int i=first;i<last;i++) cuts.push_back(nodePtr->keys[i]);
+        for(int i=first;i<=last;i++) below.push_back(nodePtr->children[i]);
+      }
+      level.swap(below);
+    }
+  }
+  size_t parts = std::min(partitions,cuts.size()+1);
+  for(size_t p=1;p<parts;p++)
+  {
+    bounds.push_back(cuts[p*(cuts.size()+1)/parts-1]);
+  }
+  bounds.push_back(key_end);
+  return bounds;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::ParallelRangeScan(const KeyType &key_start, const KeyType &key_end, WorkStealingPool &pool,
+                                         std::vector<std::vector<ValueType>> &out, size_t partitions)
+{
+  if(partitions==0) partitions = pool.Threads()*kTasksPerThread;
+  std::vector<KeyType> bounds = PartitionRange(key_start,key_end,partitions);
+  out.assign(bounds.size()-1,{});
+  pool.ParallelFor(out.size(),[&](size_t p)
+  {
+    // filled locally: neighbouring vector headers share cache lines
+    std::vector<ValueType> values;
+    ForEach(bounds[p],bounds[p+1],[&values](const KeyType &, const ValueType &value) {
+      values.push_back(value);
+      return true;
+    });
+    out[p] = std::move(values);
+  });
+  size_t total = 0;
+  for(const std::vector<ValueType> &values : out) total += values.size();
+  return total;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+template <typename Result, typename Accumulate, typename Combine>
+Result BPLUSTREE_TYPE::ParallelReduce(const KeyType &key_start, const KeyType &key_end, WorkStealingPool &pool,
+                                      Result init, Accumulate &&accumulate, Combine &&combine, size_t partitions)
+{
+  if(partitions==0) partitions = pool.Threads()*kTasksPerThread;
+  std::vector<KeyType> bounds = PartitionRange(key_start,key_end,partitions);
+  std::vector<Result> partials(bounds.size()-1,init);
+  pool.ParallelFor(partials.size(),[&](size_t p)
+  {
+    Result local = init;
+    ForEach(bounds[p],bounds[p+1],[&](const KeyType &key, const ValueType &value) {
+      accumulate(local,key,value);
+      return true;
+    });
+    partials[p] = std::move(local);
+  });
+  for(const Result &partial : partials) combine(init,partial);
+  return init;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::Cursor BPLUSTREE_TYPE::Scan(const KeyType &key_start, const KeyType &key_end)
+{
+  Cursor cursor(this,key_end);
+  cursor.Seek(key_start);
+  return cursor;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::Cursor BPLUSTREE_TYPE::ReverseScan(const KeyType &key_start, const KeyType &key_end)
+{
+  Cursor cursor(this,key_start,true);
+  cursor.Seek(key_end);
+  return cursor;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::Cursor BPLUSTREE_TYPE::Begin()
+{
+  Cursor cursor(this,std::nullopt);
+  if(concurrent_ || root==nullptr) return cursor;
+  cursor.leaf_ = static_cast<LeafNodeType*>(leftmostLeaf());
+  cursor.settle();
+  return cursor;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::Cursor BPLUSTREE_TYPE::ReverseBegin()
+{
+  Cursor cursor(this,std::nullopt,true);
+  if(concurrent_ || root==nullptr) return cursor;
+  cursor.leaf_ = static_cast<LeafNodeType*>(rightmostLeaf());
+  cursor.index_ = cursor.leaf_->key_num-1;
+  cursor.settle();
+  return cursor;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::Cursor BPLUSTREE_TYPE::LowerBound(const KeyType &key)
+{
+  Cursor cursor(this,std::nullopt);
+  cursor.Seek(key);
+  return cursor;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::Cursor BPLUSTREE_TYPE::UpperBound(const KeyType &key)
+{
+  Cursor cursor(this,std::nullopt);
+  cursor.SeekPast(key);
+  return cursor;
+}
+
+/*
+ * Position at the boundary before key (past: after key). Only the leaf that
+ * could hold key is searched; every leaf after it holds larger keys and every
+ * leaf before it smaller ones, so the boundary is found there or at the edge
+ * of a neighbour.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Cursor::seek(const KeyType &key, bool past)
+{
+  leaf_ = nullptr;
+  index_ = 0;
+  if(tree_->concurrent_) return false;
+  NodeType* node = tree_->findNode(tree_->root,key);
+  if(node==nullptr) return false;
+  leaf_ = static_cast<LeafNodeType*>(node);
+  tree_->stats_.Count(TreeCounter::kScanLeaves);
+  const KeyComparator &comp = tree_->comp_;
+  index_ = past ? leaf_->UpperBound(node->key_num, key, comp) : leaf_->LowerBound(node->key_num, key, comp);
+  // a reverse cursor takes the entry before the boundary
+  if(reverse_) index_--;
+  settle();
+  return Valid();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Cursor::Next()
+{
+  if(leaf_==nullptr) return false;
+  index_ += reverse_ ? -1 : 1;
+  settle();
+  return Valid();
+}
+
+/*
+ * A reverse cursor copies each leaf slice in key order and then flips it in
+ * out, so values still come largest key first.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::Cursor::NextBatch(std::span<ValueType> out)
+{
+  size_t copied = 0;
+  while(leaf_!=nullptr && copied<out.size())
+  {
+    if(reverse_)
+    {
+      int first = sliceBegin();
+      int take = static_cast<int>(std::min<size_t>(index_-first+1,out.size()-copied));
+      ValueType* slice = out.data()+copied;
+      leaf_->CopyValues(index_-take+1, take, slice);
+      std::reverse(slice, slice+take);
+      copied += take;
+      index_ -= take;
+      if(index_>=first) break;
+      if(first>0)
+      {
+        // the start key lies inside this leaf
+        leaf_ = nullptr;
+        break;
+      }
+    }
+    else
+    {
+      int limit = sliceEnd();
+      int take = static_cast<int>(std::min<size_t>(limit-index_,out.size()-copied));
+      leaf_->CopyValues(index_, take, out.data()+copied);
+      copied += take;
+      index_ += take;
+      if(index_<limit) break;
+      if(limit<leaf_->key_num)
+      {
+        // the end key lies inside this leaf
+        leaf_ = nullptr;
+        break;
+      }
+    }
+    settle();
+  }
+  return copied;
+}
+
+/*
+ * Like NextBatch without the copies: only the leaf sizes, and the keys of
+ * the leaf holding the bound, are read.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::Cursor::Skip(size_t n)
+{
+  size_t skipped = 0;
+  while(leaf_!=nullptr && skipped<n)
+  {
+    if(reverse_)
+    {
+      int first = sliceBegin();
+      int take = static_cast<int>(std::min<size_t>(index_-first+1,n-skipped));
+      skipped += take;
+      index_ -= take;
+      if(index_>=first) break;
+      if(first>0)
+      {
+        leaf_ = nullptr;
+        break;
+      }
+    }
+    else
+    {
+      int limit = sliceEnd();
+      int take = static_cast<int>(std::min<size_t>(limit-index_,n-skipped));
+      skipped += take;
+      index_ += take;
+      if(index_<limit) break;
+      if(limit<leaf_->key_num)
+      {
+        leaf_ = nullptr;
+        break;
+      }
+    }
+    settle();
+  }
+  return skipped;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Cursor::settle()
+{
+  if(reverse_)
+  {
+    while(leaf_!=nullptr && index_<0)
+    {
+      leaf_ = leaf_->prev_leaf;
+      if(leaf_!=nullptr)
+      {
+        index_ = leaf_->key_num-1;
+        tree_->stats_.Count(TreeCounter::kScanLeaves);
+      }
+    }
+    if(leaf_!=nullptr && end_.has_value() && tree_->comp_(leaf_->KeyAt(index_),*end_))
+    {
+      leaf_ = nullptr;
+    }
+    return;
+  }
+  while(leaf_!=nullptr && index_>=leaf_->key_num)
+  {
+    leaf_ = leaf_->next_leaf;
+    index_ = 0;
+    if(leaf_!=nullptr) tree_->stats_.Count(TreeCounter::kScanLeaves);
+  }
+  if(leaf_!=nullptr && end_.has_value() && !tree_->comp_(leaf_->KeyAt(index_),*end_))
+  {
+    leaf_ = nullptr;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::Cursor::sliceEnd() const
+{
+  int n = leaf_->key_num;
+  if(!end_.has_value() || tree_->comp_(leaf_->KeyAt(n-1),*end_)) return n;
+  // every key before index_ is below the end key already
+  return leaf_->LowerBound(n, *end_, tree_->comp_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::Cursor::sliceBegin() const
+{
+  if(!end_.has_value() || !tree_->comp_(leaf_->KeyAt(0),*end_)) return 0;
+  // every key after index_ is at or above the start key already
+  return leaf_->LowerBound(index_+1, *end_, tree_->comp_);
+}
+
+/*****************************************************************************
+ * FINGER
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Finger::GetValue(const KeyType &key, ValueType &result)
+{
+  if(tree_->concurrent_) return tree_->GetValue(key,result);
+  [[maybe_unused]] auto timer = tree_->stats_.Time(TreeOp::kGetValue);
+  LeafNodeType* leaf = locate(key);
+  if(leaf==nullptr) return false;
+  int i = leaf->LowerBound(leaf->key_num, key, tree_->comp_);
+  if(i<leaf->key_num && leaf->KeyEquals(i,key,tree_->comp_))
+  {
+    result = leaf->ValueAt(i);
+    return true;
+  }
+  return false;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Finger::Insert(const KeyType &key, const ValueType &value)
+{
+  return Insert(key,value,nullptr)==WriteStatus::kInserted;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+WriteStatus BPLUSTREE_TYPE::Finger::Insert(const KeyType &key, const ValueType &value, ValueType* existing)
+{
+  if(tree_->concurrent_) return tree_->Insert(key,value,existing);
+  // an empty tree has no leaf yet, insertEntry makes the root
+  LeafNodeType* leaf = locate(key);
+  return tree_->insertEntry(key,value,[existing](ValueType &stored)
+  {
+    if(existing!=nullptr) *existing = stored;
+    return false;
+  },leaf,&path_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+WriteStatus BPLUSTREE_TYPE::Finger::InsertOrAssign(const KeyType &key, const ValueType &value, ValueType* old)
+{
+  if(tree_->concurrent_) return tree_->InsertOrAssign(key,value,old);
+  LeafNodeType* leaf = locate(key);
+  return tree_->insertEntry(key,value,[&](ValueType &stored)
+  {
+    if(old!=nullptr) *old = stored;
+    stored = value;
+    return true;
+  },leaf,&path_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+WriteStatus BPLUSTREE_TYPE::Finger::Remove(const KeyType &key, ValueType* old)
+{
+  if(tree_->concurrent_) return tree_->Remove(key,old);
+  LeafNodeType* leaf = locate(key);
+  if(leaf==nullptr) return WriteStatus::kNotFound;
+  return tree_->removeEntry(key,old,leaf,&path_);
+}
+
+/*
+ * Find the leaf for key from the remembered one while the tree's structure
+ * is unchanged, or from the leaf before or after it when key is past one of
+ * its bounds. That bound is the neighbour's near bound; its far one is read
+ * off the nearest ancestor where the neighbour is not the edge child. The
+ * remembered path moves along, so writes through the finger still find the
+ * parents of the leaf.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::LeafNodeType* BPLUSTREE_TYPE::Finger::locate(const KeyType &key)
+{
+  const KeyComparator &comp = tree_->comp_;
+  if(leaf_!=nullptr && version_==tree_->structure_version_)
+  {
+    if(covers(key))
+    {
+      stats_.hits++;
+      return leaf_;
+    }
+    // a bound means there is a leaf beyond it
+    if(high_ && !comp(key,*high_))
+    {
+      stepPath(path_,true);
+      std::optional<KeyType> high = separatorBeside(path_,true);
+      if(!high || comp(key,*high))
+      {
+        low_ = std::move(high_);
+        high_ = std::move(high);
+        leaf_ = leaf_->next_leaf;
+        stats_.neighbor_hits++;
+        return leaf_;
+      }
+    }
+    else if(low_ && comp(key,*low_))
+    {
+      stepPath(path_,false);
+      std::optional<KeyType> low = separatorBeside(path_,false);
+      if(!low || !comp(key,*low))
+      {
+        high_ = std::move(low_);
+        low_ = std::move(low);
+        leaf_ = leaf_->prev_leaf;
+        stats_.neighbor_hits++;
+        return leaf_;
+      }
+    }
+  }
+  stats_.misses++;
+  leaf_ = tree_->findLeaf(key,path_);
+  low_ = separatorBeside(path_,false);
+  high_ = separatorBeside(path_,true);
+  version_ = tree_->structure_version_;
+  return leaf_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Finger::covers(const KeyType &key) const
+{
+  const KeyComparator &comp = tree_->comp_;
+  return (!low_ || !comp(key,*low_)) && (!high_ || comp(key,*high_));
+}
+
+/*
+ * The separator right after (after) or right before the leaf path leads to,
+ * in the deepest step that does not take the last (first) child
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::optional<KeyType> BPLUSTREE_TYPE::Finger::separatorBeside(const Path &path, bool after)
+{
+  for(int d=path.depth-1;d>=0;d--)
+  {
+    const typename Path::Step &step = path.steps[d];
+    if(after && step.slot<step.node->key_num) return step.node->keys[step.slot];
+    if(!after && step.slot>0) return step.node->keys[step.slot-1];
+  }
+  return std::nullopt;
+}
+
+/*
+ * Move path to the leaf after (forward) or before the one it leads to: the
+ * deepest step that is not at its edge moves one slot over and every step
+ * below it takes the edge child on the near side
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Finger::stepPath(Path &path, bool forward)
+{
+  int d = path.depth-1;
+  while(d>=0 && path.steps[d].slot==(forward ? path.steps[d].node->key_num : 0)) d--;
+  if(d<0) return;
+  path.steps[d].slot += forward ? 1 : -1;
+  for(d++;d<path.depth;d++)
+  {
+    const typename Path::Step &above = path.steps[d-1];
+    InternalNodeType* node = static_cast<InternalNodeType*>(above.node->children[above.slot]);
+    path.steps[d] = {node, forward ? 0 : node->key_num};
+  }
+}
+
+/*****************************************************************************
+ * THREAD-SAFE MODE
+ *****************************************************************************/
+/*
+ * Held by a writer that has to change the shape of the tree. Only one writer
+ * restructures at a time, so internal nodes are never written concurrently;
+ * every node the writer touches is also write-latched so optimistic readers
+ * and single-leaf writers notice. Latches are dropped and retired nodes are
+ * reclaimed when the writer leaves.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class BPLUSTREE_TYPE::StructureLatch {
+ public:
+  explicit StructureLatch(BPlusTree* tree) : tree_(tree), guard_(tree->structure_mutex_) {}
+  ~StructureLatch() { tree_->releaseLatches(); }
+
+ private:
+  BPlusTree* tree_;
+  std::lock_guard<std::mutex> guard_;
+};
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::SetThreadSafe(bool enable)
+{
+  if constexpr(!std::is_trivially_copyable_v<KeyType> || !std::is_trivially_copyable_v<ValueType>)
+  {
+    // optimistic readers may copy a key or value while it is being written
+    if(enable) return false;
+  }
+  if(enable && epoch_==nullptr)
+  {
+    epoch_ = std::make_unique<EpochManager>();
+  }
+  if(!enable)
+  {
+    reclaimRetired(true);
+  }
+  last_leaf_ = nullptr;
+  concurrent_ = enable;
+  return true;
+}
+
+/*
+ * Helper function to read key_num of a node that may be changing under us
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::clampKeyNum(const NodeType* node)
+{
+  int n = __atomic_load_n(&node->key_num, __ATOMIC_RELAXED);
+  return std::min(std::max(n,0),MAX_FANOUT-1);
+}
+
+/*
+ * Lock-free counterpart of findNode. Every hop reads the child pointer, then
+ * validates the parent before trusting it. Returns false if a writer got in
+ * the way and the caller has to restart; an empty tree gives a null leaf.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::descendOptimistic(const KeyType &key, NodeType* &leaf, uint64_t &version)
+{
+  NodeType* node = loadRoot();
+  if(node==nullptr)
+  {
+    leaf = nullptr;
+    return true;
+  }
+  [[maybe_unused]] auto probe = stats_.ProbeDescent();
+  auto restart = [this]()
+  {
+    stats_.Count(TreeCounter::kOptimisticRestarts);
+    return false;
+  };
+  if(!node->latch.ReadLock(version) || node!=loadRoot()) return restart();
+  int levels = 0;
+  while(!node->is_leaf)
+  {
+    InternalNodeType* nodePtr = static_cast<InternalNodeType*>(node);
+    NodeType* child = nodePtr->children[NodeUpperBound(nodePtr->keys, clampKeyNum(node), key, comp_)];
+    if(!node->latch.Validate(version)) return restart();
+    uint64_t childVersion;
+    if(!child->latch.ReadLock(childVersion)) return restart();
+    // a borrow may have moved keys out of child before we saw its version
+    if(!node->latch.Validate(version)) return restart();
+    node = child;
+    version = childVersion;
+    levels++;
+  }
+  stats_.CountDescent(levels);
+  leaf = node;
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::getValueOptimistic(const KeyType &key, ValueType &result)
+{
+  while(true)
+  {
+    EpochGuard guard(*epoch_);
+    NodeType* leaf;
+    uint64_t version;
+    if(!descendOptimistic(key,leaf,version)) continue;
+    if(leaf==nullptr) return false;
+
+    LeafNodeType* leafPtr = static_cast<LeafNodeType*>(leaf);
+    int n = clampKeyNum(leaf);
+    int i = leafPtr->LowerBound(n, key, comp_);
+    bool found = i<n && leafPtr->KeyEquals(i,key,comp_);
+    ValueType value;
+    if(found) value = leafPtr->ValueAt(i);
+    if(!leaf->latch.Validate(version)) continue;
+    if(found) result = value;
+    return found;
+  }
+}
+
+/*
+ * Scan leaf by leaf, copying each leaf's matches aside and handing them to the
+ * visitor only once the leaf validates. Entries still to skip for offset are
+ * counted off a leaf slice without being copied. After a conflict the scan
+ * descends again and resumes past the last key it skipped or visited. A
+ * reverse scan walks prev_leaf under the same validation.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename Visitor>
+size_t BPLUSTREE_TYPE::forEachOptimistic(const KeyType &key_start, const KeyType &key_end, Visitor &visit,
+                                         size_t offset, bool reverse)
+{
+  // the last key consumed, skipped or visited; a forward scan resumes after
+  // it and a reverse one before it, as before key_end at the start
+  KeyType from = reverse ? key_end : key_start;
+  bool resumed = false;
+  size_t visited = 0;
+  std::vector<std::pair<KeyType, ValueType>> chunk;
+  while(true)
+  {
+    EpochGuard guard(*epoch_);
+    NodeType* node;
+    uint64_t version;
+    if(!descendOptimistic(from,node,version)) continue;
+    while(node!=nullptr)
+    {
+      LeafNodeType* leaf = static_cast<LeafNodeType*>(node);
+      stats_.Count(TreeCounter::kScanLeaves);
+      int n = clampKeyNum(node);
+      // the entries in [first, last) are in range and not consumed yet
+      int first;
+      int last;
+      bool done;
+      if(reverse)
+      {
+        first = leaf->LowerBound(n, key_start, comp_);
+        last = leaf->LowerBound(n, from, comp_);
+        done = first>0;
+      }
+      else
+      {
+        first = resumed ? leaf->UpperBound(n, from, comp_) : leaf->LowerBound(n, from, comp_);
+        last = leaf->LowerBound(n, key_end, comp_);
+        done = last<n;
+      }
+      int count = std::max(0,last-first);
+      int skip = static_cast<int>(std::min<size_t>(offset,count));
+      chunk.clear();
+      if(reverse)
+      {
+        for(int i=last-1-skip;i>=first;i--) chunk.emplace_back(leaf->KeyAt(i),leaf->ValueAt(i));
+      }
+      else
+      {
+        for(int i=first+skip;i<last;i++) chunk.emplace_back(leaf->KeyAt(i),leaf->ValueAt(i));
+      }
+      std::optional<KeyType> consumed;
+      if(count>0) consumed = leaf->KeyAt(reverse ? first : last-1);
+      LeafNodeType* next = reverse ? leaf->prev_leaf : leaf->next_leaf;
+      if(!node->latch.Validate(version)) break;
+
+      offset -= skip;
+      for(auto &entry : chunk)
+      {
+        visited++;
+        if(!visit(static_cast<const KeyType &>(entry.first),static_cast<const ValueType &>(entry.second))) return visited;
+      }
+      if(consumed)
+      {
+        from = *consumed;
+        resumed = true;
+      }
+      if(done || next==nullptr) return visited;
+      uint64_t nextVersion;
+      if(!next->latch.ReadLock(nextVersion)) break;
+      // keys borrowed from next into this leaf after we read it would be lost
+      if(!node->latch.Validate(version)) break;
+      node = next;
+      version = nextVersion;
+    }
+    if(node==nullptr) return visited;
+  }
+}
+
+/*
+ * Insert or update without the structure latch when the target leaf has room.
+ * @return: nullopt when the leaf must split or be replaced
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename OnExisting>
+std::optional<WriteStatus> BPLUSTREE_TYPE::insertOptimistic(const KeyType &key, const ValueType &value, OnExisting &onExisting)
+{
+  while(true)
+  {
+    EpochGuard guard(*epoch_);
+    NodeType* leaf;
+    uint64_t version;
+    if(!descendOptimistic(key,leaf,version)) continue;
+    if(leaf==nullptr) return std::nullopt;
+    if(!leaf->latch.TryUpgrade(version)) continue;
+
+    LeafNodeType* leafPtr = static_cast<LeafNodeType*>(leaf);
+    int i = leafPtr->LowerBound(leaf->key_num, key, comp_);
+    std::optional<WriteStatus> status;
+    if(i<leaf->key_num && leafPtr->KeyEquals(i,key,comp_))
+    {
+      ValueType stored = leafPtr->ValueAt(i);
+      if(!onExisting(stored))
+      {
+        status = WriteStatus::kDuplicate;
+      }
+      else if(leafPtr->SetValueAt(i,stored))
+      {
+        status = WriteStatus::kUpdated;
+      }
+    }
+    else if(leaf->key_num<MAX_FANOUT-1 && leafPtr->Fits(key,value))
+    {
+      leafPtr->InsertAt(i,key,value);
+      size+=1;
+      status = WriteStatus::kInserted;
+    }
+    // otherwise splitting or widening a packed leaf replaces nodes
+    leaf->latch.Unlock();
+    return status;
+  }
+}
+
+/*
+ * Remove without the structure latch when the leaf stays at least half full
+ * and no separator above it has to change.
+ * @return: nullopt when the leaf must be rebalanced
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::optional<WriteStatus> BPLUSTREE_TYPE::removeOptimistic(const KeyType &key, ValueType* old)
+{
+  while(true)
+  {
+    EpochGuard guard(*epoch_);
+    NodeType* leaf;
+    uint64_t version;
+    if(!descendOptimistic(key,leaf,version)) continue;
+    if(leaf==nullptr) return WriteStatus::kNotFound;
+    if(!leaf->latch.TryUpgrade(version)) continue;
+
+    LeafNodeType* leafPtr = static_cast<LeafNodeType*>(leaf);
+    int i = leafPtr->LowerBound(leaf->key_num, key, comp_);
+    std::optional<WriteStatus> status = WriteStatus::kNotFound;
+    if(i<leaf->key_num && leafPtr->KeyEquals(i,key,comp_))
+    {
+      bool isRoot = leaf==loadRoot();
+      if(isRoot ? leaf->key_num==1 : ((i==0 && !lazy_deletes_) || leaf->key_num-1<leafUnderflow()))
+      {
+        status = std::nullopt;
+      }
+      else
+      {
+        if(old!=nullptr) *old = leafPtr->ValueAt(i);
+        leafPtr->RemoveAt(i);
+        size-=1;
+        status = WriteStatus::kRemoved;
+      }
+    }
+    leaf->latch.Unlock();
+    return status;
+  }
+}
+
+/*
+ * Write-latch a node for the rest of the structure modification. A no-op in
+ * single-threaded mode and for nodes this writer already holds.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::latchNode(NodeType* node)
+{
+  if(!concurrent_ || node==nullptr) return;
+  for(NodeType* held : latched_)
+  {
+    if(held==node) return;
+  }
+  node->latch.Lock();
+  latched_.push_back(node);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::releaseLatches()
+{
+  for(NodeType* node : latched_)
+  {
+    node->latch.Unlock();
+  }
+  latched_.clear();
+  reclaimRetired(false);
+}
+
+/*
+ * Free retired nodes no reader can still reach, or all of them when the tree
+ * is quiescent
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::reclaimRetired(bool everything)
+{
+  if(retired_.empty()) return;
+  uint64_t safe = everything ? UINT64_MAX : epoch_->Advance();
+  size_t kept = 0;
+  for(auto &entry : retired_)
+  {
+    if(entry.first<safe)
+    {
+      releaseNode(entry.second);
+    }
+    else
+    {
+      retired_[kept++] = entry;
+    }
+  }
+  retired_.resize(kept);
+}
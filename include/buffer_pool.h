@@ -0,0 +1,228 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/buffer_pool.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "disk_manager.h"
+
+// A buffer frame and the page it currently holds
+struct Page {
+  page_id_t page_id = INVALID_PAGE_ID;
+  int pin_count = 0;
+  bool dirty = false;
+  // CLOCK reference bit
+  bool referenced = false;
+  char *data = nullptr;
+  // Swizzled child references of an internal page: frames its children were
+  // last found in, indexed by child slot. Only a hint; FetchChild checks the
+  // frame still holds the expected page before using it.
+  std::unique_ptr<Page *[]> child_hints;
+
+  template <typename T>
+  T *As() {
+    return reinterpret_cast<T *>(data);
+  }
+};
+
+struct BufferPoolStats {
+  size_t hits = 0;           // page found in the pool
+  size_t swizzled_hits = 0;  // found through a child hint, without the page table
+  size_t misses = 0;         // read from disk
+  size_t evictions = 0;
+  size_t dirty_writes = 0;   // pages written back
+};
+
+/**
+ * Caches pages of a DiskManager in a fixed number of frames.
+ *
+ * Callers pin a page with FetchPage/NewPage and unpin it when done, saying
+ * whether they modified it. Unpinned frames are replaced with the CLOCK
+ * policy and dirty ones are written back before they are reused. Not thread
+ * safe.
+ */
+class BufferPoolManager {
+ public:
+  // hint_slots: child slots per internal page to keep swizzled references for
+  BufferPoolManager(size_t pool_pages, DiskManager *disk, int hint_slots = 0)
+      : frames_(pool_pages), disk_(disk), hint_slots_(hint_slots) {
+    memory_ = static_cast<char *>(std::aligned_alloc(kPageSize, pool_pages * kPageSize));
+    for (size_t i = 0; i < pool_pages; i++) frames_[i].data = memory_ + i * kPageSize;
+    page_table_.reserve(pool_pages);
+  }
+  BufferPoolManager(const BufferPoolManager &) = delete;
+  BufferPoolManager &operator=(const BufferPoolManager &) = delete;
+  ~BufferPoolManager() {
+    FlushAll();
+    std::free(memory_);
+  }
+
+  // Pin the page, reading it from disk if needed. Returns nullptr when every
+  // frame is pinned.
+  Page *FetchPage(page_id_t page_id) {
+    auto it = page_table_.find(page_id);
+    if (it != page_table_.end()) {
+      stats_.hits++;
+      return pin(it->second);
+    }
+    Page *page = victim();
+    if (page == nullptr) return nullptr;
+    if (!disk_->ReadPage(page_id, page->data)) {
+      return nullptr;
+    }
+    stats_.misses++;
+    install(page, page_id);
+    return pin(page);
+  }
+
+  // FetchPage for the child in the given slot of a pinned internal page,
+  // following the swizzled reference when it is still valid
+  Page *FetchChild(Page *parent, int slot, page_id_t child_id) {
+    if (slot < hint_slots_ && parent->child_hints != nullptr) {
+      Page *hint = parent->child_hints[slot];
+      if (hint != nullptr && hint->page_id == child_id) {
+        stats_.swizzled_hits++;
+        return pin(hint);
+      }
+    }
+    Page *child = FetchPage(child_id);
+    if (child != nullptr && slot < hint_slots_) {
+      if (parent->child_hints == nullptr) {
+        parent->child_hints = std::make_unique<Page *[]>(hint_slots_);
+      }
+      parent->child_hints[slot] = child;
+    }
+    return child;
+  }
+
+  // Allocate a zeroed page at the end of the file and pin it
+  Page *NewPage() {
+    Page *page = victim();
+    if (page == nullptr) return nullptr;
+    std::memset(page->data, 0, kPageSize);
+    install(page, disk_->AllocatePage());
+    page->dirty = true;
+    return pin(page);
+  }
+
+  void UnpinPage(Page *page, bool dirty) {
+    page->dirty = page->dirty || dirty;
+    page->pin_count--;
+  }
+
+  // Write every dirty page back
+  bool FlushAll() {
+    bool ok = true;
+    for (Page &page : frames_) {
+      if (page.page_id != INVALID_PAGE_ID && page.dirty) ok = writeBack(&page) && ok;
+    }
+    return ok;
+  }
+
+  DiskManager *Disk() const { return disk_; }
+  size_t PoolPages() const { return frames_.size(); }
+  BufferPoolStats Stats() const { return stats_; }
+
+ private:
+  Page *pin(Page *page) {
+    page->pin_count++;
+    page->referenced = true;
+    return page;
+  }
+
+  void install(Page *page, page_id_t page_id) {
+    page->page_id = page_id;
+    page->dirty = false;
+    if (page->child_hints != nullptr) std::fill_n(page->child_hints.get(), hint_slots_, nullptr);
+    page_table_[page_id] = page;
+  }
+
+  bool writeBack(Page *page) {
+    if (!disk_->WritePage(page->page_id, page->data)) return false;
+    page->dirty = false;
+    stats_.dirty_writes++;
+    return true;
+  }
+
+  // CLOCK: sweep the frames, clearing reference bits, until an unpinned frame
+  // without one turns up. Two full sweeps without a candidate mean every
+  // frame is pinned.
+  Page *victim() {
+    for (size_t step = 0; step < 2 * frames_.size(); step++) {
+      Page &page = frames_[hand_];
+      hand_ = (hand_ + 1) % frames_.size();
+      if (page.pin_count > 0) continue;
+      if (page.referenced) {
+        page.referenced = false;
+        continue;
+      }
+      if (page.page_id != INVALID_PAGE_ID) {
+        if (page.dirty && !writeBack(&page)) continue;
+        page_table_.erase(page.page_id);
+        page.page_id = INVALID_PAGE_ID;
+        stats_.evictions++;
+      }
+      return &page;
+    }
+    return nullptr;
+  }
+
+  std::vector<Page> frames_;
+  char *memory_ = nullptr;
+  DiskManager *disk_;
+  int hint_slots_;
+  std::unordered_map<page_id_t, Page *> page_table_;
+  size_t hand_ = 0;
+  BufferPoolStats stats_;
+};
+
+// Keeps a page pinned for the lifetime of the guard
+class PageGuard {
+ public:
+  PageGuard() = default;
+  PageGuard(BufferPoolManager *pool, Page *page) : pool_(pool), page_(page) {}
+  PageGuard(PageGuard &&other) noexcept { *this = std::move(other); }
+  PageGuard &operator=(PageGuard &&other) noexcept {
+    if (this != &other) {
+      Release();
+      pool_ = std::exchange(other.pool_, nullptr);
+      page_ = std::exchange(other.page_, nullptr);
+      dirty_ = std::exchange(other.dirty_, false);
+    }
+    return *this;
+  }
+  ~PageGuard() { Release(); }
+
+  void Release() {
+    if (page_ != nullptr) pool_->UnpinPage(page_, dirty_);
+    page_ = nullptr;
+    dirty_ = false;
+  }
+
+  void MarkDirty() { dirty_ = true; }
+  explicit operator bool() const { return page_ != nullptr; }
+  Page *Get() const { return page_; }
+  page_id_t PageId() const { return page_->page_id; }
+  template <typename T>
+  T *As() const {
+    return page_->As<T>();
+  }
+
+ private:
+  BufferPoolManager *pool_ = nullptr;
+  Page *page_ = nullptr;
+  bool dirty_ = false;
+};
@@ -0,0 +1,328 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/buffered_b_plus_tree.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "b_plus_tree.h"
+
+/**
+ * BPlusTree with a message buffer above its root, for indexes that take far
+ * more writes than reads: a B-epsilon tree with one buffered level.
+ *
+ * Insert, InsertOrAssign and Remove are blind. They only append a message to
+ * the buffer and report nothing, because the key is not looked up. The
+ * buffer is a short unsorted tail plus a few sorted runs: a full tail is
+ * sorted into a run, and a run is merged into the one before it while that
+ * one is at most twice its size, so there are O(log n) runs and a write
+ * costs an append plus amortized sequential merging instead of a descent.
+ * Where two messages for a key meet, the newer one absorbs the older.
+ *
+ * Once the buffer holds buffer_entries messages, one key range of it is
+ * applied to the tree: the range with the most messages between two
+ * separators of the tree's upper levels (see BPlusTree::PartitionRange), the
+ * way a B-epsilon node flushes to its fullest child. Its messages go in in
+ * key order through a Finger, so messages bound for the same leaf share its
+ * descent and cache misses.
+ *
+ * GetValue and RangeScan merge the buffer into what they read from the tree,
+ * so they see every write. Not thread-safe.
+ */
+template <typename KeyType = int, typename ValueType = RecordPointer,
+          int Fanout = kFanoutForNodeBytes<KeyType, ValueType, kDefaultNodeBytes>,
+          typename KeyComparator = std::less<KeyType>>
+class BufferedBPlusTree {
+ public:
+  using TreeType = BPlusTree<KeyType, ValueType, Fanout, KeyComparator>;
+
+  static constexpr size_t kDefaultBufferEntries = 1 << 16;
+  // key ranges a flush chooses from, like the children of a B-epsilon node
+  static constexpr size_t kFlushPartitions = 16;
+  // unsorted messages GetValue scans before the runs
+  static constexpr size_t kTailEntries = 64;
+
+  explicit BufferedBPlusTree(size_t buffer_entries = kDefaultBufferEntries, const KeyComparator &comp = KeyComparator())
+      : tree_(comp), finger_(tree_.MakeFinger()), comp_(comp), buffer_entries_(std::max<size_t>(1, buffer_entries)) {
+    tail_.reserve(kTailEntries);
+  }
+
+  // the finger points into tree_
+  BufferedBPlusTree(const BufferedBPlusTree &) = delete;
+  BufferedBPlusTree &operator=(const BufferedBPlusTree &) = delete;
+
+  // Insert key, unless it is in the tree by the time the message is applied
+  void Insert(const KeyType &key, const ValueType &value) { add(key, Message{Kind::kInsert, value}); }
+  void InsertOrAssign(const KeyType &key, const ValueType &value) { add(key, Message{Kind::kAssign, value}); }
+  void Remove(const KeyType &key) { add(key, Message{Kind::kRemove, ValueType()}); }
+
+  bool GetValue(const KeyType &key, ValueType &result) {
+    const ValueType *inserted = nullptr;
+    const Message *newest = newestNonInsert(key, inserted);
+    if (newest == nullptr && tree_.GetValue(key, result)) return true;
+    if (newest != nullptr && newest->kind == Kind::kAssign) {
+      result = newest->value;
+      return true;
+    }
+    // the key is absent below the inserts
+    if (inserted != nullptr) result = *inserted;
+    return inserted != nullptr;
+  }
+
+  // Values within [key_start, key_end) in key order
+  void RangeScan(const KeyType &key_start, const KeyType &key_end, std::vector<ValueType> &result) {
+    if (!comp_(key_start, key_end)) return;
+    sealTail();
+    std::vector<Entry> messages;
+    mergeRuns(key_start, &key_end, messages);
+    auto it = messages.begin();
+    // buffered entries of keys the tree does not have, up to key
+    auto emitBefore = [&](const KeyType *key) {
+      for (; it != messages.end() && (key == nullptr || comp_(it->key, *key)); ++it) {
+        if (it->message.kind != Kind::kRemove) result.push_back(it->message.value);
+      }
+    };
+    tree_.ForEach(key_start, key_end, [&](const KeyType &key, const ValueType &value) {
+      emitBefore(&key);
+      if (it == messages.end() || comp_(key, it->key)) {
+        result.push_back(value);
+        return true;
+      }
+      // an insert of a key the tree has is a no-op
+      if (it->message.kind == Kind::kAssign) result.push_back(it->message.value);
+      if (it->message.kind == Kind::kInsert) result.push_back(value);
+      ++it;
+      return true;
+    });
+    emitBefore(nullptr);
+  }
+
+  // Apply every buffered message
+  void Flush() {
+    sealTail();
+    if (runs_.empty()) return;
+    std::vector<Entry> messages;
+    mergeRuns(minKey(), nullptr, messages);
+    apply(messages);
+    runs_.clear();
+    buffered_ = 0;
+  }
+
+  // messages not yet applied, counting each key once per run it is in
+  size_t BufferedMessages() const { return buffered_; }
+  size_t Flushes() const { return flushes_; }
+  // where the flushes found their leaves
+  const FingerStats &FlushStats() const { return finger_.Stats(); }
+  // The tree without the buffered messages; Flush first to see all of them
+  TreeType &Tree() { return tree_; }
+
+ private:
+  enum class Kind { kInsert, kAssign, kRemove };
+  struct Message {
+    Kind kind;
+    ValueType value;
+  };
+  struct Entry {
+    KeyType key;
+    Message message;
+  };
+  // sorted by key, one entry per key
+  using Run = std::vector<Entry>;
+
+  bool equal(const KeyType &a, const KeyType &b) const { return !comp_(a, b) && !comp_(b, a); }
+
+  typename Run::iterator lowerBound(Run &run, const KeyType &key) {
+    return std::lower_bound(run.begin(), run.end(), key,
+                            [this](const Entry &entry, const KeyType &k) { return comp_(entry.key, k); });
+  }
+
+  // An insert only takes effect on an absent key: after a remove the key is
+  // absent, after an assign it is not, and of two inserts the first one wins
+  static Message combine(const Message &older, const Message &newer) {
+    if (newer.kind != Kind::kInsert) return newer;
+    if (older.kind == Kind::kRemove) return Message{Kind::kAssign, newer.value};
+    return older;
+  }
+
+  // The newest assign or remove of key, newest message first; inserted is set
+  // to the value of the oldest insert newer than it, which decides if the key
+  // is absent there
+  const Message *newestNonInsert(const KeyType &key, const ValueType *&inserted) {
+    auto visit = [&inserted](const Message &message) {
+      if (message.kind != Kind::kInsert) return true;
+      inserted = &message.value;
+      return false;
+    };
+    for (auto it = tail_.rbegin(); it != tail_.rend(); ++it) {
+      if (equal(it->key, key) && visit(it->message)) return &it->message;
+    }
+    for (auto run = runs_.rbegin(); run != runs_.rend(); ++run) {
+      auto it = lowerBound(*run, key);
+      if (it != run->end() && equal(it->key, key) && visit(it->message)) return &it->message;
+    }
+    return nullptr;
+  }
+
+  void add(const KeyType &key, const Message &message) {
+    tail_.push_back(Entry{key, message});
+    buffered_++;
+    if (tail_.size() < kTailEntries && buffered_ < buffer_entries_) return;
+    sealTail();
+    if (buffered_ >= buffer_entries_) flushFullest();
+  }
+
+  // Sort the tail into a new run and merge runs until each is more than twice
+  // the size of the next newer one
+  void sealTail() {
+    if (tail_.empty()) return;
+    std::stable_sort(tail_.begin(), tail_.end(), [this](const Entry &a, const Entry &b) { return comp_(a.key, b.key); });
+    Run run;
+    run.reserve(tail_.size());
+    for (const Entry &entry : tail_) {
+      if (!run.empty() && equal(run.back().key, entry.key)) {
+        run.back().message = combine(run.back().message, entry.message);
+      } else {
+        run.push_back(entry);
+      }
+    }
+    buffered_ -= tail_.size() - run.size();
+    tail_.clear();
+    runs_.push_back(std::move(run));
+    while (runs_.size() > 1 && runs_[runs_.size() - 2].size() <= 2 * runs_.back().size()) {
+      Run newer = std::move(runs_.back());
+      runs_.pop_back();
+      Run &older = runs_.back();
+      Run merged;
+      merged.reserve(older.size() + newer.size());
+      auto a = older.begin();
+      auto b = newer.begin();
+      while (a != older.end() || b != newer.end()) {
+        if (b == newer.end() || (a != older.end() && comp_(a->key, b->key))) {
+          merged.push_back(*a++);
+        } else if (a == older.end() || comp_(b->key, a->key)) {
+          merged.push_back(*b++);
+        } else {
+          merged.push_back(Entry{a->key, combine(a->message, b->message)});
+          ++a;
+          ++b;
+          buffered_--;
+        }
+      }
+      older.swap(merged);
+    }
+  }
+
+  // The combined messages of every run for keys in [key_start, *key_end), or
+  // from key_start on if key_end is null, in key order
+  void mergeRuns(const KeyType &key_start, const KeyType *key_end, std::vector<Entry> &out) {
+    std::vector<std::pair<typename Run::iterator, typename Run::iterator>> heads;
+    for (Run &run : runs_) {
+      auto first = lowerBound(run, key_start);
+      auto last = key_end == nullptr ? run.end() : lowerBound(run, *key_end);
+      if (first < last) heads.emplace_back(first, last);
+    }
+    // runs are oldest first, so combining in order lets newer messages win
+    while (!heads.empty()) {
+      const KeyType *key = &heads[0].first->key;
+      for (auto &head : heads) {
+        if (comp_(head.first->key, *key)) key = &head.first->key;
+      }
+      Entry entry{*key, Message()};
+      bool first = true;
+      for (auto &head : heads) {
+        if (!equal(head.first->key, entry.key)) continue;
+        entry.message = first ? head.first->message : combine(entry.message, head.first->message);
+        first = false;
+        ++head.first;
+      }
+      out.push_back(entry);
+      heads.erase(std::remove_if(heads.begin(), heads.end(), [](const auto &head) { return head.first == head.second; }),
+                  heads.end());
+    }
+  }
+
+  const KeyType &minKey() const {
+    const KeyType *key = &runs_[0].front().key;
+    for (const Run &run : runs_) {
+      if (comp_(run.front().key, *key)) key = &run.front().key;
+    }
+    return *key;
+  }
+
+  const KeyType &maxKey() const {
+    const KeyType *key = &runs_[0].back().key;
+    for (const Run &run : runs_) {
+      if (comp_(*key, run.back().key)) key = &run.back().key;
+    }
+    return *key;
+  }
+
+  // Apply the messages of the partition with the most of them and drop them
+  // from the runs; called with an empty tail
+  void flushFullest() {
+    std::vector<KeyType> bounds = tree_.PartitionRange(minKey(), maxKey(), kFlushPartitions);
+    // partition p holds [bounds[p], bounds[p + 1]), the last one also the last key
+    size_t best = 0;
+    size_t best_messages = 0;
+    for (size_t p = 0; p + 1 < bounds.size(); p++) {
+      size_t messages = 0;
+      for (Run &run : runs_) {
+        auto last = p + 2 == bounds.size() ? run.end() : lowerBound(run, bounds[p + 1]);
+        messages += last - lowerBound(run, bounds[p]);
+      }
+      if (messages > best_messages) {
+        best = p;
+        best_messages = messages;
+      }
+    }
+    const KeyType *key_end = best + 2 == bounds.size() ? nullptr : &bounds[best + 1];
+    std::vector<Entry> messages;
+    mergeRuns(bounds[best], key_end, messages);
+    apply(messages);
+    for (Run &run : runs_) {
+      auto first = lowerBound(run, bounds[best]);
+      auto last = key_end == nullptr ? run.end() : lowerBound(run, *key_end);
+      buffered_ -= last - first;
+      run.erase(first, last);
+    }
+    runs_.erase(std::remove_if(runs_.begin(), runs_.end(), [](const Run &run) { return run.empty(); }), runs_.end());
+  }
+
+  void apply(const std::vector<Entry> &messages) {
+    for (const Entry &entry : messages) {
+      switch (entry.message.kind) {
+        case Kind::kInsert:
+          finger_.Insert(entry.key, entry.message.value);
+          break;
+        case Kind::kAssign:
+          finger_.InsertOrAssign(entry.key, entry.message.value);
+          break;
+        case Kind::kRemove:
+          finger_.Remove(entry.key);
+          break;
+      }
+    }
+    flushes_++;
+  }
+
+  TreeType tree_;
+  typename TreeType::Finger finger_;
+  KeyComparator comp_;
+  // unsorted, oldest first
+  std::vector<Entry> tail_;
+  // oldest first
+  std::vector<Run> runs_;
+  size_t buffer_entries_;
+  size_t buffered_ = 0;
+  size_t flushes_ = 0;
+};
@@ -0,0 +1,162 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/disk_b_plus_tree.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "b_plus_tree.h"
+#include "buffer_pool.h"
+#include "disk_manager.h"
+#include "node_search.h"
+
+// Fields shared by both page layouts
+struct DiskNodeHeader {
+  uint32_t is_leaf;
+  int32_t key_num;
+  // leaf chain, INVALID_PAGE_ID at the ends and in internal pages
+  page_id_t next_leaf;
+  page_id_t prev_leaf;
+};
+
+// Leaf page: sorted keys and their values
+template <typename KeyType, typename ValueType>
+struct DiskLeafPage {
+  static constexpr int kCapacity = static_cast<int>(
+      (kPageSize - sizeof(DiskNodeHeader) - alignof(ValueType)) / (sizeof(KeyType) + sizeof(ValueType)));
+  DiskNodeHeader header;
+  KeyType keys[kCapacity];
+  ValueType values[kCapacity];
+};
+
+// Internal page: key_num separators and key_num + 1 child page ids
+template <typename KeyType>
+struct DiskInternalPage {
+  static constexpr int kFanout = static_cast<int>(
+      (kPageSize - sizeof(DiskNodeHeader) - sizeof(page_id_t) - alignof(page_id_t)) /
+      (sizeof(KeyType) + sizeof(page_id_t))) + 1;
+  DiskNodeHeader header;
+  KeyType keys[kFanout - 1];
+  page_id_t children[kFanout];
+};
+
+// Page 0 of an index file
+struct DiskTreeMeta {
+  uint64_t magic;
+  uint32_t key_size;
+  uint32_t value_size;
+  page_id_t root;
+  // first page of the free list; the meta page itself ends the list, so
+  // files written before there was one read as having none
+  page_id_t free_list;
+  uint64_t size;
+};
+
+// A page on the free list
+struct DiskFreePage {
+  page_id_t next_free;
+};
+
+#define DISK_INDEX_TEMPLATE_ARGUMENTS template <typename KeyType, typename ValueType, typename KeyComparator>
+#define DISK_BPLUSTREE_TYPE DiskBPlusTree<KeyType, ValueType, KeyComparator>
+
+/**
+ * B+ tree stored in a local file of kPageSize pages.
+ *
+ * Same search structure as BPlusTree, but nodes are pages addressed by page
+ * id and are reached through a BufferPoolManager, so the index may be much
+ * larger than memory. Pages hold no parent pointers; writers remember the
+ * pinned path from the root instead. Internal pages keep swizzled references
+ * to the frames of their children, so hot paths skip the page table.
+ *
+ * Keys and values are stored as raw bytes and must be trivially copyable.
+ * Remove does not merge underfull pages; freed slots are reused by later
+ * inserts into the same key range. A leaf that becomes empty is unlinked and
+ * dropped from its parent (an internal page left without children goes the
+ * same way, and a root left with one child is replaced by it), and its page
+ * goes on a free list that newPage() takes pages from before growing the
+ * file. Not thread safe.
+ */
+template <typename KeyType = int, typename ValueType = RecordPointer, typename KeyComparator = std::less<KeyType>>
+class DiskBPlusTree {
+  static_assert(std::is_trivially_copyable_v<KeyType> && std::is_trivially_copyable_v<ValueType>,
+                "DiskBPlusTree stores keys and values as raw page bytes");
+
+ public:
+  using LeafPage = DiskLeafPage<KeyType, ValueType>;
+  using InternalPage = DiskInternalPage<KeyType>;
+  static constexpr int LEAF_CAPACITY = LeafPage::kCapacity;
+  static constexpr int INTERNAL_FANOUT = InternalPage::kFanout;
+  static_assert(sizeof(LeafPage) <= kPageSize && sizeof(InternalPage) <= kPageSize, "node must fit in a page");
+  static_assert(LEAF_CAPACITY >= 2 && INTERNAL_FANOUT >= 3, "key or value too large for a page");
+
+  // fewest frames that always hold a root-to-leaf path and a split
+  static constexpr size_t kMinPoolPages = 32;
+
+  // Open the index in path, creating the file if it does not exist, with
+  // pool_pages frames of buffer. IsOpen() reports failure.
+  DiskBPlusTree(const std::string &path, size_t pool_pages, const KeyComparator &comp = KeyComparator());
+  DiskBPlusTree(const DiskBPlusTree &) = delete;
+  DiskBPlusTree &operator=(const DiskBPlusTree &) = delete;
+  ~DiskBPlusTree() { Flush(); }
+
+  bool IsOpen() const { return open_; }
+  bool IsEmpty() const { return size_ == 0; }
+  size_t Size() const { return size_; }
+
+  // Insert a key-value pair, false for a duplicate key
+  bool Insert(const KeyType &key, const ValueType &value);
+
+  // Remove a key, false if it was not present
+  bool Remove(const KeyType &key);
+
+  // return the value associated with a given key
+  bool GetValue(const KeyType &key, ValueType &result);
+
+  // return the values within a key range [key_start, key_end) not included key_end
+  void RangeScan(const KeyType &key_start, const KeyType &key_end, std::vector<ValueType> &result);
+
+  // Write the meta page and every dirty page, then sync the file
+  bool Flush();
+
+  BufferPoolStats GetBufferPoolStats() const { return pool_.Stats(); }
+
+ private:
+  static constexpr uint64_t kMagic = 0x42504c5553545245ULL;  // "BPLUSTRE"
+  static constexpr page_id_t kMetaPageId = 0;
+
+  bool keyEqual(const KeyType &a, const KeyType &b) const { return !comp_(a, b) && !comp_(b, a); }
+  static bool isLeaf(const PageGuard &guard) { return guard.As<DiskNodeHeader>()->is_leaf != 0; }
+  PageGuard fetch(page_id_t page_id);
+  PageGuard newPage();
+  void freePage(PageGuard &guard);
+  bool removeEmptyLeaf(PageGuard &leafGuard, std::vector<PageGuard> &path, std::vector<int> &slots);
+  bool removeFromParent(std::vector<PageGuard> &path, std::vector<int> &slots);
+  PageGuard findLeaf(const KeyType &key, std::vector<PageGuard> *path, std::vector<int> *slots);
+  bool splitLeaf(PageGuard &leafGuard, int index, const KeyType &key, const ValueType &value,
+                 std::vector<PageGuard> &path, std::vector<int> &slots);
+  bool insertIntoParent(std::vector<PageGuard> &path, std::vector<int> &slots, page_id_t left,
+                        const KeyType &kPrime, page_id_t right);
+  bool readMeta();
+  bool writeMeta();
+
+  DiskManager disk_;
+  BufferPoolManager pool_;
+  KeyComparator comp_;
+  page_id_t root_ = INVALID_PAGE_ID;
+  page_id_t free_list_ = kMetaPageId;
+  size_t size_ = 0;
+  bool open_ = false;
+};
+
+#include "disk_b_plus_tree_impl.h"
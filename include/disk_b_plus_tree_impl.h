@@ -0,0 +1,489 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/disk_b_plus_tree_impl.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+// Member definitions of the DiskBPlusTree template, included by disk_b_plus_tree.h.
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+
+DISK_INDEX_TEMPLATE_ARGUMENTS
+DISK_BPLUSTREE_TYPE::DiskBPlusTree(const std::string &path, size_t pool_pages, const KeyComparator &comp)
+    : disk_(path), pool_(std::max(pool_pages, kMinPoolPages), &disk_, INTERNAL_FANOUT), comp_(comp)
+{
+  if(!disk_.IsOpen())
+  {
+    BPT_DIAGNOSTIC("Cannot open index file "<<path);
+    return;
+  }
+  open_ = readMeta();
+}
+
+/*
+ * Helper functions to pin pages through the buffer pool
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+PageGuard DISK_BPLUSTREE_TYPE::fetch(page_id_t page_id)
+{
+  Page* page = pool_.FetchPage(page_id);
+  if(page==nullptr)
+  {
+    BPT_DIAGNOSTIC("Cannot pin page "<<page_id);
+    return PageGuard();
+  }
+  return PageGuard(&pool_,page);
+}
+
+/*
+ * A page from the free list if there is one, else a new page at the end of
+ * the file. Either way it comes back zeroed.
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+PageGuard DISK_BPLUSTREE_TYPE::newPage()
+{
+  if(free_list_!=kMetaPageId)
+  {
+    PageGuard guard = fetch(free_list_);
+    if(!guard) return PageGuard();
+    free_list_ = guard.As<DiskFreePage>()->next_free;
+    std::memset(guard.Get()->data, 0, kPageSize);
+    guard.MarkDirty();
+    DiskNodeHeader* header = guard.As<DiskNodeHeader>();
+    header->next_leaf = INVALID_PAGE_ID;
+    header->prev_leaf = INVALID_PAGE_ID;
+    return guard;
+  }
+  Page* page = pool_.NewPage();
+  if(page==nullptr)
+  {
+    BPT_DIAGNOSTIC("Buffer pool has no free frame");
+    return PageGuard();
+  }
+  PageGuard guard(&pool_,page);
+  guard.MarkDirty();
+  DiskNodeHeader* header = guard.As<DiskNodeHeader>();
+  header->next_leaf = INVALID_PAGE_ID;
+  header->prev_leaf = INVALID_PAGE_ID;
+  return guard;
+}
+
+/*
+ * Load the meta page of an existing file, or write one for a new file
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::readMeta()
+{
+  if(disk_.NumPages()==0)
+  {
+    PageGuard meta = newPage();
+    if(!meta || meta.PageId()!=kMetaPageId) return false;
+    meta.Release();
+    return writeMeta();
+  }
+  PageGuard meta = fetch(kMetaPageId);
+  if(!meta) return false;
+  DiskTreeMeta* m = meta.As<DiskTreeMeta>();
+  if(m->magic!=kMagic || m->key_size!=sizeof(KeyType) || m->value_size!=sizeof(ValueType))
+  {
+    BPT_DIAGNOSTIC("Index file does not match the key and value types");
+    return false;
+  }
+  root_ = m->root;
+  free_list_ = m->free_list;
+  size_ = m->size;
+  return true;
+}
+
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::writeMeta()
+{
+  PageGuard meta = fetch(kMetaPageId);
+  if(!meta) return false;
+  DiskTreeMeta* m = meta.As<DiskTreeMeta>();
+  m->magic = kMagic;
+  m->key_size = sizeof(KeyType);
+  m->value_size = sizeof(ValueType);
+  m->root = root_;
+  m->free_list = free_list_;
+  m->size = size_;
+  meta.MarkDirty();
+  return true;
+}
+
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::Flush()
+{
+  if(!open_) return false;
+  bool ok = writeMeta();
+  ok = pool_.FlushAll() && ok;
+  return disk_.Sync() && ok;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+/*
+ * Walk from the root to the leaf that may hold key. When path is given, the
+ * internal pages stay pinned in it, root first, together with the child slot
+ * taken in each; otherwise every page is unpinned as soon as its child is.
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+PageGuard DISK_BPLUSTREE_TYPE::findLeaf(const KeyType &key, std::vector<PageGuard> *path, std::vector<int> *slots)
+{
+  if(root_==INVALID_PAGE_ID) return PageGuard();
+  PageGuard guard = fetch(root_);
+  while(guard && !isLeaf(guard))
+  {
+    InternalPage* node = guard.As<InternalPage>();
+    int slot = NodeUpperBound(node->keys, node->header.key_num, key, comp_);
+    Page* child = pool_.FetchChild(guard.Get(), slot, node->children[slot]);
+    if(child==nullptr)
+    {
+      BPT_DIAGNOSTIC("Cannot pin page "<<node->children[slot]);
+      return PageGuard();
+    }
+    if(path!=nullptr)
+    {
+      path->push_back(std::move(guard));
+      slots->push_back(slot);
+    }
+    guard = PageGuard(&pool_,child);
+  }
+  return guard;
+}
+
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::GetValue(const KeyType &key, ValueType &result)
+{
+  if(!open_) return false;
+  PageGuard guard = findLeaf(key,nullptr,nullptr);
+  if(!guard) return false;
+  LeafPage* leaf = guard.As<LeafPage>();
+  int n = leaf->header.key_num;
+  int i = NodeLowerBound(leaf->keys, n, key, comp_);
+  if(i<n && keyEqual(leaf->keys[i],key))
+  {
+    result = leaf->values[i];
+    return true;
+  }
+  return false;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value)
+{
+  if(!open_) return false;
+  if(root_==INVALID_PAGE_ID)
+  {
+    PageGuard guard = newPage();
+    if(!guard) return false;
+    LeafPage* leaf = guard.As<LeafPage>();
+    leaf->header.is_leaf = 1;
+    leaf->header.key_num = 1;
+    leaf->keys[0] = key;
+    leaf->values[0] = value;
+    root_ = guard.PageId();
+    size_+=1;
+    return true;
+  }
+
+  std::vector<PageGuard> path;
+  std::vector<int> slots;
+  PageGuard guard = findLeaf(key,&path,&slots);
+  if(!guard) return false;
+  LeafPage* leaf = guard.As<LeafPage>();
+  int n = leaf->header.key_num;
+  int i = NodeLowerBound(leaf->keys, n, key, comp_);
+  if(i<n && keyEqual(leaf->keys[i],key))
+  {
+    BPT_DIAGNOSTIC("Key already exists");
+    return false;
+  }
+  if(n==LEAF_CAPACITY) return splitLeaf(guard,i,key,value,path,slots);
+
+  std::memmove(&leaf->keys[i+1], &leaf->keys[i], (n-i)*sizeof(KeyType));
+  std::memmove(&leaf->values[i+1], &leaf->values[i], (n-i)*sizeof(ValueType));
+  leaf->keys[i] = key;
+  leaf->values[i] = value;
+  leaf->header.key_num+=1;
+  guard.MarkDirty();
+  size_+=1;
+  return true;
+}
+
+/*
+ * Split a full leaf while inserting key at index. The upper entries move to
+ * a new right sibling, which is linked into the leaf chain and announced to
+ * the parent with its first key.
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::splitLeaf(PageGuard &leafGuard, int index, const KeyType &key, const ValueType &value,
+                                    std::vector<PageGuard> &path, std::vector<int> &slots)
+{
+  PageGuard rightGuard = newPage();
+  if(!rightGuard) return false;
+  LeafPage* leaf = leafGuard.As<LeafPage>();
+  LeafPage* right = rightGuard.As<LeafPage>();
+  PageGuard nextGuard;
+  if(leaf->header.next_leaf!=INVALID_PAGE_ID)
+  {
+    nextGuard = fetch(leaf->header.next_leaf);
+    if(!nextGuard) return false;
+  }
+
+  // entries left behind once the new key is in
+  const int leftCount = (LEAF_CAPACITY+1)/2;
+  const int n = leaf->header.key_num;
+  int from = index<leftCount ? leftCount-1 : leftCount;
+  right->header.is_leaf = 1;
+  right->header.key_num = n-from;
+  std::memcpy(right->keys, &leaf->keys[from], (n-from)*sizeof(KeyType));
+  std::memcpy(right->values, &leaf->values[from], (n-from)*sizeof(ValueType));
+  leaf->header.key_num = from;
+
+  LeafPage* target = index<leftCount ? leaf : right;
+  int pos = index<leftCount ? index : index-leftCount;
+  int len = target->header.key_num;
+  std::memmove(&target->keys[pos+1], &target->keys[pos], (len-pos)*sizeof(KeyType));
+  std::memmove(&target->values[pos+1], &target->values[pos], (len-pos)*sizeof(ValueType));
+  target->keys[pos] = key;
+  target->values[pos] = value;
+  target->header.key_num+=1;
+
+  right->header.next_leaf = leaf->header.next_leaf;
+  right->header.prev_leaf = leafGuard.PageId();
+  if(nextGuard)
+  {
+    nextGuard.As<LeafPage>()->header.prev_leaf = rightGuard.PageId();
+    nextGuard.MarkDirty();
+    nextGuard.Release();
+  }
+  leaf->header.next_leaf = rightGuard.PageId();
+  leafGuard.MarkDirty();
+  size_+=1;
+
+  KeyType kPrime = right->keys[0];
+  page_id_t leftId = leafGuard.PageId();
+  page_id_t rightId = rightGuard.PageId();
+  leafGuard.Release();
+  rightGuard.Release();
+  return insertIntoParent(path,slots,leftId,kPrime,rightId);
+}
+
+/*
+ * Add separator kPrime and the new page right after left, in the parent at
+ * the end of path. A full parent is split the same way and its middle key
+ * moves one level up; splitting the root grows the tree.
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::insertIntoParent(std::vector<PageGuard> &path, std::vector<int> &slots, page_id_t left,
+                                           const KeyType &kPrime, page_id_t right)
+{
+  if(path.empty())
+  {
+    PageGuard rootGuard = newPage();
+    if(!rootGuard) return false;
+    InternalPage* newRoot = rootGuard.As<InternalPage>();
+    newRoot->header.is_leaf = 0;
+    newRoot->header.key_num = 1;
+    newRoot->keys[0] = kPrime;
+    newRoot->children[0] = left;
+    newRoot->children[1] = right;
+    root_ = rootGuard.PageId();
+    return true;
+  }
+
+  PageGuard parentGuard = std::move(path.back());
+  path.pop_back();
+  int slot = slots.back();
+  slots.pop_back();
+  InternalPage* parent = parentGuard.As<InternalPage>();
+  int n = parent->header.key_num;
+  parentGuard.MarkDirty();
+  if(n<INTERNAL_FANOUT-1)
+  {
+    std::memmove(&parent->keys[slot+1], &parent->keys[slot], (n-slot)*sizeof(KeyType));
+    std::memmove(&parent->children[slot+2], &parent->children[slot+1], (n-slot)*sizeof(page_id_t));
+    parent->keys[slot] = kPrime;
+    parent->children[slot+1] = right;
+    parent->header.key_num+=1;
+    return true;
+  }
+
+  PageGuard siblingGuard = newPage();
+  if(!siblingGuard) return false;
+  std::vector<KeyType> keys(parent->keys, parent->keys+n);
+  std::vector<page_id_t> children(parent->children, parent->children+n+1);
+  keys.insert(keys.begin()+slot, kPrime);
+  children.insert(children.begin()+slot+1, right);
+
+  // n+1 keys: the left half stays, the middle one moves up, the rest go right
+  const int leftKeys = (n+1)/2;
+  const int rightKeys = n-leftKeys;
+  InternalPage* sibling = siblingGuard.As<InternalPage>();
+  sibling->header.is_leaf = 0;
+  sibling->header.key_num = rightKeys;
+  std::copy(keys.begin()+leftKeys+1, keys.end(), sibling->keys);
+  std::copy(children.begin()+leftKeys+1, children.end(), sibling->children);
+  parent->header.key_num = leftKeys;
+  std::copy(keys.begin(), keys.begin()+leftKeys, parent->keys);
+  std::copy(children.begin(), children.begin()+leftKeys+1, parent->children);
+
+  KeyType middle = keys[leftKeys];
+  page_id_t parentId = parentGuard.PageId();
+  page_id_t siblingId = siblingGuard.PageId();
+  parentGuard.Release();
+  siblingGuard.Release();
+  return insertIntoParent(path,slots,parentId,middle,siblingId);
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+/*
+ * Delete the entry for key from its leaf. Pages are not merged, so the
+ * separators above stay valid as they are; only a leaf left empty leaves the
+ * tree.
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::Remove(const KeyType &key)
+{
+  if(!open_) return false;
+  std::vector<PageGuard> path;
+  std::vector<int> slots;
+  PageGuard guard = findLeaf(key,&path,&slots);
+  if(!guard) return false;
+  LeafPage* leaf = guard.As<LeafPage>();
+  int n = leaf->header.key_num;
+  int i = NodeLowerBound(leaf->keys, n, key, comp_);
+  if(i==n || !keyEqual(leaf->keys[i],key))
+  {
+    BPT_DIAGNOSTIC("Key not found for key "<<key);
+    return false;
+  }
+  std::memmove(&leaf->keys[i], &leaf->keys[i+1], (n-i-1)*sizeof(KeyType));
+  std::memmove(&leaf->values[i], &leaf->values[i+1], (n-i-1)*sizeof(ValueType));
+  leaf->header.key_num-=1;
+  guard.MarkDirty();
+  size_-=1;
+  if(leaf->header.key_num==0) return removeEmptyLeaf(guard,path,slots);
+  return true;
+}
+
+/*
+ * Unlink an empty leaf from the leaf chain, take it out of its parent and
+ * free its page. An empty root leaf empties the tree.
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::removeEmptyLeaf(PageGuard &leafGuard, std::vector<PageGuard> &path, std::vector<int> &slots)
+{
+  LeafPage* leaf = leafGuard.As<LeafPage>();
+  if(leaf->header.prev_leaf!=INVALID_PAGE_ID)
+  {
+    PageGuard prevGuard = fetch(leaf->header.prev_leaf);
+    if(!prevGuard) return false;
+    prevGuard.As<LeafPage>()->header.next_leaf = leaf->header.next_leaf;
+    prevGuard.MarkDirty();
+  }
+  if(leaf->header.next_leaf!=INVALID_PAGE_ID)
+  {
+    PageGuard nextGuard = fetch(leaf->header.next_leaf);
+    if(!nextGuard) return false;
+    nextGuard.As<LeafPage>()->header.prev_leaf = leaf->header.prev_leaf;
+    nextGuard.MarkDirty();
+  }
+  freePage(leafGuard);
+  if(path.empty())
+  {
+    root_ = INVALID_PAGE_ID;
+    return true;
+  }
+  return removeFromParent(path,slots);
+}
+
+/*
+ * Drop the child in the last slot of path, with the separator before it (or
+ * after it, for the first child), from the parent at the end of path. A
+ * parent that loses its only child is freed and dropped from its own parent
+ * in turn; a root left with one child is replaced by that child.
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+bool DISK_BPLUSTREE_TYPE::removeFromParent(std::vector<PageGuard> &path, std::vector<int> &slots)
+{
+  PageGuard parentGuard = std::move(path.back());
+  path.pop_back();
+  int slot = slots.back();
+  slots.pop_back();
+  InternalPage* parent = parentGuard.As<InternalPage>();
+  int n = parent->header.key_num;
+  if(n==0)
+  {
+    freePage(parentGuard);
+    if(path.empty())
+    {
+      root_ = INVALID_PAGE_ID;
+      return true;
+    }
+    return removeFromParent(path,slots);
+  }
+  int key = slot>0 ? slot-1 : 0;
+  std::memmove(&parent->keys[key], &parent->keys[key+1], (n-key-1)*sizeof(KeyType));
+  std::memmove(&parent->children[slot], &parent->children[slot+1], (n-slot)*sizeof(page_id_t));
+  parent->header.key_num-=1;
+  parentGuard.MarkDirty();
+  if(path.empty() && parent->header.key_num==0)
+  {
+    root_ = parent->children[0];
+    freePage(parentGuard);
+  }
+  return true;
+}
+
+/*
+ * Put the page on the free list and unpin it
+ */
+DISK_INDEX_TEMPLATE_ARGUMENTS
+void DISK_BPLUSTREE_TYPE::freePage(PageGuard &guard)
+{
+  page_id_t pageId = guard.PageId();
+  std::memset(guard.Get()->data, 0, kPageSize);
+  guard.As<DiskFreePage>()->next_free = free_list_;
+  guard.MarkDirty();
+  guard.Release();
+  free_list_ = pageId;
+}
+
+/*****************************************************************************
+ * RANGE_SCAN
+ *****************************************************************************/
+DISK_INDEX_TEMPLATE_ARGUMENTS
+void DISK_BPLUSTREE_TYPE::RangeScan(const KeyType &key_start, const KeyType &key_end, std::vector<ValueType> &result)
+{
+  if(!open_) return;
+  PageGuard guard = findLeaf(key_start,nullptr,nullptr);
+  if(!guard) return;
+  int i = NodeLowerBound(guard.As<LeafPage>()->keys, guard.As<LeafPage>()->header.key_num, key_start, comp_);
+  while(guard)
+  {
+    LeafPage* leaf = guard.As<LeafPage>();
+    for(;i<leaf->header.key_num;i++)
+    {
+      if(!comp_(leaf->keys[i],key_end)) return;
+      result.push_back(leaf->values[i]);
+    }
+    page_id_t next = leaf->header.next_leaf;
+    if(next==INVALID_PAGE_ID) return;
+    guard = fetch(next);
+    i = 0;
+  }
+}
@@ -0,0 +1,81 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/disk_manager.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using page_id_t = int32_t;
+constexpr page_id_t INVALID_PAGE_ID = -1;
+constexpr size_t kPageSize = 4096;
+
+/**
+ * Reads and writes fixed-size pages of one local file. Page i lives at byte
+ * offset i * kPageSize; new pages are appended at the end of the file.
+ */
+class DiskManager {
+ public:
+  explicit DiskManager(const std::string &path) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) return;
+    struct stat st;
+    if (::fstat(fd_, &st) == 0) num_pages_ = static_cast<page_id_t>(st.st_size / kPageSize);
+  }
+  DiskManager(const DiskManager &) = delete;
+  DiskManager &operator=(const DiskManager &) = delete;
+  ~DiskManager() {
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  bool IsOpen() const { return fd_ >= 0; }
+  page_id_t NumPages() const { return num_pages_; }
+
+  // Reserve the next page id at the end of the file. The page only reaches
+  // the disk on its first write.
+  page_id_t AllocatePage() { return num_pages_++; }
+
+  bool ReadPage(page_id_t page_id, char *data) {
+    ssize_t n = ::pread(fd_, data, kPageSize, static_cast<off_t>(page_id) * kPageSize);
+    if (n < 0) return false;
+    // allocated but never written: reads as zeros
+    if (static_cast<size_t>(n) < kPageSize) std::memset(data + n, 0, kPageSize - n);
+    reads_++;
+    return true;
+  }
+
+  bool WritePage(page_id_t page_id, const char *data) {
+    size_t done = 0;
+    while (done < kPageSize) {
+      ssize_t n = ::pwrite(fd_, data + done, kPageSize - done, static_cast<off_t>(page_id) * kPageSize + done);
+      if (n <= 0) return false;
+      done += n;
+    }
+    writes_++;
+    return true;
+  }
+
+  bool Sync() { return ::fdatasync(fd_) == 0; }
+
+  size_t Reads() const { return reads_; }
+  size_t Writes() const { return writes_; }
+
+ private:
+  int fd_ = -1;
+  page_id_t num_pages_ = 0;
+  size_t reads_ = 0;
+  size_t writes_ = 0;
+};
@@ -0,0 +1,232 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/durable_b_plus_tree.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "b_plus_tree.h"
+#include "write_ahead_log.h"
+
+/**
+ * In-memory BPlusTree made crash safe with a logical write-ahead log.
+ *
+ * Every successful Insert and Remove is logged before it returns, as durable
+ * as WalOptions::sync_mode promises. Checkpoint() writes the whole tree to
+ * <path>.ckpt and empties the log <path>.wal; Recover() bulk-loads the last
+ * checkpoint and replays the log records newer than it.
+ *
+ * Operations on the same key are serialized by lock striping, so their log
+ * order matches the order they were applied in. With the tree in thread-safe
+ * mode (Tree().SetThreadSafe(true)) writers run in parallel and share group
+ * commits. Keys and values are logged as raw bytes and must be trivially
+ * copyable.
+ */
+template <typename KeyType = int, typename ValueType = RecordPointer,
+          int Fanout = kFanoutForNodeBytes<KeyType, ValueType, kDefaultNodeBytes>,
+          typename KeyComparator = std::less<KeyType>>
+class DurableBPlusTree {
+  static_assert(std::is_trivially_copyable_v<KeyType> && std::is_trivially_copyable_v<ValueType>,
+                "DurableBPlusTree logs keys and values as raw bytes");
+
+ public:
+  using TreeType = BPlusTree<KeyType, ValueType, Fanout, KeyComparator>;
+
+  explicit DurableBPlusTree(const std::string &path, const WalOptions &options = WalOptions(),
+                            const KeyComparator &comp = KeyComparator())
+      : checkpoint_path_(path + ".ckpt"), wal_path_(path + ".wal"), options_(options), tree_(comp) {}
+
+  // Rebuild the tree from the checkpoint and the log and open the log for
+  // new records. Must be called once before anything else.
+  bool Recover() {
+    wal_.reset();
+    uint64_t checkpoint_lsn = 0;
+    if (!readCheckpoint(checkpoint_lsn)) return false;
+
+    size_t valid_bytes = 0;
+    uint64_t last = WriteAheadLog::Replay(
+        wal_path_,
+        [&](uint64_t lsn, const char *payload, size_t len) {
+          if (lsn <= checkpoint_lsn || len != kRecordBytes) return;
+          KeyType key;
+          ValueType value;
+          std::memcpy(&key, payload + 1, sizeof(KeyType));
+          std::memcpy(&value, payload + 1 + sizeof(KeyType), sizeof(ValueType));
+          if (payload[0] == kInsertRecord) {
+            tree_.Insert(key, value);
+          } else {
+            tree_.Remove(key);
+          }
+        },
+        &valid_bytes);
+    // drop a torn tail so new records do not land behind it
+    if (::truncate(wal_path_.c_str(), valid_bytes) != 0 && errno != ENOENT) return false;
+
+    wal_ = std::make_unique<WriteAheadLog>(wal_path_, options_, std::max(last, checkpoint_lsn) + 1);
+    if (!wal_->IsOpen()) {
+      BPT_DIAGNOSTIC("Cannot open log " << wal_path_);
+      wal_.reset();
+      return false;
+    }
+    return true;
+  }
+
+  bool Insert(const KeyType &key, const ValueType &value) {
+    if (wal_ == nullptr) return false;
+    uint64_t lsn;
+    {
+      std::lock_guard<std::mutex> guard(stripe(key));
+      if (!tree_.Insert(key, value)) return false;
+      lsn = log(kInsertRecord, key, value);
+    }
+    return wal_->Commit(lsn);
+  }
+
+  bool Remove(const KeyType &key) {
+    if (wal_ == nullptr) return false;
+    uint64_t lsn;
+    {
+      std::lock_guard<std::mutex> guard(stripe(key));
+      ValueType old;
+      if (tree_.Remove(key, &old) != WriteStatus::kRemoved) return false;
+      lsn = log(kRemoveRecord, key, old);
+    }
+    return wal_->Commit(lsn);
+  }
+
+  bool GetValue(const KeyType &key, ValueType &result) { return tree_.GetValue(key, result); }
+
+  void RangeScan(const KeyType &key_start, const KeyType &key_end, std::vector<ValueType> &result) {
+    tree_.RangeScan(key_start, key_end, result);
+  }
+
+  // Write every entry to a new checkpoint and empty the log. Must not run
+  // concurrently with any other call.
+  bool Checkpoint() {
+    if (wal_ == nullptr || !wal_->Sync()) return false;
+    uint64_t lsn = wal_->LastLsn();
+    if (!writeCheckpoint(lsn)) return false;
+    return wal_->Truncate();
+  }
+
+  TreeType &Tree() { return tree_; }
+  size_t LogSyncs() const { return wal_ == nullptr ? 0 : wal_->Syncs(); }
+
+ private:
+  static constexpr char kInsertRecord = 1;
+  static constexpr char kRemoveRecord = 2;
+  static constexpr size_t kRecordBytes = 1 + sizeof(KeyType) + sizeof(ValueType);
+  static constexpr uint64_t kCheckpointMagic = 0x43484b5054524545ULL;  // "CHKPTREE"
+  static constexpr size_t kStripes = 64;
+
+  struct CheckpointHeader {
+    uint64_t magic;
+    uint64_t lsn;
+    uint64_t count;
+    uint32_t key_size;
+    uint32_t value_size;
+  };
+
+  std::mutex &stripe(const KeyType &key) {
+    // FNV-1a over the key bytes; keys are trivially copyable
+    const auto *bytes = reinterpret_cast<const unsigned char *>(&key);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < sizeof(KeyType); i++) hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    return stripes_[hash % kStripes];
+  }
+
+  uint64_t log(char op, const KeyType &key, const ValueType &value) {
+    char record[kRecordBytes];
+    record[0] = op;
+    std::memcpy(record + 1, &key, sizeof(KeyType));
+    std::memcpy(record + 1 + sizeof(KeyType), &value, sizeof(ValueType));
+    return wal_->Append(record, kRecordBytes);
+  }
+
+  // Load the checkpoint if there is one; lsn is the last record it covers
+  bool readCheckpoint(uint64_t &lsn) {
+    tree_.Clear();
+    FILE *file = std::fopen(checkpoint_path_.c_str(), "rb");
+    if (file == nullptr) return true;
+    CheckpointHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == kCheckpointMagic &&
+              header.key_size == sizeof(KeyType) && header.value_size == sizeof(ValueType);
+    std::vector<std::pair<KeyType, ValueType>> entries;
+    if (ok) {
+      entries.resize(header.count);
+      for (auto &entry : entries) {
+        ok = ok && std::fread(&entry.first, sizeof(KeyType), 1, file) == 1 &&
+             std::fread(&entry.second, sizeof(ValueType), 1, file) == 1;
+      }
+    }
+    std::fclose(file);
+    if (!ok || !tree_.BulkLoad(entries)) {
+      BPT_DIAGNOSTIC("Checkpoint " << checkpoint_path_ << " is damaged");
+      return false;
+    }
+    lsn = header.lsn;
+    return true;
+  }
+
+  // Write to a temporary file, sync it and rename it over the old checkpoint
+  bool writeCheckpoint(uint64_t lsn) {
+    std::string tmp = checkpoint_path_ + ".tmp";
+    FILE *file = std::fopen(tmp.c_str(), "wb");
+    if (file == nullptr) return false;
+    bool thread_safe = tree_.IsThreadSafe();
+    if (thread_safe) tree_.SetThreadSafe(false);
+
+    CheckpointHeader header{kCheckpointMagic, lsn, 0, sizeof(KeyType), sizeof(ValueType)};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    for (auto cursor = tree_.Begin(); ok && cursor.Valid(); cursor.Next()) {
+      ok = std::fwrite(&cursor.Key(), sizeof(KeyType), 1, file) == 1 &&
+           std::fwrite(&cursor.Value(), sizeof(ValueType), 1, file) == 1;
+      header.count++;
+    }
+    if (thread_safe) tree_.SetThreadSafe(true);
+
+    ok = ok && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && std::fflush(file) == 0 && ::fsync(::fileno(file)) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    ok = ok && std::rename(tmp.c_str(), checkpoint_path_.c_str()) == 0;
+    if (ok) syncDirectory();
+    return ok;
+  }
+
+  // make the rename itself durable
+  void syncDirectory() {
+    size_t slash = checkpoint_path_.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : checkpoint_path_.substr(0, slash + 1);
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+  }
+
+  std::string checkpoint_path_;
+  std::string wal_path_;
+  WalOptions options_;
+  TreeType tree_;
+  std::unique_ptr<WriteAheadLog> wal_;
+  std::array<std::mutex, kStripes> stripes_;
+};
@@ -0,0 +1,135 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/epoch_manager.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * Hands out small dense ids to threads and reuses them after a thread exits,
+ * so every EpochManager can keep a fixed array of per-thread slots.
+ */
+class EpochThreadRegistry {
+ public:
+  static constexpr int kMaxThreads = 1024;
+
+  static EpochThreadRegistry &Instance() {
+    static EpochThreadRegistry registry;
+    return registry;
+  }
+
+  int Acquire() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    int id;
+    if (!free_ids_.empty()) {
+      id = free_ids_.back();
+      free_ids_.pop_back();
+    } else {
+      if (next_id_ == kMaxThreads) throw std::length_error("too many threads for EpochManager");
+      id = next_id_++;
+      high_water_.store(next_id_, std::memory_order_release);
+    }
+    return id;
+  }
+
+  void Release(int id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    free_ids_.push_back(id);
+  }
+
+  // one past the largest id handed out so far
+  int HighWater() const { return high_water_.load(std::memory_order_acquire); }
+
+ private:
+  std::mutex mutex_;
+  std::vector<int> free_ids_;
+  int next_id_ = 0;
+  std::atomic<int> high_water_{0};
+};
+
+// id of the calling thread in every EpochManager
+inline int EpochThreadSlot() {
+  struct Registration {
+    int id = EpochThreadRegistry::Instance().Acquire();
+    ~Registration() { EpochThreadRegistry::Instance().Release(id); }
+  };
+  thread_local Registration registration;
+  return registration.id;
+}
+
+/**
+ * Epoch-based reclamation.
+ *
+ * A thread announces the global epoch it saw while it may hold pointers into
+ * the tree. Memory unlinked during epoch e may be freed once every announced
+ * epoch is newer than e, because no thread can still be reading it.
+ */
+class EpochManager {
+ public:
+  EpochManager() : slots_(new Slot[EpochThreadRegistry::kMaxThreads]) {}
+
+  void Enter() {
+    Slot &slot = slots_[EpochThreadSlot()];
+    if (slot.depth++ == 0) {
+      slot.epoch.store(global_epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+      // the announcement must be visible before the first node is read
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void Exit() {
+    Slot &slot = slots_[EpochThreadSlot()];
+    if (--slot.depth == 0) slot.epoch.store(kIdle, std::memory_order_release);
+  }
+
+  uint64_t Current() const { return global_epoch_.load(std::memory_order_acquire); }
+
+  // Start a new epoch and return the oldest epoch some thread may still be in.
+  // Anything retired before that epoch can be freed.
+  uint64_t Advance() {
+    uint64_t oldest = global_epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int used = EpochThreadRegistry::Instance().HighWater();
+    for (int i = 0; i < used; i++) {
+      uint64_t epoch = slots_[i].epoch.load(std::memory_order_acquire);
+      if (epoch != kIdle && epoch < oldest) oldest = epoch;
+    }
+    return oldest;
+  }
+
+ private:
+  static constexpr uint64_t kIdle = 0;
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch{kIdle};
+    // nesting depth, only touched by the owning thread
+    int depth = 0;
+  };
+
+  std::atomic<uint64_t> global_epoch_{1};
+  std::unique_ptr<Slot[]> slots_;
+};
+
+// Keeps the calling thread inside an epoch for the lifetime of the guard
+class EpochGuard {
+ public:
+  explicit EpochGuard(EpochManager &manager) : manager_(manager) { manager_.Enter(); }
+  ~EpochGuard() { manager_.Exit(); }
+  EpochGuard(const EpochGuard &) = delete;
+  EpochGuard &operator=(const EpochGuard &) = delete;
+
+ private:
+  EpochManager &manager_;
+};
@@ -0,0 +1,196 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/frozen_b_plus_tree.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <span>
+#include <utility>
+#include <vector>
+#include "node_search.h"
+
+// a frozen node is one cache line of keys
+constexpr size_t kFrozenNodeBytes = 64;
+
+template <typename KeyType>
+inline constexpr int kFrozenNodeKeys = std::max<int>(4, static_cast<int>(kFrozenNodeBytes / sizeof(KeyType)));
+
+// std::allocator with allocations starting on a cache line
+template <typename T>
+struct CacheAlignedAllocator {
+  using value_type = T;
+
+  CacheAlignedAllocator() = default;
+  template <typename U>
+  CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(kFrozenNodeBytes)));
+  }
+  void deallocate(T *p, size_t) { ::operator delete(p, std::align_val_t(kFrozenNodeBytes)); }
+  bool operator==(const CacheAlignedAllocator &) const { return true; }
+};
+
+/**
+ * Immutable snapshot of a B+ tree, see BPlusTree::Freeze.
+ *
+ * The entries sit in two contiguous arrays, keys and values, cut into
+ * leaf blocks of NodeKeys keys (one cache line for the default). The levels
+ * above are a static B+ tree (S+ tree) without child pointers: node k of a
+ * level has children k * (NodeKeys + 1) + i on the level below, and its key i
+ * is the smallest key under child i + 1. All levels are stored top first in
+ * one cache-aligned array, so a lookup reads one line per level and the next
+ * line's address is known as soon as the current one is searched, which
+ * MultiGet uses to keep a group of lookups' misses in flight together.
+ *
+ * Keys must be unique and handed over sorted under KeyComparator.
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator = std::less<KeyType>,
+          int NodeKeys = kFrozenNodeKeys<KeyType>>
+class FrozenBPlusTree {
+  static_assert(NodeKeys >= 2, "a frozen node needs at least two keys");
+
+ public:
+  explicit FrozenBPlusTree(const KeyComparator &comp = KeyComparator()) : comp_(comp) {}
+  FrozenBPlusTree(std::vector<KeyType> keys, std::vector<ValueType> values, const KeyComparator &comp = KeyComparator())
+      : keys_(keys.begin(), keys.end()), values_(std::move(values)), comp_(comp) {
+    build();
+  }
+
+  size_t Size() const { return keys_.size(); }
+  bool IsEmpty() const { return keys_.empty(); }
+  // levels including the leaf blocks
+  int Height() const { return IsEmpty() ? 0 : static_cast<int>(blocks_.size()); }
+  size_t MemoryBytes() const {
+    return keys_.capacity() * sizeof(KeyType) + values_.capacity() * sizeof(ValueType) +
+           index_.capacity() * sizeof(KeyType);
+  }
+
+  // Position of the first entry not less than key, Size() if there is none
+  size_t LowerBound(const KeyType &key) const { return search<false>(key); }
+  // Position of the first entry greater than key
+  size_t UpperBound(const KeyType &key) const { return search<true>(key); }
+  const KeyType &KeyAt(size_t i) const { return keys_[i]; }
+  const ValueType &ValueAt(size_t i) const { return values_[i]; }
+
+  bool GetValue(const KeyType &key, ValueType &result) const {
+    size_t pos = LowerBound(key);
+    if (pos == keys_.size() || comp_(key, keys_[pos])) return false;
+    result = values_[pos];
+    return true;
+  }
+
+  // Batched point lookups, with the same contract as BPlusTree::MultiGet
+  size_t MultiGet(std::span<const KeyType> keys, std::span<ValueType> results, std::vector<bool> &found) const {
+    assert(results.size() >= keys.size());
+    found.assign(keys.size(), false);
+    if (IsEmpty()) return 0;
+    size_t hits = 0;
+    size_t node[kMultiGetGroup];
+    for (size_t base = 0; base < keys.size(); base += kMultiGetGroup) {
+      int len = static_cast<int>(std::min<size_t>(kMultiGetGroup, keys.size() - base));
+      std::fill(node, node + len, 0);
+      for (int level = static_cast<int>(blocks_.size()) - 1; level > 0; level--) {
+        for (int i = 0; i < len; i++) {
+          node[i] = child(level, node[i], keys[base + i]);
+          __builtin_prefetch(level > 1 ? indexNode(level - 1, node[i]) : keys_.data() + node[i] * NodeKeys);
+        }
+      }
+      for (int i = 0; i < len; i++) {
+        size_t pos = leafBound<false>(node[i], keys[base + i]);
+        if (pos < keys_.size() && !comp_(keys[base + i], keys_[pos])) {
+          results[base + i] = values_[pos];
+          found[base + i] = true;
+          hits++;
+        }
+      }
+    }
+    return hits;
+  }
+
+  // Values within [key_start, key_end)
+  void RangeScan(const KeyType &key_start, const KeyType &key_end, std::vector<ValueType> &result) const {
+    size_t pos = LowerBound(key_start);
+    // a second descent instead of walking the keys up to key_end; an end
+    // before the start is an empty range
+    size_t end = std::max(pos, LowerBound(key_end));
+    result.insert(result.end(), values_.begin() + pos, values_.begin() + end);
+  }
+
+ private:
+  using KeyArray = std::vector<KeyType, CacheAlignedAllocator<KeyType>>;
+  static constexpr int kMultiGetGroup = 16;
+
+  // Lay out the levels above the leaf blocks, top first
+  void build() {
+    blocks_.clear();
+    index_.clear();
+    if (keys_.empty()) return;
+    blocks_.push_back((keys_.size() + NodeKeys - 1) / NodeKeys);
+    while (blocks_.back() > 1) blocks_.push_back((blocks_.back() + NodeKeys) / (NodeKeys + 1));
+    offsets_.assign(blocks_.size(), 0);
+    size_t nodes = 0;
+    for (size_t level = blocks_.size() - 1; level > 0; level--) {
+      offsets_[level] = nodes;
+      nodes += blocks_[level];
+    }
+    index_.resize(nodes * NodeKeys);
+    // leaf blocks under one node of the level below
+    size_t span = 1;
+    for (size_t level = 1; level < blocks_.size(); level++) {
+      KeyType *out = index_.data() + offsets_[level] * NodeKeys;
+      for (size_t k = 0; k < blocks_[level]; k++) {
+        for (int i = 0; i < NodeKeys; i++) {
+          size_t below = k * (NodeKeys + 1) + i + 1;
+          if (below < blocks_[level - 1]) out[k * NodeKeys + i] = keys_[below * span * NodeKeys];
+        }
+      }
+      span *= NodeKeys + 1;
+    }
+  }
+
+  const KeyType *indexNode(int level, size_t k) const { return index_.data() + (offsets_[level] + k) * NodeKeys; }
+
+  // Child of node k on level to descend into for key
+  size_t child(int level, size_t k, const KeyType &key) const {
+    int used = static_cast<int>(std::min<size_t>(NodeKeys, blocks_[level - 1] - k * (NodeKeys + 1) - 1));
+    return k * (NodeKeys + 1) + NodeUpperBound(indexNode(level, k), used, key, comp_);
+  }
+
+  template <bool Upper>
+  size_t leafBound(size_t block, const KeyType &key) const {
+    size_t first = block * NodeKeys;
+    int used = static_cast<int>(std::min<size_t>(NodeKeys, keys_.size() - first));
+    const KeyType *keys = keys_.data() + first;
+    return first + (Upper ? NodeUpperBound(keys, used, key, comp_) : NodeLowerBound(keys, used, key, comp_));
+  }
+
+  template <bool Upper>
+  size_t search(const KeyType &key) const {
+    if (IsEmpty()) return 0;
+    size_t k = 0;
+    for (int level = static_cast<int>(blocks_.size()) - 1; level > 0; level--) k = child(level, k, key);
+    return leafBound<Upper>(k, key);
+  }
+
+  KeyArray keys_;
+  std::vector<ValueType> values_;
+  // levels above the leaf blocks, NodeKeys slots per node
+  KeyArray index_;
+  // blocks_[level]: nodes on a level, leaf blocks being level 0
+  std::vector<size_t> blocks_;
+  // offsets_[level]: first node of a level in index_
+  std::vector<size_t> offsets_;
+  KeyComparator comp_;
+};
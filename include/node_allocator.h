@@ -0,0 +1,262 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/node_allocator.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Memory accounting reported by a node allocator
+struct NodeAllocatorStats {
+  size_t bytes_reserved = 0;  // obtained from the system
+  size_t bytes_live = 0;      // held by nodes in use
+  size_t bytes_free = 0;      // on free lists or not carved out of a slab yet
+  size_t live_nodes = 0;
+  size_t free_nodes = 0;
+  // filled in by the tree, the allocator only knows sizes
+  size_t leaf_nodes = 0;
+  size_t internal_nodes = 0;
+};
+
+struct SlabOptions {
+  // bytes requested from the system per slab
+  size_t slab_bytes = 256 * 1024;
+  // back slabs with 2 MiB transparent huge pages (Linux, madvise mode)
+  bool huge_pages = false;
+};
+
+/**
+ * Size-class slab allocator for tree nodes.
+ *
+ * Every distinct node size gets its own size class. A class carves objects out
+ * of large slabs with a bump pointer and recycles returned objects through an
+ * intrusive free list, so splits never reach malloc and merged nodes are
+ * reused by the next split. Reset() hands every slab back at once, which lets
+ * the tree drop all of its nodes without visiting them.
+ */
+class SlabNodeAllocator {
+ public:
+  // nodes can be released together through Reset()
+  static constexpr bool kBulkRelease = true;
+
+  explicit SlabNodeAllocator(const SlabOptions &options = SlabOptions()) : options_(options) {
+    if (options_.huge_pages && options_.slab_bytes < kHugePageBytes) options_.slab_bytes = kHugePageBytes;
+  }
+  SlabNodeAllocator(const SlabNodeAllocator &) = delete;
+  SlabNodeAllocator &operator=(const SlabNodeAllocator &) = delete;
+  SlabNodeAllocator(SlabNodeAllocator &&other) noexcept { *this = std::move(other); }
+  SlabNodeAllocator &operator=(SlabNodeAllocator &&other) noexcept {
+    if (this != &other) {
+      Reset();
+      options_ = other.options_;
+      classes_ = std::move(other.classes_);
+      slabs_ = std::move(other.slabs_);
+      stats_ = other.stats_;
+      other.classes_.clear();
+      other.slabs_.clear();
+      other.stats_ = NodeAllocatorStats();
+    }
+    return *this;
+  }
+  ~SlabNodeAllocator() { Reset(); }
+
+  template <typename T, typename... Args>
+  T *New(Args &&...args) {
+    return NewBytes<T>(sizeof(T), std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  void Delete(T *obj) {
+    DeleteBytes(obj, sizeof(T));
+  }
+
+  // Objects followed by a variable-sized tail, e.g. packed leaves. bytes
+  // includes sizeof(T) and has to be passed to DeleteBytes again.
+  template <typename T, typename... Args>
+  T *NewBytes(size_t bytes, Args &&...args) {
+    return new (allocate(bytes)) T(std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  void DeleteBytes(T *obj, size_t bytes) {
+    if (obj == nullptr) return;
+    obj->~T();
+    deallocate(obj, bytes);
+  }
+
+  // Release every slab. Objects are not destroyed, so the caller must not
+  // hold nodes with non-trivial destructors.
+  void Reset() {
+    for (auto &slab : slabs_) releaseSlab(slab.first, slab.second);
+    slabs_.clear();
+    classes_.clear();
+    stats_ = NodeAllocatorStats();
+  }
+
+  NodeAllocatorStats Stats() const { return stats_; }
+
+ private:
+  static constexpr size_t kAlignment = 64;
+  static constexpr size_t kHugePageBytes = 2 * 1024 * 1024;
+
+  struct FreeObject {
+    FreeObject *next;
+  };
+
+  struct SizeClass {
+    size_t object_bytes;
+    FreeObject *free_list = nullptr;
+    char *bump = nullptr;
+    char *bump_end = nullptr;
+  };
+
+  static size_t roundUp(size_t bytes) { return (bytes + kAlignment - 1) / kAlignment * kAlignment; }
+
+  SizeClass &classFor(size_t bytes) {
+    size_t object_bytes = roundUp(bytes);
+    for (auto &cls : classes_) {
+      if (cls.object_bytes == object_bytes) return cls;
+    }
+    classes_.push_back(SizeClass{object_bytes});
+    return classes_.back();
+  }
+
+  void *allocate(size_t bytes) {
+    SizeClass &cls = classFor(bytes);
+    void *obj;
+    if (cls.free_list != nullptr) {
+      obj = cls.free_list;
+      cls.free_list = cls.free_list->next;
+      stats_.free_nodes--;
+    } else {
+      if (cls.bump == nullptr || cls.bump + cls.object_bytes > cls.bump_end) {
+        size_t slab_bytes = options_.slab_bytes < cls.object_bytes ? cls.object_bytes : options_.slab_bytes;
+        // the unused tail of the previous slab is lost to this class
+        if (cls.bump != nullptr) stats_.bytes_free -= cls.bump_end - cls.bump;
+        cls.bump = acquireSlab(slab_bytes);
+        cls.bump_end = cls.bump + slab_bytes;
+        stats_.bytes_free += slab_bytes;
+      }
+      obj = cls.bump;
+      cls.bump += cls.object_bytes;
+    }
+    stats_.bytes_free -= cls.object_bytes;
+    stats_.bytes_live += cls.object_bytes;
+    stats_.live_nodes++;
+    return obj;
+  }
+
+  void deallocate(void *ptr, size_t bytes) {
+    SizeClass &cls = classFor(bytes);
+    FreeObject *obj = static_cast<FreeObject *>(ptr);
+    obj->next = cls.free_list;
+    cls.free_list = obj;
+    stats_.bytes_live -= cls.object_bytes;
+    stats_.bytes_free += cls.object_bytes;
+    stats_.live_nodes--;
+    stats_.free_nodes++;
+  }
+
+  char *acquireSlab(size_t bytes) {
+    void *mem = nullptr;
+    if (options_.huge_pages) {
+      bytes = (bytes + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+      // over-map by one huge page so the slab can start on a 2 MiB boundary
+      size_t mapped = bytes + kHugePageBytes;
+      char *raw = static_cast<char *>(mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+      if (raw == MAP_FAILED) throw std::bad_alloc();
+      char *aligned = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(raw) + kHugePageBytes - 1) &
+                                               ~(uintptr_t)(kHugePageBytes - 1));
+      if (aligned != raw) munmap(raw, aligned - raw);
+      char *end = raw + mapped;
+      if (end != aligned + bytes) munmap(aligned + bytes, end - (aligned + bytes));
+#ifdef MADV_HUGEPAGE
+      madvise(aligned, bytes, MADV_HUGEPAGE);
+#endif
+      mem = aligned;
+    } else {
+      mem = std::aligned_alloc(kAlignment, roundUp(bytes));
+      if (mem == nullptr) throw std::bad_alloc();
+    }
+    slabs_.emplace_back(static_cast<char *>(mem), bytes);
+    stats_.bytes_reserved += bytes;
+    return static_cast<char *>(mem);
+  }
+
+  void releaseSlab(char *mem, size_t bytes) {
+    if (options_.huge_pages) {
+      munmap(mem, bytes);
+    } else {
+      std::free(mem);
+    }
+  }
+
+  SlabOptions options_;
+  std::vector<SizeClass> classes_;
+  std::vector<std::pair<char *, size_t>> slabs_;
+  NodeAllocatorStats stats_;
+};
+
+/**
+ * Allocator that forwards every node to new/delete. Kept for debugging with
+ * sanitizers, which cannot see overflows inside a slab.
+ */
+class HeapNodeAllocator {
+ public:
+  static constexpr bool kBulkRelease = false;
+
+  template <typename T, typename... Args>
+  T *New(Args &&...args) {
+    stats_.bytes_live += sizeof(T);
+    stats_.bytes_reserved += sizeof(T);
+    stats_.live_nodes++;
+    return new T(std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  void Delete(T *obj) {
+    if (obj == nullptr) return;
+    stats_.bytes_live -= sizeof(T);
+    stats_.bytes_reserved -= sizeof(T);
+    stats_.live_nodes--;
+    delete obj;
+  }
+
+  template <typename T, typename... Args>
+  T *NewBytes(size_t bytes, Args &&...args) {
+    stats_.bytes_live += bytes;
+    stats_.bytes_reserved += bytes;
+    stats_.live_nodes++;
+    return new (::operator new(bytes, std::align_val_t(alignof(T)))) T(std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  void DeleteBytes(T *obj, size_t bytes) {
+    if (obj == nullptr) return;
+    stats_.bytes_live -= bytes;
+    stats_.bytes_reserved -= bytes;
+    stats_.live_nodes--;
+    obj->~T();
+    ::operator delete(obj, std::align_val_t(alignof(T)));
+  }
+
+  void Reset() {}
+
+  NodeAllocatorStats Stats() const { return stats_; }
+
+ private:
+  NodeAllocatorStats stats_;
+};
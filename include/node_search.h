@@ -0,0 +1,339 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/node_search.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BPT_X86_SIMD 1
+#endif
+
+/**
+ * Intra-node search kernel shared by every descent and leaf update.
+ *
+ * Keys inside a node are sorted, so the search first halves the window with a
+ * branchless binary search until it fits in one cache line, then counts the
+ * remaining keys with a SIMD compare + popcount (AVX2 or SSE4.2, picked once at
+ * runtime) or a branchless scalar loop. The cost per node therefore grows with
+ * log(fanout) instead of fanout, and the loop carries no data-dependent
+ * branches for the predictor to miss.
+ *
+ * Trees ordered by InterpolatingLess<K> (integer keys) search by
+ * interpolation instead: a linear model through the node's first and last
+ * key predicts the slot, an exponential search of at most a few probes
+ * around it brackets the answer to one short window, and keys that are too
+ * far from the prediction fall back to the search above on what remains.
+ * The model is taken from the node's keys at search time, so it never goes
+ * stale as entries move in and out and costs no space in the node. Dense
+ * and near-uniform keys land within a slot or two of the prediction.
+ */
+
+// instruction set used by the counting step, detected once per process
+enum class SearchIsa { kScalar, kSSE42, kAVX2 };
+
+inline SearchIsa DetectSearchIsa() {
+#if defined(BPT_X86_SIMD)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return SearchIsa::kAVX2;
+  if (__builtin_cpu_supports("sse4.2")) return SearchIsa::kSSE42;
+#endif
+  return SearchIsa::kScalar;
+}
+
+inline SearchIsa ActiveSearchIsa() {
+  static const SearchIsa isa = DetectSearchIsa();
+  return isa;
+}
+
+// std::less for integer keys that also selects interpolation search in nodes
+template <typename K>
+struct InterpolatingLess : std::less<K> {
+  static_assert(std::is_integral_v<K>, "interpolation search needs integer keys");
+};
+
+namespace node_search_detail {
+
+// Upper == false counts keys < key, Upper == true counts keys <= key
+template <bool Upper, typename K, typename Compare>
+inline int countScalar(const K *keys, int len, const K &key, const Compare &comp) {
+  int cnt = 0;
+  for (int i = 0; i < len; i++) {
+    cnt += Upper ? !comp(key, keys[i]) : comp(keys[i], key);
+  }
+  return cnt;
+}
+
+#if defined(BPT_X86_SIMD)
+template <bool Upper>
+__attribute__((target("avx2"))) inline int countAvx2(const int32_t *keys, int len, int32_t key) {
+  const __m256i needle = _mm256_set1_epi32(key);
+  int cnt = 0;
+  int i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+    __m256i m = Upper ? _mm256_cmpgt_epi32(v, needle) : _mm256_cmpgt_epi32(needle, v);
+    int bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+    cnt += Upper ? 8 - bits : bits;
+  }
+  for (; i < len; i++) cnt += Upper ? keys[i] <= key : keys[i] < key;
+  return cnt;
+}
+
+template <bool Upper>
+__attribute__((target("avx2"))) inline int countAvx2(const int64_t *keys, int len, int64_t key) {
+  const __m256i needle = _mm256_set1_epi64x(key);
+  int cnt = 0;
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+    __m256i m = Upper ? _mm256_cmpgt_epi64(v, needle) : _mm256_cmpgt_epi64(needle, v);
+    int bits = __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+    cnt += Upper ? 4 - bits : bits;
+  }
+  for (; i < len; i++) cnt += Upper ? keys[i] <= key : keys[i] < key;
+  return cnt;
+}
+
+template <bool Upper>
+__attribute__((target("sse4.2"))) inline int countSse42(const int32_t *keys, int len, int32_t key) {
+  const __m128i needle = _mm_set1_epi32(key);
+  int cnt = 0;
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+    __m128i m = Upper ? _mm_cmpgt_epi32(v, needle) : _mm_cmpgt_epi32(needle, v);
+    int bits = __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+    cnt += Upper ? 4 - bits : bits;
+  }
+  for (; i < len; i++) cnt += Upper ? keys[i] <= key : keys[i] < key;
+  return cnt;
+}
+
+template <bool Upper>
+__attribute__((target("sse4.2"))) inline int countSse42(const int64_t *keys, int len, int64_t key) {
+  const __m128i needle = _mm_set1_epi64x(key);
+  int cnt = 0;
+  int i = 0;
+  for (; i + 2 <= len; i += 2) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+    __m128i m = Upper ? _mm_cmpgt_epi64(v, needle) : _mm_cmpgt_epi64(needle, v);
+    int bits = __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(m)));
+    cnt += Upper ? 2 - bits : bits;
+  }
+  for (; i < len; i++) cnt += Upper ? keys[i] <= key : keys[i] < key;
+  return cnt;
+}
+
+// Unsigned lanes (packed leaf offsets) have no unsigned compare instruction:
+// flipping the sign bit of both sides turns it into a signed compare.
+template <bool Upper, typename U>
+__attribute__((target("avx2"))) inline int countAvx2Unsigned(const U *keys, int len, U key) {
+  constexpr int kLanes = static_cast<int>(32 / sizeof(U));
+  const U sign = static_cast<U>(U(1) << (8 * sizeof(U) - 1));
+  __m256i flip, needle;
+  if constexpr (sizeof(U) == 1) {
+    flip = _mm256_set1_epi8(static_cast<char>(sign));
+    needle = _mm256_set1_epi8(static_cast<char>(key ^ sign));
+  } else if constexpr (sizeof(U) == 2) {
+    flip = _mm256_set1_epi16(static_cast<short>(sign));
+    needle = _mm256_set1_epi16(static_cast<short>(key ^ sign));
+  } else if constexpr (sizeof(U) == 4) {
+    flip = _mm256_set1_epi32(static_cast<int>(sign));
+    needle = _mm256_set1_epi32(static_cast<int>(key ^ sign));
+  } else {
+    flip = _mm256_set1_epi64x(static_cast<long long>(sign));
+    needle = _mm256_set1_epi64x(static_cast<long long>(key ^ sign));
+  }
+  int cnt = 0;
+  int i = 0;
+  for (; i + kLanes <= len; i += kLanes) {
+    __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)), flip);
+    __m256i a = Upper ? v : needle;
+    __m256i b = Upper ? needle : v;
+    __m256i m;
+    if constexpr (sizeof(U) == 1) m = _mm256_cmpgt_epi8(a, b);
+    else if constexpr (sizeof(U) == 2) m = _mm256_cmpgt_epi16(a, b);
+    else if constexpr (sizeof(U) == 4) m = _mm256_cmpgt_epi32(a, b);
+    else m = _mm256_cmpgt_epi64(a, b);
+    int lanes = __builtin_popcount(static_cast<unsigned>(_mm256_movemask_epi8(m))) / static_cast<int>(sizeof(U));
+    cnt += Upper ? kLanes - lanes : lanes;
+  }
+  for (; i < len; i++) cnt += Upper ? keys[i] <= key : keys[i] < key;
+  return cnt;
+}
+
+template <bool Upper, typename U>
+__attribute__((target("sse4.2"))) inline int countSse42Unsigned(const U *keys, int len, U key) {
+  constexpr int kLanes = static_cast<int>(16 / sizeof(U));
+  const U sign = static_cast<U>(U(1) << (8 * sizeof(U) - 1));
+  __m128i flip, needle;
+  if constexpr (sizeof(U) == 1) {
+    flip = _mm_set1_epi8(static_cast<char>(sign));
+    needle = _mm_set1_epi8(static_cast<char>(key ^ sign));
+  } else if constexpr (sizeof(U) == 2) {
+    flip = _mm_set1_epi16(static_cast<short>(sign));
+    needle = _mm_set1_epi16(static_cast<short>(key ^ sign));
+  } else if constexpr (sizeof(U) == 4) {
+    flip = _mm_set1_epi32(static_cast<int>(sign));
+    needle = _mm_set1_epi32(static_cast<int>(key ^ sign));
+  } else {
+    flip = _mm_set1_epi64x(static_cast<long long>(sign));
+    needle = _mm_set1_epi64x(static_cast<long long>(key ^ sign));
+  }
+  int cnt = 0;
+  int i = 0;
+  for (; i + kLanes <= len; i += kLanes) {
+    __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i)), flip);
+    __m128i a = Upper ? v : needle;
+    __m128i b = Upper ? needle : v;
+    __m128i m;
+    if constexpr (sizeof(U) == 1) m = _mm_cmpgt_epi8(a, b);
+    else if constexpr (sizeof(U) == 2) m = _mm_cmpgt_epi16(a, b);
+    else if constexpr (sizeof(U) == 4) m = _mm_cmpgt_epi32(a, b);
+    else m = _mm_cmpgt_epi64(a, b);
+    int lanes = __builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(m))) / static_cast<int>(sizeof(U));
+    cnt += Upper ? kLanes - lanes : lanes;
+  }
+  for (; i < len; i++) cnt += Upper ? keys[i] <= key : keys[i] < key;
+  return cnt;
+}
+#endif
+
+template <typename K, typename Compare>
+inline constexpr bool kNaturalOrder =
+    (std::is_same_v<Compare, std::less<K>> || std::is_same_v<Compare, std::less<>> ||
+     std::is_same_v<Compare, InterpolatingLess<K>>) &&
+    std::is_integral_v<K>;
+
+template <typename K, typename Compare>
+inline constexpr bool kInterpolated = std::is_same_v<Compare, InterpolatingLess<K>>;
+
+// SIMD is only valid when the comparator is the natural integer order: signed
+// 32/64-bit keys, or unsigned lanes of any width
+template <typename K, typename Compare>
+inline constexpr bool kSimdSearchable =
+    kNaturalOrder<K, Compare> && ((std::is_signed_v<K> && (sizeof(K) == 4 || sizeof(K) == 8)) ||
+                                  (std::is_unsigned_v<K> && !std::is_same_v<K, bool>));
+
+template <bool Upper, typename K, typename Compare>
+inline int countWindow(const K *keys, int len, const K &key, const Compare &comp) {
+#if defined(BPT_X86_SIMD)
+  if constexpr (kSimdSearchable<K, Compare> && std::is_unsigned_v<K>) {
+    switch (ActiveSearchIsa()) {
+      case SearchIsa::kAVX2:
+        return countAvx2Unsigned<Upper>(keys, len, key);
+      case SearchIsa::kSSE42:
+        return countSse42Unsigned<Upper>(keys, len, key);
+      default:
+        break;
+    }
+  } else if constexpr (kSimdSearchable<K, Compare>) {
+    using Lane = std::conditional_t<sizeof(K) == 4, int32_t, int64_t>;
+    const Lane *lanes = reinterpret_cast<const Lane *>(keys);
+    switch (ActiveSearchIsa()) {
+      case SearchIsa::kAVX2:
+        return countAvx2<Upper>(lanes, len, static_cast<Lane>(key));
+      case SearchIsa::kSSE42:
+        return countSse42<Upper>(lanes, len, static_cast<Lane>(key));
+      default:
+        break;
+    }
+  }
+#endif
+  return countScalar<Upper>(keys, len, key, comp);
+}
+
+template <bool Upper, typename K, typename Compare>
+inline int searchNode(const K *keys, int n, const K &key, const Compare &comp) {
+  // narrow to one cache line worth of keys, then count what is left
+  constexpr int kWindow = sizeof(K) >= 64 / 8 ? 8 : static_cast<int>(64 / sizeof(K));
+  const K *base = keys;
+  int len = n;
+  while (len > kWindow) {
+    int half = len / 2;
+    bool right = Upper ? !comp(key, base[half - 1]) : comp(base[half - 1], key);
+    base = right ? base + half : base;
+    len -= half;
+  }
+  return static_cast<int>(base - keys) + countWindow<Upper>(base, len, key, comp);
+}
+
+// farthest probe from the predicted slot before falling back to searchNode
+constexpr int kInterpolationMaxStep = 16;
+// smaller nodes take a few probes either way and the division does not pay
+constexpr int kInterpolationMinKeys = 32;
+
+template <bool Upper, typename K, typename Compare>
+inline int interpolateNode(const K *keys, int n, const K &key, const Compare &comp) {
+  if (n < kInterpolationMinKeys) return searchNode<Upper>(keys, n, key, comp);
+  // read once: optimistic readers may see the node change underneath
+  const K lo = keys[0];
+  const K hi = keys[n - 1];
+  auto before = [&](int i) { return Upper ? !comp(key, keys[i]) : comp(keys[i], key); };
+  if (Upper ? comp(key, lo) : !comp(lo, key)) return 0;
+  if (Upper ? !comp(key, hi) : comp(hi, key)) return n;
+  // lo < key <= hi here, so the slot is in [1, n - 1] and hi > lo
+  double fraction = (static_cast<double>(key) - static_cast<double>(lo)) /
+                    (static_cast<double>(hi) - static_cast<double>(lo));
+  int p = static_cast<int>(fraction * (n - 1));
+  p = p < 0 ? 0 : (p > n - 1 ? n - 1 : p);
+
+  int step = 1;
+  if (before(p)) {
+    // the answer is past p: gallop right
+    while (p + step < n && before(p + step)) {
+      if (step == kInterpolationMaxStep) {
+        int from = p + step + 1;
+        return from + searchNode<Upper>(keys + from, n - from, key, comp);
+      }
+      step *= 2;
+    }
+    int from = p + step / 2 + 1;
+    int to = p + step < n ? p + step : n;
+    return from + countWindow<Upper>(keys + from, to - from, key, comp);
+  }
+  // the answer is at or before p: gallop left
+  while (p - step >= 0 && !before(p - step)) {
+    if (step == kInterpolationMaxStep) return searchNode<Upper>(keys, p - step, key, comp);
+    step *= 2;
+  }
+  int from = p - step + 1 > 0 ? p - step + 1 : 0;
+  int to = p - step / 2;
+  return from + countWindow<Upper>(keys + from, to - from, key, comp);
+}
+
+}  // namespace node_search_detail
+
+/*
+ * Return the index of the first key in keys[0, n) that is not less than key.
+ */
+template <typename K, typename Compare = std::less<K>>
+inline int NodeLowerBound(const K *keys, int n, const K &key, const Compare &comp = Compare()) {
+  if constexpr (node_search_detail::kInterpolated<K, Compare>) {
+    return node_search_detail::interpolateNode<false>(keys, n, key, comp);
+  }
+  return node_search_detail::searchNode<false>(keys, n, key, comp);
+}
+
+/*
+ * Return the index of the first key in keys[0, n) that is greater than key.
+ * For an internal node this is the index of the child to descend into.
+ */
+template <typename K, typename Compare = std::less<K>>
+inline int NodeUpperBound(const K *keys, int n, const K &key, const Compare &comp = Compare()) {
+  if constexpr (node_search_detail::kInterpolated<K, Compare>) {
+    return node_search_detail::interpolateNode<true>(keys, n, key, comp);
+  }
+  return node_search_detail::searchNode<true>(keys, n, key, comp);
+}
@@ -0,0 +1,76 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/optimistic_latch.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+/**
+ * Version latch for optimistic lock coupling.
+ *
+ * Readers never write to the latch: they remember the version before reading a
+ * node and check it is unchanged afterwards, retrying on a mismatch. Writers
+ * set the locked bit with a CAS, and unlocking bumps the version so every
+ * overlapping reader fails its validation. A node unlinked from the tree is
+ * marked obsolete so readers still holding a pointer to it restart.
+ *
+ *   bit 0: obsolete, bit 1: locked, bits 2..63: version counter
+ */
+class OptimisticLatch {
+ public:
+  // Snapshot the version for an optimistic read. Fails if the node is being
+  // modified or has been unlinked.
+  bool ReadLock(uint64_t &version) const {
+    version = waitUnlocked();
+    return (version & kObsoleteBit) == 0;
+  }
+
+  // True if nothing was written to the node since ReadLock returned version
+  bool Validate(uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
+  // Turn an optimistic read into exclusive ownership without a gap
+  bool TryUpgrade(uint64_t version) {
+    return version_.compare_exchange_strong(version, version + kLockedBit, std::memory_order_acquire);
+  }
+
+  void Lock() {
+    while (true) {
+      uint64_t version = waitUnlocked();
+      if (TryUpgrade(version)) return;
+    }
+  }
+
+  void Unlock() { version_.fetch_add(kLockedBit, std::memory_order_release); }
+
+  // Only valid while locked; the node stays obsolete after Unlock()
+  void MarkObsolete() { version_.fetch_or(kObsoleteBit, std::memory_order_relaxed); }
+
+  bool IsLocked() const { return (version_.load(std::memory_order_relaxed) & kLockedBit) != 0; }
+
+ private:
+  static constexpr uint64_t kObsoleteBit = 1;
+  static constexpr uint64_t kLockedBit = 2;
+
+  uint64_t waitUnlocked() const {
+    uint64_t version = version_.load(std::memory_order_acquire);
+    for (int spins = 0; (version & kLockedBit) != 0; spins++) {
+      if (spins > 64) std::this_thread::yield();
+      version = version_.load(std::memory_order_acquire);
+    }
+    return version;
+  }
+
+  std::atomic<uint64_t> version_{0};
+};
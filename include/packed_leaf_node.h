@@ -0,0 +1,324 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/packed_leaf_node.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+// Included by b_plus_tree.h after Node and RecordPointer are declared.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include "node_search.h"
+
+/**
+ * Leaf node storing integer keys and RecordPointers in compressed columns.
+ *
+ * Every column is frame-of-reference encoded: the leaf keeps a base per column
+ * (smallest key, page_id and record_id) and stores each entry as an unsigned
+ * offset from it, 1, 2, 4 or 8 bytes wide. The widths are chosen per leaf from
+ * the range of its entries and the leaf is allocated with exactly the bytes
+ * they need, so dense keys on a handful of pages cost a few bytes per entry
+ * instead of sizeof(KeyType) + sizeof(RecordPointer).
+ *
+ * Lookups search the key offsets in place with the SIMD kernels of
+ * node_search.h; only the entries handed out are decoded. A leaf holds as many
+ * entries as a LeafNode of the same fanout, so split and merge thresholds do
+ * not change. An entry outside the range the widths can express does not
+ * Fit(); the tree then moves the leaf to a wider allocation.
+ */
+template <typename KeyType, typename ValueType, int Fanout>
+class PackedLeafNode : public Node<KeyType, Fanout> {
+  static_assert(std::is_integral_v<KeyType> && !std::is_same_v<KeyType, bool>, "packed leaves store integer keys");
+  static_assert(std::is_same_v<ValueType, RecordPointer>, "packed leaves store RecordPointer values");
+
+ public:
+  // byte width of every column: 1, 2, 4 or 8
+  struct Layout {
+    uint8_t key_width = 1;
+    uint8_t page_width = 1;
+    uint8_t record_width = 1;
+  };
+  // the allocation size follows the layout
+  static constexpr bool kFixedSize = false;
+
+  explicit PackedLeafNode(const Layout &layout) : Node<KeyType, Fanout>(true), layout_(layout) {
+    column_offset_[kKeys] = sizeof(PackedLeafNode);
+    column_offset_[kPages] = column_offset_[kKeys] + stride(layout.key_width);
+    column_offset_[kRecords] = column_offset_[kPages] + stride(layout.page_width);
+  }
+
+  // pointer to the next/prev leaf node
+  PackedLeafNode *next_leaf = nullptr;
+  PackedLeafNode *prev_leaf = nullptr;
+
+  KeyType KeyAt(int i) const { return static_cast<KeyType>(static_cast<KeyOffset>(key_base_) + load(kKeys, i)); }
+  ValueType ValueAt(int i) const {
+    return ValueType(static_cast<int>(static_cast<uint32_t>(page_base_) + load(kPages, i)),
+                     static_cast<int>(static_cast<uint32_t>(record_base_) + load(kRecords, i)));
+  }
+  void CopyValues(int from, int n, ValueType *out) const {
+    for (int i = 0; i < n; i++) out[i] = ValueAt(from + i);
+  }
+
+  // Searches run on the key offsets; a key outside the leaf's range never
+  // has to be encoded
+  template <typename Compare>
+  int LowerBound(int n, const KeyType &key, const Compare &) const {
+    static_assert(kNaturalOrder<Compare>, "packed keys are searched in their natural order");
+    if (n == 0 || !(key_base_ < key)) return 0;
+    uint64_t offset = static_cast<KeyOffset>(static_cast<KeyOffset>(key) - static_cast<KeyOffset>(key_base_));
+    if (offset > maxOffset(layout_.key_width)) return n;
+    return searchOffsets<false>(n, offset);
+  }
+  template <typename Compare>
+  int UpperBound(int n, const KeyType &key, const Compare &) const {
+    static_assert(kNaturalOrder<Compare>, "packed keys are searched in their natural order");
+    if (n == 0 || key < key_base_) return 0;
+    uint64_t offset = static_cast<KeyOffset>(static_cast<KeyOffset>(key) - static_cast<KeyOffset>(key_base_));
+    if (offset > maxOffset(layout_.key_width)) return n;
+    return searchOffsets<true>(n, offset);
+  }
+  template <typename Compare>
+  bool KeyEquals(int i, const KeyType &key, const Compare &) const {
+    static_assert(kNaturalOrder<Compare>, "packed keys are searched in their natural order");
+    return KeyAt(i) == key;
+  }
+
+  // Narrowest layout for n sorted entries
+  static Layout LayoutFor(const KeyType *keys, const ValueType *values, int n) {
+    Layout layout;
+    if (n == 0) return layout;
+    layout.key_width = widthFor(static_cast<KeyOffset>(static_cast<KeyOffset>(keys[n - 1]) - static_cast<KeyOffset>(keys[0])));
+    int page_lo = values[0].page_id, page_hi = page_lo;
+    int record_lo = values[0].record_id, record_hi = record_lo;
+    for (int i = 1; i < n; i++) {
+      page_lo = std::min(page_lo, values[i].page_id);
+      page_hi = std::max(page_hi, values[i].page_id);
+      record_lo = std::min(record_lo, values[i].record_id);
+      record_hi = std::max(record_hi, values[i].record_id);
+    }
+    layout.page_width = widthFor(static_cast<uint32_t>(page_hi) - static_cast<uint32_t>(page_lo));
+    layout.record_width = widthFor(static_cast<uint32_t>(record_hi) - static_cast<uint32_t>(record_lo));
+    return layout;
+  }
+  static size_t BytesFor(const Layout &layout) {
+    return sizeof(PackedLeafNode) + stride(layout.key_width) + stride(layout.page_width) + stride(layout.record_width);
+  }
+  size_t AllocatedBytes() const { return BytesFor(layout_); }
+  bool CanHold(const Layout &layout) const {
+    return layout.key_width <= layout_.key_width && layout.page_width <= layout_.page_width &&
+           layout.record_width <= layout_.record_width;
+  }
+
+  // True if InsertAt can take the entry without wider columns
+  bool Fits(const KeyType &key, const ValueType &value) const {
+    int n = this->key_num;
+    if (n == 0) return true;
+    KeyType lo = std::min(key, key_base_);
+    KeyType hi = std::max(key, KeyAt(n - 1));
+    uint64_t key_span = static_cast<KeyOffset>(static_cast<KeyOffset>(hi) - static_cast<KeyOffset>(lo));
+    return key_span <= maxOffset(layout_.key_width) &&
+           columnFits(page_base_, page_span_, value.page_id, layout_.page_width) &&
+           columnFits(record_base_, record_span_, value.record_id, layout_.record_width);
+  }
+
+  // Overwrite the value of entry i in place; false if it is below a base or
+  // too far above it for the column widths
+  bool SetValueAt(int i, const ValueType &value) {
+    if (value.page_id < page_base_ || value.record_id < record_base_) return false;
+    uint32_t page = static_cast<uint32_t>(value.page_id) - static_cast<uint32_t>(page_base_);
+    uint32_t record = static_cast<uint32_t>(value.record_id) - static_cast<uint32_t>(record_base_);
+    if (page > maxOffset(layout_.page_width) || record > maxOffset(layout_.record_width)) return false;
+    store(kPages, i, page);
+    store(kRecords, i, record);
+    page_span_ = std::max(page_span_, page);
+    record_span_ = std::max(record_span_, record);
+    return true;
+  }
+
+  void InsertAt(int index, const KeyType &key, const ValueType &value) {
+    int n = this->key_num;
+    if (n == 0) {
+      key_base_ = key;
+      page_base_ = value.page_id;
+      record_base_ = value.record_id;
+      page_span_ = 0;
+      record_span_ = 0;
+    } else {
+      // lower a base by shifting every offset up
+      if (key < key_base_) {
+        rebase(kKeys, n, static_cast<KeyOffset>(static_cast<KeyOffset>(key_base_) - static_cast<KeyOffset>(key)));
+        key_base_ = key;
+      }
+      if (value.page_id < page_base_) {
+        uint32_t delta = static_cast<uint32_t>(page_base_) - static_cast<uint32_t>(value.page_id);
+        rebase(kPages, n, delta);
+        page_span_ += delta;
+        page_base_ = value.page_id;
+      }
+      if (value.record_id < record_base_) {
+        uint32_t delta = static_cast<uint32_t>(record_base_) - static_cast<uint32_t>(value.record_id);
+        rebase(kRecords, n, delta);
+        record_span_ += delta;
+        record_base_ = value.record_id;
+      }
+    }
+    for (int column = 0; column < kColumns; column++) {
+      size_t width = widthOf(column);
+      unsigned char *data = columnBytes(column);
+      std::memmove(data + (index + 1) * width, data + index * width, (n - index) * width);
+    }
+    uint32_t page = static_cast<uint32_t>(value.page_id) - static_cast<uint32_t>(page_base_);
+    uint32_t record = static_cast<uint32_t>(value.record_id) - static_cast<uint32_t>(record_base_);
+    store(kKeys, index, static_cast<KeyOffset>(static_cast<KeyOffset>(key) - static_cast<KeyOffset>(key_base_)));
+    store(kPages, index, page);
+    store(kRecords, index, record);
+    page_span_ = std::max(page_span_, page);
+    record_span_ = std::max(record_span_, record);
+    this->key_num = n + 1;
+  }
+
+  // The spans stay as they are, they only have to be upper bounds
+  void RemoveAt(int index) {
+    int n = this->key_num;
+    for (int column = 0; column < kColumns; column++) {
+      size_t width = widthOf(column);
+      unsigned char *data = columnBytes(column);
+      std::memmove(data + index * width, data + (index + 1) * width, (n - index - 1) * width);
+    }
+    this->key_num = n - 1;
+  }
+
+  // Replace the contents with n sorted entries; CanHold(LayoutFor(...)) must hold
+  void Assign(const KeyType *keys, const ValueType *values, int n) {
+    this->key_num = n;
+    if (n == 0) return;
+    key_base_ = keys[0];
+    page_base_ = values[0].page_id;
+    record_base_ = values[0].record_id;
+    for (int i = 1; i < n; i++) {
+      page_base_ = std::min(page_base_, values[i].page_id);
+      record_base_ = std::min(record_base_, values[i].record_id);
+    }
+    page_span_ = 0;
+    record_span_ = 0;
+    for (int i = 0; i < n; i++) {
+      uint32_t page = static_cast<uint32_t>(values[i].page_id) - static_cast<uint32_t>(page_base_);
+      uint32_t record = static_cast<uint32_t>(values[i].record_id) - static_cast<uint32_t>(record_base_);
+      store(kKeys, i, static_cast<KeyOffset>(static_cast<KeyOffset>(keys[i]) - static_cast<KeyOffset>(key_base_)));
+      store(kPages, i, page);
+      store(kRecords, i, record);
+      page_span_ = std::max(page_span_, page);
+      record_span_ = std::max(record_span_, record);
+    }
+  }
+
+ private:
+  using KeyOffset = std::make_unsigned_t<KeyType>;
+  // offsets keep the key order only under std::less
+  template <typename Compare>
+  static constexpr bool kNaturalOrder =
+      std::is_same_v<Compare, std::less<KeyType>> || std::is_same_v<Compare, std::less<>>;
+  static constexpr int kCapacity = Fanout - 1;
+  static constexpr int kKeys = 0;
+  static constexpr int kPages = 1;
+  static constexpr int kRecords = 2;
+  static constexpr int kColumns = 3;
+
+  static uint64_t maxOffset(int width) { return width >= 8 ? UINT64_MAX : (uint64_t(1) << (8 * width)) - 1; }
+  static uint8_t widthFor(uint64_t span) {
+    if (span <= UINT8_MAX) return 1;
+    if (span <= UINT16_MAX) return 2;
+    if (span <= UINT32_MAX) return 4;
+    return 8;
+  }
+  // columns start 8-byte aligned so every lane is naturally aligned
+  static size_t stride(int width) { return (kCapacity * width + 7) / 8 * 8; }
+
+  static bool columnFits(int base, uint32_t span, int value, int width) {
+    int64_t lo = std::min<int64_t>(base, value);
+    int64_t hi = std::max<int64_t>(static_cast<int64_t>(base) + span, value);
+    return static_cast<uint64_t>(hi - lo) <= maxOffset(width);
+  }
+
+  // Call fn with a zero of the unsigned lane type for width
+  template <typename Fn>
+  static decltype(auto) withWidth(int width, Fn &&fn) {
+    switch (width) {
+      case 1:
+        return fn(uint8_t());
+      case 2:
+        return fn(uint16_t());
+      case 4:
+        return fn(uint32_t());
+      default:
+        return fn(uint64_t());
+    }
+  }
+
+  int widthOf(int column) const {
+    return column == kKeys ? layout_.key_width : column == kPages ? layout_.page_width : layout_.record_width;
+  }
+  unsigned char *columnBytes(int column) { return reinterpret_cast<unsigned char *>(this) + column_offset_[column]; }
+  const unsigned char *columnBytes(int column) const {
+    return reinterpret_cast<const unsigned char *>(this) + column_offset_[column];
+  }
+  template <typename Lane>
+  const Lane *lanes(int column) const {
+    return reinterpret_cast<const Lane *>(columnBytes(column));
+  }
+  template <typename Lane>
+  Lane *lanes(int column) {
+    return reinterpret_cast<Lane *>(columnBytes(column));
+  }
+
+  uint64_t load(int column, int i) const {
+    return withWidth(widthOf(column), [&](auto lane) -> uint64_t { return lanes<decltype(lane)>(column)[i]; });
+  }
+  void store(int column, int i, uint64_t offset) {
+    withWidth(widthOf(column), [&](auto lane) { lanes<decltype(lane)>(column)[i] = static_cast<decltype(lane)>(offset); });
+  }
+  void rebase(int column, int n, uint64_t delta) {
+    withWidth(widthOf(column), [&](auto lane) {
+      using Lane = decltype(lane);
+      Lane *data = lanes<Lane>(column);
+      for (int i = 0; i < n; i++) data[i] = static_cast<Lane>(data[i] + delta);
+    });
+  }
+
+  template <bool Upper>
+  int searchOffsets(int n, uint64_t offset) const {
+    return withWidth(layout_.key_width, [&](auto lane) {
+      using Lane = decltype(lane);
+      const Lane *data = lanes<Lane>(kKeys);
+      Lane needle = static_cast<Lane>(offset);
+      return Upper ? NodeUpperBound(data, n, needle, std::less<Lane>())
+                   : NodeLowerBound(data, n, needle, std::less<Lane>());
+    });
+  }
+
+  Layout layout_;
+  // byte offsets from this; 8 byte columns of a large fanout pass 64 KiB
+  uint32_t column_offset_[kColumns];
+  int page_base_ = 0;
+  int record_base_ = 0;
+  // upper bounds of the page and record offsets in use
+  uint32_t page_span_ = 0;
+  uint32_t record_span_ = 0;
+  KeyType key_base_ = 0;
+};
+
+// Leaf format for BPlusTree: compressed integer keys and RecordPointers
+struct PackedLeafFormat {
+  template <typename KeyType, typename ValueType, int Fanout>
+  using Leaf = PackedLeafNode<KeyType, ValueType, Fanout>;
+};
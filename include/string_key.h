@@ -0,0 +1,75 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/string_key.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * Variable-length key ordered bytewise, like memcmp.
+ *
+ * Next to the string the key keeps its first 8 bytes as a big-endian integer
+ * (the abbreviated key). Two keys whose abbreviations differ compare by one
+ * integer comparison, so searches in internal nodes only read the full string
+ * of keys that share their first 8 bytes with the search key.
+ */
+class StringKey {
+ public:
+  StringKey() = default;
+  StringKey(std::string str) : str_(std::move(str)), abbrev_(Abbreviate(str_)) {}
+  StringKey(std::string_view str) : StringKey(std::string(str)) {}
+  StringKey(const char *str) : StringKey(std::string(str)) {}
+
+  const std::string &str() const { return str_; }
+  std::string_view view() const { return str_; }
+  size_t size() const { return str_.size(); }
+  uint64_t abbrev() const { return abbrev_; }
+
+  // First 8 bytes as a big-endian integer, zero padded: integer order matches
+  // bytewise order whenever the results differ
+  static uint64_t Abbreviate(std::string_view str) {
+    unsigned char bytes[8] = {0};
+    std::memcpy(bytes, str.data(), std::min<size_t>(str.size(), 8));
+    uint64_t abbrev = 0;
+    for (unsigned char byte : bytes) abbrev = (abbrev << 8) | byte;
+    return abbrev;
+  }
+
+  friend bool operator<(const StringKey &a, const StringKey &b) {
+    if (a.abbrev_ != b.abbrev_) return a.abbrev_ < b.abbrev_;
+    return a.str_ < b.str_;
+  }
+  friend bool operator==(const StringKey &a, const StringKey &b) {
+    return a.abbrev_ == b.abbrev_ && a.str_ == b.str_;
+  }
+  friend std::ostream &operator<<(std::ostream &out, const StringKey &key) { return out << key.str_; }
+
+ private:
+  std::string str_;
+  uint64_t abbrev_ = 0;
+};
+
+/*
+ * Suffix truncation: the shortest prefix of right that is still greater than
+ * left. Promoted as the separator of a leaf split it keeps internal nodes
+ * small and their strings inline.
+ */
+inline StringKey SeparatorKey(const StringKey &left, const StringKey &right) {
+  std::string_view l = left.view();
+  std::string_view r = right.view();
+  size_t common = std::mismatch(l.begin(), l.begin() + std::min(l.size(), r.size()), r.begin()).first - l.begin();
+  return StringKey(r.substr(0, std::min(common + 1, r.size())));
+}
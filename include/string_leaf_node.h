@@ -0,0 +1,229 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/string_leaf_node.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+// Included by b_plus_tree.h after Node is declared.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "string_key.h"
+
+/**
+ * Slotted-page leaf for StringKey keys.
+ *
+ * The key bytes live in a heap behind the node. The prefix shared by every key
+ * of the leaf is stored once at the start of the heap, and each slot holds the
+ * offset and length of the rest of its key plus the abbreviation of that rest,
+ * so a search compares integers and only reads key bytes on a tie. Values stay
+ * in a plain array.
+ *
+ * Removed keys leave dead bytes in the heap. When an insert does not fit the
+ * heap or does not share the prefix, the tree rebuilds the leaf, which
+ * compacts the heap and recomputes the prefix, in place when the allocation
+ * is large enough and in a new one otherwise.
+ */
+template <typename KeyType, typename ValueType, int Fanout>
+class StringLeafNode : public Node<KeyType, Fanout> {
+  static_assert(std::is_same_v<KeyType, StringKey>, "string leaves store StringKey keys");
+
+ public:
+  struct Layout {
+    // heap bytes the entries need right now
+    uint32_t heap_used = 0;
+    // heap bytes to allocate
+    uint32_t heap_bytes = 0;
+  };
+  // the allocation size follows the layout
+  static constexpr bool kFixedSize = false;
+
+  explicit StringLeafNode(const Layout &layout) : Node<KeyType, Fanout>(true), heap_capacity_(layout.heap_bytes) {}
+
+  // pointer to the next/prev leaf node
+  StringLeafNode *next_leaf = nullptr;
+  StringLeafNode *prev_leaf = nullptr;
+
+  KeyType KeyAt(int i) const {
+    std::string key(prefix());
+    key.append(suffix(i));
+    return KeyType(std::move(key));
+  }
+  const ValueType &ValueAt(int i) const { return values_[i]; }
+  void CopyValues(int from, int n, ValueType *out) const { std::copy(values_ + from, values_ + from + n, out); }
+
+  template <typename Compare>
+  int LowerBound(int n, const KeyType &key, const Compare &) const {
+    static_assert(kNaturalOrder<Compare>, "string leaves are searched in bytewise order");
+    return search<false>(n, key.view());
+  }
+  template <typename Compare>
+  int UpperBound(int n, const KeyType &key, const Compare &) const {
+    static_assert(kNaturalOrder<Compare>, "string leaves are searched in bytewise order");
+    return search<true>(n, key.view());
+  }
+  // Compares the prefix and the suffix of entry i in place, where KeyAt
+  // would build the key
+  template <typename Compare>
+  bool KeyEquals(int i, const KeyType &key, const Compare &) const {
+    static_assert(kNaturalOrder<Compare>, "string leaves are searched in bytewise order");
+    std::string_view k = key.view();
+    std::string_view rest = suffix(i);
+    return k.size() == prefix_len_ + rest.size() && k.substr(0, prefix_len_) == prefix() &&
+           k.substr(prefix_len_) == rest;
+  }
+
+  // Heap for n sorted keys, with room for a full leaf of keys as long as the
+  // average one
+  static Layout LayoutFor(const KeyType *keys, const ValueType *, int n) {
+    Layout layout;
+    if (n == 0) {
+      layout.heap_bytes = kMinHeapBytes;
+      return layout;
+    }
+    size_t common = commonPrefix(keys[0].view(), keys[n - 1].view());
+    size_t suffixes = 0;
+    for (int i = 0; i < n; i++) suffixes += keys[i].size() - common;
+    layout.heap_used = static_cast<uint32_t>(common + suffixes);
+    size_t full = common + (suffixes + n - 1) / n * kCapacity;
+    layout.heap_bytes = static_cast<uint32_t>(std::max<size_t>({full, layout.heap_used, kMinHeapBytes}));
+    return layout;
+  }
+  static size_t BytesFor(const Layout &layout) { return sizeof(StringLeafNode) + layout.heap_bytes; }
+  size_t AllocatedBytes() const { return sizeof(StringLeafNode) + heap_capacity_; }
+  bool CanHold(const Layout &layout) const { return layout.heap_used <= heap_capacity_; }
+
+  // True if InsertAt can take the key: it shares the prefix and its rest
+  // fits in the free heap
+  bool Fits(const KeyType &key, const ValueType &) const {
+    std::string_view k = key.view();
+    if (this->key_num == 0) return k.size() <= heap_capacity_;
+    return k.substr(0, prefix_len_) == prefix() && heap_used_ + (k.size() - prefix_len_) <= heap_capacity_;
+  }
+
+  bool SetValueAt(int i, const ValueType &value) {
+    values_[i] = value;
+    return true;
+  }
+
+  void InsertAt(int index, const KeyType &key, const ValueType &value) {
+    int n = this->key_num;
+    if (n == 0) {
+      // a prefix is only worth keeping once there are keys to share it
+      prefix_len_ = 0;
+      heap_used_ = 0;
+    }
+    std::string_view rest = key.view().substr(prefix_len_);
+    for (int i = n; i > index; i--) {
+      slots_[i] = slots_[i - 1];
+      values_[i] = values_[i - 1];
+    }
+    slots_[index] = appendSuffix(rest);
+    values_[index] = value;
+    this->key_num = n + 1;
+  }
+
+  void RemoveAt(int index) {
+    int n = this->key_num;
+    for (int i = index; i < n - 1; i++) {
+      slots_[i] = slots_[i + 1];
+      values_[i] = values_[i + 1];
+    }
+    values_[n - 1] = ValueType();
+    this->key_num = n - 1;
+  }
+
+  // Replace the contents with n sorted entries, compacting the heap.
+  // CanHold(LayoutFor(...)) must hold.
+  void Assign(const KeyType *keys, const ValueType *values, int n) {
+    this->key_num = n;
+    heap_used_ = 0;
+    prefix_len_ = 0;
+    if (n == 0) return;
+    std::string_view common = keys[0].view().substr(0, commonPrefix(keys[0].view(), keys[n - 1].view()));
+    std::memcpy(heap(), common.data(), common.size());
+    heap_used_ = prefix_len_ = static_cast<uint32_t>(common.size());
+    for (int i = 0; i < n; i++) {
+      slots_[i] = appendSuffix(keys[i].view().substr(prefix_len_));
+      values_[i] = values[i];
+    }
+  }
+
+ private:
+  static constexpr int kCapacity = Fanout - 1;
+  static constexpr size_t kMinHeapBytes = 64;
+  template <typename Compare>
+  static constexpr bool kNaturalOrder =
+      std::is_same_v<Compare, std::less<KeyType>> || std::is_same_v<Compare, std::less<>>;
+
+  struct Slot {
+    uint64_t abbrev;
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  static size_t commonPrefix(std::string_view a, std::string_view b) {
+    size_t len = std::min(a.size(), b.size());
+    return std::mismatch(a.begin(), a.begin() + len, b.begin()).first - a.begin();
+  }
+
+  char *heap() { return reinterpret_cast<char *>(this) + sizeof(StringLeafNode); }
+  const char *heap() const { return reinterpret_cast<const char *>(this) + sizeof(StringLeafNode); }
+  std::string_view prefix() const { return std::string_view(heap(), prefix_len_); }
+  std::string_view suffix(int i) const { return std::string_view(heap() + slots_[i].offset, slots_[i].length); }
+
+  Slot appendSuffix(std::string_view rest) {
+    Slot slot{StringKey::Abbreviate(rest), heap_used_, static_cast<uint32_t>(rest.size())};
+    std::memcpy(heap() + heap_used_, rest.data(), rest.size());
+    heap_used_ += slot.length;
+    return slot;
+  }
+
+  // Upper == false: first key >= key, Upper == true: first key > key
+  template <bool Upper>
+  int search(int n, std::string_view key) const {
+    std::string_view common = prefix();
+    if (key.substr(0, common.size()) != common) {
+      // every key of the leaf starts with the prefix
+      return key < common ? 0 : n;
+    }
+    std::string_view rest = key.substr(common.size());
+    uint64_t abbrev = StringKey::Abbreviate(rest);
+    int lo = 0;
+    int hi = n;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      const Slot &slot = slots_[mid];
+      int cmp = slot.abbrev != abbrev ? (slot.abbrev < abbrev ? -1 : 1) : suffix(mid).compare(rest);
+      if (Upper ? cmp <= 0 : cmp < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  uint32_t heap_capacity_;
+  uint32_t heap_used_ = 0;
+  uint32_t prefix_len_ = 0;
+  Slot slots_[kCapacity];
+  ValueType values_[kCapacity];
+};
+
+// Leaf format for BPlusTree: slotted pages for StringKey keys
+struct StringLeafFormat {
+  template <typename KeyType, typename ValueType, int Fanout>
+  using Leaf = StringLeafNode<KeyType, ValueType, Fanout>;
+};
@@ -0,0 +1,64 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/tree_diagnostics.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/**
+ * Diagnostics from the trees' data paths: removes of missing keys, duplicate
+ * inserts into the disk tree, broken invariants, and index, log or checkpoint
+ * files that cannot be opened, pinned or read. Callers see those failures
+ * through false returns and IsOpen(); the message only says why.
+ *
+ * Messages go to one process-wide sink, none by default. The message is only
+ * formatted when a sink is installed, and with BPT_DIAGNOSTICS set to 0 (the
+ * default under NDEBUG) BPT_DIAGNOSTIC compiles to nothing, so release builds
+ * pay neither the check nor the formatting.
+ */
+#ifndef BPT_DIAGNOSTICS
+#ifdef NDEBUG
+#define BPT_DIAGNOSTICS 0
+#else
+#define BPT_DIAGNOSTICS 1
+#endif
+#endif
+
+using DiagnosticSink = void (*)(const std::string &message);
+
+inline std::atomic<DiagnosticSink> diagnostic_sink{nullptr};
+
+// Install the sink for tree diagnostics, nullptr to drop them. Returns the
+// previous sink.
+inline DiagnosticSink SetDiagnosticSink(DiagnosticSink sink) { return diagnostic_sink.exchange(sink); }
+
+inline DiagnosticSink GetDiagnosticSink() { return diagnostic_sink.load(std::memory_order_acquire); }
+
+// Sink writing one message per line to stderr
+inline void StderrDiagnosticSink(const std::string &message) { std::cerr << message << "\n"; }
+
+// BPT_DIAGNOSTIC("Key not found for key " << key): message is a stream chain
+#if BPT_DIAGNOSTICS
+#define BPT_DIAGNOSTIC(message)                           \
+  do {                                                    \
+    if (DiagnosticSink bpt_sink_ = GetDiagnosticSink()) { \
+      std::ostringstream bpt_out_;                        \
+      bpt_out_ << message;                                \
+      bpt_sink_(bpt_out_.str());                          \
+    }                                                     \
+  } while (0)
+#else
+#define BPT_DIAGNOSTIC(message) \
+  do {                          \
+  } while (0)
+#endif
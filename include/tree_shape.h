@@ -0,0 +1,73 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/tree_shape.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+/**
+ * Height, node counts and node fill of a tree, as returned by
+ * BPlusTree::GetShape, and the outcome of one BPlusTree::Compact slice.
+ *
+ * Fill is counted in ten buckets of a tenth of the node capacity each: a
+ * leaf holding 45 of its 100 slots is in bucket 4, a full node in bucket 9.
+ */
+struct TreeShape {
+  static constexpr int kFillBuckets = 10;
+
+  // levels including the leaves, 0 for an empty tree
+  int height = 0;
+  size_t leaf_nodes = 0;
+  size_t internal_nodes = 0;
+  size_t entries = 0;
+  // slots of all leaves, to relate entries to
+  size_t leaf_slots = 0;
+  // leaves and internal nodes per fill bucket; internal fill counts children
+  std::array<size_t, kFillBuckets> leaf_fill{};
+  std::array<size_t, kFillBuckets> internal_fill{};
+
+  static int FillBucket(int used, int capacity) {
+    int bucket = used * kFillBuckets / capacity;
+    return bucket < kFillBuckets ? bucket : kFillBuckets - 1;
+  }
+
+  size_t Nodes() const { return leaf_nodes + internal_nodes; }
+  double AverageLeafFill() const {
+    return leaf_slots == 0 ? 0.0 : static_cast<double>(entries) / static_cast<double>(leaf_slots);
+  }
+
+  std::string ToJson() const {
+    std::ostringstream out;
+    out << "{\"height\": " << height << ", \"leaf_nodes\": " << leaf_nodes << ", \"internal_nodes\": " << internal_nodes
+        << ", \"entries\": " << entries << ", \"average_leaf_fill\": " << AverageLeafFill() << ", \"leaf_fill\": [";
+    for (int i = 0; i < kFillBuckets; i++) {
+      out << (i == 0 ? "" : ", ") << leaf_fill[i];
+    }
+    out << "], \"internal_fill\": [";
+    for (int i = 0; i < kFillBuckets; i++) {
+      out << (i == 0 ? "" : ", ") << internal_fill[i];
+    }
+    out << "]}";
+    return out.str();
+  }
+};
+
+// What one BPlusTree::Compact call did
+struct CompactResult {
+  // leaves looked at, at most the budget
+  size_t leaves_visited = 0;
+  // leaves emptied into their neighbours and freed
+  size_t leaves_freed = 0;
+  // the pass reached the last leaf; the next call starts over from the first
+  bool done = false;
+};
@@ -0,0 +1,468 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/tree_stats.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Operation statistics for BPlusTree.
+ *
+ * With BPT_STATS set to 1 every tree counts structure modifications, descent
+ * depths and leaves visited by scans, keeps a latency histogram per public
+ * operation and can sample hardware cache and branch misses around descents
+ * with perf_event_open. Counters and histograms are striped over
+ * cache-line-sized shards picked per thread, so threads rarely share a line.
+ *
+ * With BPT_STATS set to 0 (the default) TreeStats is an empty class whose
+ * hooks are empty inline functions: the tree keeps no state for it, reads no
+ * clock and the calls compile away. GetStats() then returns a snapshot with
+ * enabled == false.
+ */
+#ifndef BPT_STATS
+#define BPT_STATS 0
+#endif
+
+enum class TreeCounter {
+  // descents from the root to a leaf, and the levels they crossed
+  kDescents,
+  kDescentLevels,
+  // optimistic descents that restarted after a conflict (thread-safe mode)
+  kOptimisticRestarts,
+  kLeafSplits,
+  kInternalSplits,
+  kRootSplits,
+  kLeafBorrows,
+  kLeafMerges,
+  kInternalBorrows,
+  kInternalMerges,
+  kRootCollapses,
+  // leaves moved to a new allocation because their layout was too small
+  kLeafReplacements,
+  // leaves visited by RangeScan, ForEach and cursors, entries visited by
+  // RangeScan and ForEach
+  kScanLeaves,
+  kScanEntries,
+  // inserts past the largest key that went straight to the cached last leaf
+  kAppends,
+  kCount,
+};
+
+enum class TreeOp {
+  kGetValue,
+  kMultiGet,
+  kInsert,
+  kRemove,
+  kRangeScan,
+  kCount,
+};
+
+inline const char *TreeCounterName(TreeCounter counter) {
+  static const char *const kNames[] = {
+      "descents",         "descent_levels",  "optimistic_restarts", "leaf_splits",
+      "internal_splits",  "root_splits",     "leaf_borrows",        "leaf_merges",
+      "internal_borrows", "internal_merges", "root_collapses",      "leaf_replacements",
+      "scan_leaves",      "scan_entries",    "appends",
+  };
+  return kNames[static_cast<int>(counter)];
+}
+
+inline const char *TreeOpName(TreeOp op) {
+  static const char *const kNames[] = {"get_value", "multi_get", "insert", "remove", "range_scan"};
+  return kNames[static_cast<int>(op)];
+}
+
+constexpr int kTreeCounters = static_cast<int>(TreeCounter::kCount);
+constexpr int kTreeOps = static_cast<int>(TreeOp::kCount);
+
+/*
+ * Log-linear latency histogram in nanoseconds: four buckets per power of two,
+ * so a reported percentile is within 12.5% of the true value.
+ */
+struct LatencyHistogram {
+  static constexpr int kSubBuckets = 4;
+  static constexpr int kBuckets = 64 * kSubBuckets;
+
+  std::array<uint64_t, kBuckets> buckets{};
+  uint64_t count = 0;
+  uint64_t sum_ns = 0;
+
+  static int BucketOf(uint64_t ns) {
+    if (ns < kSubBuckets) return static_cast<int>(ns);
+    int msb = 63 - __builtin_clzll(ns);
+    int sub = static_cast<int>((ns >> (msb - 2)) & (kSubBuckets - 1));
+    return (msb - 1) * kSubBuckets + sub;
+  }
+  static uint64_t LowerBound(int bucket) {
+    if (bucket < kSubBuckets) return static_cast<uint64_t>(bucket);
+    int msb = bucket / kSubBuckets + 1;
+    return static_cast<uint64_t>(kSubBuckets + bucket % kSubBuckets) << (msb - 2);
+  }
+
+  double MeanNs() const { return count == 0 ? 0 : static_cast<double>(sum_ns) / static_cast<double>(count); }
+
+  // Midpoint of the bucket holding the p-th fraction of the samples
+  uint64_t PercentileNs(double p) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < kBuckets; bucket++) {
+      seen += buckets[bucket];
+      if (seen >= rank) {
+        uint64_t lo = LowerBound(bucket);
+        uint64_t hi = bucket + 1 < kBuckets ? LowerBound(bucket + 1) : lo;
+        return lo + (hi - lo) / 2;
+      }
+    }
+    return LowerBound(kBuckets - 1);
+  }
+};
+
+// Point-in-time copy of a tree's statistics
+struct TreeStatsSnapshot {
+  // false when compiled with BPT_STATS=0: everything else is zero
+  bool enabled = false;
+  std::array<uint64_t, kTreeCounters> counters{};
+  std::array<LatencyHistogram, kTreeOps> latency{};
+  // hardware counters summed over the sampled descents
+  bool perf_enabled = false;
+  uint64_t perf_descents = 0;
+  uint64_t cache_misses = 0;
+  uint64_t branch_misses = 0;
+
+  uint64_t Counter(TreeCounter counter) const { return counters[static_cast<int>(counter)]; }
+  const LatencyHistogram &Latency(TreeOp op) const { return latency[static_cast<int>(op)]; }
+
+  double AverageDescentLevels() const {
+    uint64_t descents = Counter(TreeCounter::kDescents);
+    return descents == 0 ? 0 : static_cast<double>(Counter(TreeCounter::kDescentLevels)) / descents;
+  }
+  double CacheMissesPerDescent() const {
+    return perf_descents == 0 ? 0 : static_cast<double>(cache_misses) / static_cast<double>(perf_descents);
+  }
+  double BranchMissesPerDescent() const {
+    return perf_descents == 0 ? 0 : static_cast<double>(branch_misses) / static_cast<double>(perf_descents);
+  }
+
+  // One JSON object
+  std::string ToJson() const {
+    std::ostringstream out;
+    out << "{\"enabled\": " << (enabled ? "true" : "false") << ", \"counters\": {";
+    for (int i = 0; i < kTreeCounters; i++) {
+      out << (i == 0 ? "" : ", ") << "\"" << TreeCounterName(static_cast<TreeCounter>(i)) << "\": " << counters[i];
+    }
+    out << "}, \"average_descent_levels\": " << AverageDescentLevels() << ", \"latency_ns\": {";
+    for (int i = 0; i < kTreeOps; i++) {
+      const LatencyHistogram &histogram = latency[i];
+      out << (i == 0 ? "" : ", ") << "\"" << TreeOpName(static_cast<TreeOp>(i)) << "\": {\"count\": " << histogram.count
+          << ", \"mean\": " << histogram.MeanNs() << ", \"p50\": " << histogram.PercentileNs(0.5)
+          << ", \"p99\": " << histogram.PercentileNs(0.99) << ", \"p999\": " << histogram.PercentileNs(0.999) << "}";
+    }
+    out << "}, \"perf\": {\"enabled\": " << (perf_enabled ? "true" : "false")
+        << ", \"sampled_descents\": " << perf_descents
+        << ", \"cache_misses_per_descent\": " << CacheMissesPerDescent()
+        << ", \"branch_misses_per_descent\": " << BranchMissesPerDescent() << "}}";
+    return out.str();
+  }
+};
+
+using StatsDumpSink = std::function<void(const TreeStatsSnapshot &)>;
+
+// Dump sink writing one JSON line per snapshot to stderr
+inline void PrintStatsToStderr(const TreeStatsSnapshot &snapshot) {
+  std::ostringstream line;
+  line << snapshot.ToJson() << "\n";
+  std::fputs(line.str().c_str(), stderr);
+}
+
+#if BPT_STATS
+
+namespace tree_stats_detail {
+
+/*
+ * Cache misses and branch misses of the calling thread, read as one group.
+ * Opened on first use per thread and closed when the thread exits.
+ */
+class PerfGroup {
+ public:
+  static PerfGroup &ForThisThread() {
+    thread_local PerfGroup group;
+    return group;
+  }
+
+  bool Available() {
+    if (!tried_) open();
+    return leader_ >= 0;
+  }
+
+  // misses[0]: cache misses, misses[1]: branch misses
+  bool Read(uint64_t misses[2]) const {
+#if defined(__linux__)
+    uint64_t values[3];
+    if (::read(leader_, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[0] != 2) {
+      return false;
+    }
+    misses[0] = values[1];
+    misses[1] = values[2];
+    return true;
+#else
+    (void)misses;
+    return false;
+#endif
+  }
+
+  ~PerfGroup() {
+#if defined(__linux__)
+    if (member_ >= 0) ::close(member_);
+    if (leader_ >= 0) ::close(leader_);
+#endif
+  }
+
+ private:
+  void open() {
+    tried_ = true;
+#if defined(__linux__)
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    leader_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    if (leader_ < 0) return;
+    attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+    member_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+    if (member_ < 0) {
+      ::close(leader_);
+      leader_ = -1;
+    }
+#endif
+  }
+
+  bool tried_ = false;
+  int leader_ = -1;
+  int member_ = -1;
+};
+
+// Shard of the calling thread: threads are numbered on first use
+inline size_t threadShard(size_t shards) {
+  static std::atomic<size_t> next_thread{0};
+  thread_local size_t thread_number = next_thread.fetch_add(1, std::memory_order_relaxed);
+  return thread_number % shards;
+}
+
+}  // namespace tree_stats_detail
+
+class TreeStats {
+ public:
+  // one descent in kPerfSampleEvery reads the hardware counters: a read is a
+  // system call
+  static constexpr uint64_t kPerfSampleEvery = 64;
+
+  class OpTimer {
+   public:
+    OpTimer(TreeStats *stats, TreeOp op) : stats_(stats), op_(op), start_(std::chrono::steady_clock::now()) {}
+    OpTimer(const OpTimer &) = delete;
+    OpTimer &operator=(const OpTimer &) = delete;
+    ~OpTimer() {
+      auto elapsed = std::chrono::steady_clock::now() - start_;
+      stats_->record(op_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+   private:
+    TreeStats *stats_;
+    TreeOp op_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  // Reads the hardware counters around one descent when it is sampled
+  class DescentProbe {
+   public:
+    explicit DescentProbe(TreeStats *stats) {
+      if (!stats->perf_enabled_.load(std::memory_order_relaxed)) return;
+      thread_local uint64_t descents = 0;
+      if (descents++ % kPerfSampleEvery != 0) return;
+      tree_stats_detail::PerfGroup &group = tree_stats_detail::PerfGroup::ForThisThread();
+      if (group.Available() && group.Read(before_)) stats_ = stats;
+    }
+    DescentProbe(const DescentProbe &) = delete;
+    DescentProbe &operator=(const DescentProbe &) = delete;
+    ~DescentProbe() {
+      uint64_t after[2];
+      if (stats_ == nullptr || !tree_stats_detail::PerfGroup::ForThisThread().Read(after)) return;
+      Shard &shard = stats_->shard();
+      shard.perf_descents.fetch_add(1, std::memory_order_relaxed);
+      shard.cache_misses.fetch_add(after[0] - before_[0], std::memory_order_relaxed);
+      shard.branch_misses.fetch_add(after[1] - before_[1], std::memory_order_relaxed);
+    }
+
+   private:
+    TreeStats *stats_ = nullptr;
+    uint64_t before_[2] = {0, 0};
+  };
+
+  TreeStats() : shards_(std::make_unique<Shard[]>(kShards)) {}
+  ~TreeStats() { StopDump(); }
+  TreeStats(const TreeStats &) = delete;
+  TreeStats &operator=(const TreeStats &) = delete;
+
+  void Count(TreeCounter counter, uint64_t n = 1) {
+    shard().counters[static_cast<int>(counter)].fetch_add(n, std::memory_order_relaxed);
+  }
+  void CountDescent(int levels) {
+    Shard &s = shard();
+    s.counters[static_cast<int>(TreeCounter::kDescents)].fetch_add(1, std::memory_order_relaxed);
+    s.counters[static_cast<int>(TreeCounter::kDescentLevels)].fetch_add(levels, std::memory_order_relaxed);
+  }
+  OpTimer Time(TreeOp op) { return OpTimer(this, op); }
+  DescentProbe ProbeDescent() { return DescentProbe(this); }
+
+  // Sample cache and branch misses around descents. Returns false if the
+  // calling thread cannot open the hardware counters.
+  bool EnablePerf(bool enable) {
+    if (enable && !tree_stats_detail::PerfGroup::ForThisThread().Available()) return false;
+    perf_enabled_.store(enable, std::memory_order_relaxed);
+    return true;
+  }
+
+  TreeStatsSnapshot Snapshot() const {
+    TreeStatsSnapshot snapshot;
+    snapshot.enabled = true;
+    snapshot.perf_enabled = perf_enabled_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kShards; i++) {
+      const Shard &s = shards_[i];
+      for (int c = 0; c < kTreeCounters; c++) snapshot.counters[c] += s.counters[c].load(std::memory_order_relaxed);
+      for (int op = 0; op < kTreeOps; op++) {
+        LatencyHistogram &histogram = snapshot.latency[op];
+        for (int b = 0; b < LatencyHistogram::kBuckets; b++) {
+          uint64_t n = s.latency[op][b].load(std::memory_order_relaxed);
+          histogram.buckets[b] += n;
+          histogram.count += n;
+        }
+        histogram.sum_ns += s.latency_sum[op].load(std::memory_order_relaxed);
+      }
+      snapshot.perf_descents += s.perf_descents.load(std::memory_order_relaxed);
+      snapshot.cache_misses += s.cache_misses.load(std::memory_order_relaxed);
+      snapshot.branch_misses += s.branch_misses.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+  // Not atomic with respect to operations running at the same time
+  void Reset() {
+    for (size_t i = 0; i < kShards; i++) {
+      Shard &s = shards_[i];
+      for (auto &counter : s.counters) counter.store(0, std::memory_order_relaxed);
+      for (auto &histogram : s.latency) {
+        for (auto &bucket : histogram) bucket.store(0, std::memory_order_relaxed);
+      }
+      for (auto &sum : s.latency_sum) sum.store(0, std::memory_order_relaxed);
+      s.perf_descents.store(0, std::memory_order_relaxed);
+      s.cache_misses.store(0, std::memory_order_relaxed);
+      s.branch_misses.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Hand a snapshot to sink every period from a background thread until
+  // StopDump. Returns false if a dump is already running.
+  bool StartDump(std::chrono::milliseconds period, StatsDumpSink sink) {
+    std::lock_guard<std::mutex> guard(dump_mutex_);
+    if (dump_thread_.joinable()) return false;
+    dump_stop_ = false;
+    dump_thread_ = std::thread([this, period, sink = std::move(sink)] {
+      std::unique_lock<std::mutex> lock(dump_mutex_);
+      while (!dump_cv_.wait_for(lock, period, [this] { return dump_stop_; })) {
+        lock.unlock();
+        sink(Snapshot());
+        lock.lock();
+      }
+    });
+    return true;
+  }
+
+  void StopDump() {
+    std::thread thread;
+    {
+      std::lock_guard<std::mutex> guard(dump_mutex_);
+      dump_stop_ = true;
+      thread = std::move(dump_thread_);
+    }
+    dump_cv_.notify_all();
+    if (thread.joinable()) thread.join();
+  }
+
+ private:
+  static constexpr size_t kShards = 16;
+
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> counters[kTreeCounters] = {};
+    std::atomic<uint64_t> latency[kTreeOps][LatencyHistogram::kBuckets] = {};
+    std::atomic<uint64_t> latency_sum[kTreeOps] = {};
+    std::atomic<uint64_t> perf_descents{0};
+    std::atomic<uint64_t> cache_misses{0};
+    std::atomic<uint64_t> branch_misses{0};
+  };
+
+  Shard &shard() const { return shards_[tree_stats_detail::threadShard(kShards)]; }
+
+  void record(TreeOp op, uint64_t ns) {
+    Shard &s = shard();
+    s.latency[static_cast<int>(op)][LatencyHistogram::BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    s.latency_sum[static_cast<int>(op)].fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<bool> perf_enabled_{false};
+  std::mutex dump_mutex_;
+  std::condition_variable dump_cv_;
+  std::thread dump_thread_;
+  bool dump_stop_ = false;
+};
+
+#else
+
+// Statistics compiled out: every hook is empty
+class TreeStats {
+ public:
+  struct OpTimer {};
+  struct DescentProbe {};
+
+  void Count(TreeCounter, uint64_t = 1) {}
+  void CountDescent(int) {}
+  OpTimer Time(TreeOp) { return OpTimer(); }
+  DescentProbe ProbeDescent() { return DescentProbe(); }
+  bool EnablePerf(bool enable) { return !enable; }
+  TreeStatsSnapshot Snapshot() const { return TreeStatsSnapshot(); }
+  void Reset() {}
+  bool StartDump(std::chrono::milliseconds, StatsDumpSink) { return false; }
+  void StopDump() {}
+};
+
+#endif
@@ -0,0 +1,163 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/work_stealing_pool.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of threads running batches of indexed tasks, see ParallelFor.
+ * Every thread, the caller included, has its own queue: a batch is dealt out
+ * round robin, each thread takes tasks from the back of its queue, and a
+ * thread whose queue is empty steals from the front of the others', so a few
+ * slow tasks do not leave the rest of the threads idle.
+ */
+class WorkStealingPool {
+ public:
+  // threads counts the calling thread; 0 means one per hardware thread
+  explicit WorkStealingPool(size_t threads = 0) {
+    if (threads == 0) threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < threads; i++) queues_.push_back(std::make_unique<Queue>());
+    for (size_t i = 1; i < threads; i++) workers_.emplace_back([this, i] { workerLoop(i); });
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &worker : workers_) worker.join();
+  }
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  size_t Threads() const { return queues_.size(); }
+
+  // Run task(i) for every i in [0, tasks) and return once all are done. The
+  // calling thread runs tasks too; calls from several threads take turns. A
+  // task that calls ParallelFor on its own pool runs that batch inline, since
+  // the pool is busy with the batch waiting for it.
+  void ParallelFor(size_t tasks, const std::function<void(size_t)> &task) {
+    if (tasks == 0) return;
+    if (runningPool() == this) {
+      for (size_t i = 0; i < tasks; i++) task(i);
+      return;
+    }
+    std::lock_guard<std::mutex> batch(batch_mutex_);
+    // a thread still leaving the previous batch may pick up the first tasks,
+    // so the batch is set up before any task is queued
+    pending_.store(tasks);
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      task_ = &task;
+    }
+    for (size_t i = 0; i < tasks; i++) {
+      Queue &queue = *queues_[i % queues_.size()];
+      std::lock_guard<std::mutex> guard(queue.mutex);
+      queue.tasks.push_back(i);
+    }
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      generation_++;
+    }
+    wake_.notify_all();
+    runTasks(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_.load() == 0; });
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  void workerLoop(size_t self) {
+    uint64_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) return;
+        seen = generation_;
+      }
+      runTasks(self);
+    }
+  }
+
+  // the pool whose task the calling thread is running, if any
+  static const WorkStealingPool *&runningPool() {
+    thread_local const WorkStealingPool *pool = nullptr;
+    return pool;
+  }
+
+  // Run tasks from the own queue, then stolen ones, until all queues are empty
+  void runTasks(size_t self) {
+    size_t task;
+    while (take(self, task)) {
+      const WorkStealingPool *outer = runningPool();
+      runningPool() = this;
+      (*task_)(task);
+      runningPool() = outer;
+      if (pending_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        done_.notify_all();
+      }
+    }
+  }
+
+  bool take(size_t self, size_t &task) {
+    {
+      Queue &own = *queues_[self];
+      std::lock_guard<std::mutex> guard(own.mutex);
+      if (!own.tasks.empty()) {
+        task = own.tasks.back();
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+    for (size_t i = 1; i < queues_.size(); i++) {
+      Queue &victim = *queues_[(self + i) % queues_.size()];
+      std::lock_guard<std::mutex> guard(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  // one batch at a time
+  std::mutex batch_mutex_;
+  // guards task_, generation_ and stop_
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(size_t)> *task_ = nullptr;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+  // tasks of the current batch not finished yet
+  std::atomic<size_t> pending_{0};
+};
@@ -0,0 +1,239 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Rutgers CS539 - Database System
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification:   include/write_ahead_log.h
+//
+// Copyright (c) 2022, Rutgers University
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// When Commit() waits for the log to reach the disk
+enum class WalSyncMode {
+  // hand records to the OS only: survives a process crash, not a power loss
+  kNoSync,
+  // one fdatasync covers every record appended while the previous one ran
+  kGroupCommit,
+  // an fdatasync for every commit, even when another one just covered it
+  kEveryCommit,
+};
+
+struct WalOptions {
+  WalSyncMode sync_mode = WalSyncMode::kGroupCommit;
+  // group commit: how long a commit leader waits for more records to join
+  // its batch before syncing. Zero batches only what piled up meanwhile.
+  std::chrono::microseconds group_delay{0};
+};
+
+// CRC-32 (IEEE) for torn-record detection
+inline uint32_t Crc32(const void *data, size_t len, uint32_t crc = 0) {
+  static const auto table = [] {
+    std::vector<uint32_t> t(256);
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+/**
+ * Append-only redo log of opaque records.
+ *
+ * Every record gets the next log sequence number (LSN). Append() only copies
+ * the record into memory; Commit(lsn) returns once the record is as durable as
+ * the sync mode promises. With group commit the first committer becomes the
+ * leader, writes everything buffered so far and syncs once for the whole
+ * batch while later committers wait for it.
+ *
+ * On disk a record is [payload length][crc][lsn][payload]. A torn or corrupt
+ * record ends replay, so a crash mid-write loses only uncommitted records.
+ */
+class WriteAheadLog {
+ public:
+  using ReplayCallback = std::function<void(uint64_t lsn, const char *payload, size_t len)>;
+
+  // Open (or create) the log for appending; new records continue after
+  // next_lsn - 1
+  WriteAheadLog(const std::string &path, const WalOptions &options, uint64_t next_lsn)
+      : options_(options), next_lsn_(next_lsn), durable_lsn_(next_lsn - 1) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  }
+  WriteAheadLog(const WriteAheadLog &) = delete;
+  WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+  ~WriteAheadLog() {
+    if (fd_ < 0) return;
+    Sync();
+    ::close(fd_);
+  }
+
+  bool IsOpen() const { return fd_ >= 0; }
+
+  // Buffer a record and return its LSN
+  uint64_t Append(const void *payload, uint32_t len) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    uint64_t lsn = next_lsn_++;
+    uint32_t crc = Crc32(&lsn, sizeof(lsn));
+    crc = Crc32(payload, len, crc);
+    const char *bytes = static_cast<const char *>(payload);
+    buffer_.insert(buffer_.end(), reinterpret_cast<const char *>(&len), reinterpret_cast<const char *>(&len) + 4);
+    buffer_.insert(buffer_.end(), reinterpret_cast<const char *>(&crc), reinterpret_cast<const char *>(&crc) + 4);
+    buffer_.insert(buffer_.end(), reinterpret_cast<const char *>(&lsn), reinterpret_cast<const char *>(&lsn) + 8);
+    buffer_.insert(buffer_.end(), bytes, bytes + len);
+    return lsn;
+  }
+
+  // Wait until lsn is durable. Returns false after an I/O error.
+  bool Commit(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (options_.sync_mode != WalSyncMode::kGroupCommit) {
+      while (flushing_) flushed_.wait(lock);
+      return writeBuffered(lock, options_.sync_mode == WalSyncMode::kEveryCommit);
+    }
+    while (durable_lsn_ < lsn && ok_) {
+      if (flushing_) {
+        flushed_.wait(lock);
+        continue;
+      }
+      if (options_.group_delay.count() > 0) {
+        // let more records join the batch
+        flushing_ = true;
+        lock.unlock();
+        std::this_thread::sleep_for(options_.group_delay);
+        lock.lock();
+        flushing_ = false;
+      }
+      writeBuffered(lock, true);
+    }
+    return ok_;
+  }
+
+  // Hand buffered records to the OS and sync them, whatever the mode
+  bool Sync() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (flushing_) flushed_.wait(lock);
+    return writeBuffered(lock, true);
+  }
+
+  // Drop every record, e.g. once a checkpoint covers them
+  bool Truncate() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (flushing_) flushed_.wait(lock);
+    buffer_.clear();
+    durable_lsn_ = next_lsn_ - 1;
+    ok_ = ::ftruncate(fd_, 0) == 0 && ::fdatasync(fd_) == 0 && ok_;
+    return ok_;
+  }
+
+  uint64_t LastLsn() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return next_lsn_ - 1;
+  }
+
+  size_t Syncs() const { return syncs_; }
+
+  // Call back for every intact record of the log at path, in LSN order.
+  // Returns the last LSN seen, or 0 for a missing or empty log. valid_bytes
+  // receives the length of the intact prefix, which is where appending has
+  // to resume after a torn write.
+  static uint64_t Replay(const std::string &path, const ReplayCallback &callback, size_t *valid_bytes = nullptr) {
+    if (valid_bytes != nullptr) *valid_bytes = 0;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return 0;
+    std::vector<char> data;
+    char chunk[1 << 16];
+    ssize_t n;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) > 0) data.insert(data.end(), chunk, chunk + n);
+    ::close(fd);
+
+    uint64_t last = 0;
+    size_t pos = 0;
+    while (pos + kHeaderBytes <= data.size()) {
+      uint32_t len, crc;
+      uint64_t lsn;
+      std::memcpy(&len, &data[pos], 4);
+      std::memcpy(&crc, &data[pos + 4], 4);
+      std::memcpy(&lsn, &data[pos + 8], 8);
+      if (pos + kHeaderBytes + len > data.size()) break;
+      const char *payload = &data[pos + kHeaderBytes];
+      if (Crc32(payload, len, Crc32(&lsn, sizeof(lsn))) != crc) break;
+      callback(lsn, payload, len);
+      last = lsn;
+      pos += kHeaderBytes + len;
+    }
+    if (valid_bytes != nullptr) *valid_bytes = pos;
+    return last;
+  }
+
+ private:
+  static constexpr size_t kHeaderBytes = 16;
+
+  // Write the buffer out (and sync it) with the mutex released, so appends
+  // continue into a fresh buffer meanwhile. Called with lock held.
+  bool writeBuffered(std::unique_lock<std::mutex> &lock, bool sync) {
+    if (buffer_.empty() && !sync) return ok_;
+    // appends continue into the spare buffer, which keeps its capacity
+    std::vector<char> batch;
+    batch.swap(buffer_);
+    buffer_.swap(spare_);
+    uint64_t batch_lsn = next_lsn_ - 1;
+    flushing_ = true;
+    lock.unlock();
+
+    bool ok = true;
+    size_t done = 0;
+    while (done < batch.size()) {
+      ssize_t n = ::write(fd_, batch.data() + done, batch.size() - done);
+      if (n <= 0) {
+        ok = false;
+        break;
+      }
+      done += n;
+    }
+    if (ok && sync) {
+      ok = ::fdatasync(fd_) == 0;
+      syncs_++;
+    }
+
+    lock.lock();
+    batch.clear();
+    spare_.swap(batch);
+    flushing_ = false;
+    ok_ = ok_ && ok;
+    if (ok && sync) durable_lsn_ = batch_lsn;
+    flushed_.notify_all();
+    return ok_;
+  }
+
+  WalOptions options_;
+  int fd_ = -1;
+  std::mutex mutex_;
+  std::condition_variable flushed_;
+  std::vector<char> buffer_;
+  std::vector<char> spare_;
+  uint64_t next_lsn_;
+  uint64_t durable_lsn_;
+  bool flushing_ = false;
+  bool ok_ = true;
+  size_t syncs_ = 0;
+};
@@ -0,0 +1,103 @@
+// Thread-safe mode under concurrent writers and readers. Each writer owns the
+// keys congruent to its index and inserts, removes and looks them up while
+// checking its own keys in every scan; scanner threads walk the whole tree
+// meanwhile and check that what they see is sorted and never holds a value
+// written for another key. At the end the tree must hold exactly the keys the
+// writers left behind.
+#include "include/b_plus_tree.h"
+#include "tests/test_util.h"
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+constexpr int kWriters = 4;
+constexpr int kScanners = 2;
+constexpr int kKeysPerWriter = 4000;
+constexpr int kOpsPerWriter = 60000;
+
+template <typename Tree>
+static void runStress(const char *name, bool lazy) {
+  Tree tree;
+  BPT_CHECK(tree.SetThreadSafe(true));
+  tree.SetLazyDeletes(lazy);
+  std::atomic<bool> writing{true};
+  std::vector<std::set<int>> owned(kWriters);
+
+  std::vector<std::thread> threads;
+  for (int w = 0; w < kWriters; w++) {
+    threads.emplace_back([&, w] {
+      std::mt19937 rng(w + 1);
+      std::set<int> &mine = owned[w];
+      for (int i = 0; i < kOpsPerWriter; i++) {
+        int k = static_cast<int>(rng() % kKeysPerWriter) * kWriters + w;
+        int op = static_cast<int>(rng() % 8);
+        if (op < 3) {
+          BPT_CHECK(tree.Insert(k, RecordPointer(k, i)) == mine.insert(k).second);
+        } else if (op < 5) {
+          RecordPointer old;
+          WriteStatus status = tree.Remove(k, &old);
+          BPT_CHECK((status == WriteStatus::kRemoved) == (mine.erase(k) == 1));
+          if (status == WriteStatus::kRemoved) BPT_CHECK(old.page_id == k);
+        } else if (op < 7) {
+          RecordPointer found;
+          BPT_CHECK(tree.GetValue(k, found) == (mine.count(k) == 1));
+        } else {
+          int high = k + 64 * kWriters;
+          std::vector<RecordPointer> scanned;
+          tree.RangeScan(k, high, scanned);
+          size_t own = 0;
+          int previous = k - 1;
+          for (auto &value : scanned) {
+            BPT_CHECK(value.page_id > previous && value.page_id < high);
+            previous = value.page_id;
+            if (value.page_id % kWriters == w) own++;
+          }
+          size_t expected = 0;
+          for (auto it = mine.lower_bound(k); it != mine.end() && *it < high; ++it) expected++;
+          BPT_CHECK(own == expected);
+        }
+      }
+    });
+  }
+  for (int s = 0; s < kScanners; s++) {
+    threads.emplace_back([&] {
+      while (writing.load()) {
+        int previous = -1;
+        tree.ForEach(0, kKeysPerWriter * kWriters, [&](const auto &key, const auto &value) {
+          BPT_CHECK(key > previous && value.page_id == key);
+          previous = key;
+          return true;
+        });
+        std::vector<RecordPointer> scanned;
+        tree.ReverseRangeScan(0, kKeysPerWriter * kWriters, scanned, 100);
+        for (size_t i = 1; i < scanned.size(); i++) BPT_CHECK(scanned[i].page_id < scanned[i - 1].page_id);
+      }
+    });
+  }
+  for (int w = 0; w < kWriters; w++) threads[w].join();
+  writing = false;
+  for (size_t t = kWriters; t < threads.size(); t++) threads[t].join();
+
+  tree.SetThreadSafe(false);
+  std::set<int> all;
+  for (auto &mine : owned) all.insert(mine.begin(), mine.end());
+  BPT_CHECK(static_cast<size_t>(tree.size) == all.size());
+  auto it = all.begin();
+  for (auto cursor = tree.Begin(); cursor.Valid(); cursor.Next(), ++it) {
+    BPT_CHECK(it != all.end() && cursor.Key() == *it);
+  }
+  BPT_CHECK(it == all.end());
+  std::printf("%-8s ok\n", name);
+}
+
+int main() {
+  runStress<BPlusTree<int, RecordPointer>>("plain", false);
+  runStress<BPlusTree<int, RecordPointer, 5, std::less<int>, HeapNodeAllocator>>("plain-5", false);
+  runStress<PackedBPlusTree<int, 16>>("packed", false);
+  runStress<BPlusTree<int, RecordPointer, 8>>("lazy", true);
+  return 0;
+}
@@ -0,0 +1,815 @@
+// Random inserts, updates, removes, lookups and scans run against each tree
+// configuration and a std::map side by side; every answer has to match the
+// map's, and the whole contents are compared at intervals and after draining.
+// Covers plain, packed and string leaves, trees ordered by InterpolatingLess,
+// compaction, lazy deletes, ascending appends, fingers, parallel scans on the
+// work stealing pool, batched lookups, serial and parallel bulk loading,
+// frozen snapshots, the buffered tree, and the disk tree, whose pages have to
+// be reused once emptied.
+#include "include/b_plus_tree.h"
+#include "include/buffered_b_plus_tree.h"
+#include "include/disk_b_plus_tree.h"
+#include "tests/test_util.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+constexpr int kOps = 200000;
+constexpr int kCheckEvery = 20000;
+
+static bool sameValue(const RecordPointer &a, const RecordPointer &b) {
+  return a.page_id == b.page_id && a.record_id == b.record_id;
+}
+
+// Distinct, unordered string keys with shared prefixes and mixed lengths
+static StringKey stringKey(int k) {
+  static const char *const kPrefixes[] = {"https://www.example.com/a/", "https://www.example.com/b/", "tenant-", "", "zz"};
+  std::string key = kPrefixes[k % 5] + std::to_string(k);
+  if (k % 3 == 0) key.append(k % 17, 'x');
+  return StringKey(key);
+}
+
+template <typename Tree, typename Key>
+static void checkContents(Tree &tree, const std::map<Key, RecordPointer> &oracle) {
+  BPT_CHECK(static_cast<size_t>(tree.size) == oracle.size());
+  BPT_CHECK(tree.GetShape().entries == oracle.size());
+  auto it = oracle.begin();
+  for (auto cursor = tree.Begin(); cursor.Valid(); cursor.Next(), ++it) {
+    BPT_CHECK(it != oracle.end());
+    BPT_CHECK(!(cursor.Key() < it->first) && !(it->first < cursor.Key()));
+    BPT_CHECK(sameValue(cursor.Value(), it->second));
+  }
+  BPT_CHECK(it == oracle.end());
+  auto rit = oracle.rbegin();
+  for (auto cursor = tree.ReverseBegin(); cursor.Valid(); cursor.Next(), ++rit) {
+    BPT_CHECK(rit != oracle.rend());
+    BPT_CHECK(sameValue(cursor.Value(), rit->second));
+  }
+  BPT_CHECK(rit == oracle.rend());
+}
+
+// Values of the oracle in [low, high) after skipping offset, at most limit
+template <typename Key>
+static std::vector<RecordPointer> expectedScan(const std::map<Key, RecordPointer> &oracle, const Key &low,
+                                               const Key &high, size_t limit, size_t offset, bool reverse) {
+  std::vector<RecordPointer> out;
+  size_t skipped = 0;
+  auto take = [&](const RecordPointer &value) {
+    if (skipped < offset) {
+      skipped++;
+    } else {
+      out.push_back(value);
+    }
+    return out.size() < limit;
+  };
+  if (limit == 0 || !(low < high)) return out;
+  if (reverse) {
+    auto first = oracle.lower_bound(low);
+    for (auto it = oracle.lower_bound(high); it != first && take(std::prev(it)->second); --it) {
+    }
+  } else {
+    for (auto it = oracle.lower_bound(low); it != oracle.end() && it->first < high && take(it->second); ++it) {
+    }
+  }
+  return out;
+}
+
+// Runs kOps random operations on keys make_key(0 .. key_range). Phases
+// alternate between insert-heavy and remove-heavy so leaves split and merge
+// (and, with compact, get repacked in slices between the operations). With
+// lazy deletes a leaf is rebalanced only once it falls below kLazyMergeFill
+// of its capacity, and separators left stale by removes are kept.
+template <typename Tree, typename MakeKey>
+static void runDifferential(const char *name, Tree &tree, MakeKey make_key, int key_range, bool compact,
+                            bool lazy) {
+  using Key = std::decay_t<decltype(make_key(0))>;
+  std::map<Key, RecordPointer> oracle;
+  std::mt19937 rng(42);
+  if (lazy) tree.SetLazyDeletes(true);
+  for (int i = 0; i < kOps; i++) {
+    int k = static_cast<int>(rng() % key_range);
+    Key key = make_key(k);
+    RecordPointer value(k, i);
+    bool removing = (i / (kOps / 8)) % 2 == 1;
+    int op = static_cast<int>(rng() % 10);
+    if (op < (removing ? 2 : 5)) {
+      bool inserted = tree.Insert(key, value);
+      BPT_CHECK(inserted == oracle.emplace(key, value).second);
+    } else if (op < 6) {
+      RecordPointer old;
+      WriteStatus status = tree.InsertOrAssign(key, value, &old);
+      auto it = oracle.find(key);
+      BPT_CHECK(status == (it == oracle.end() ? WriteStatus::kInserted : WriteStatus::kUpdated));
+      if (it != oracle.end()) BPT_CHECK(sameValue(old, it->second));
+      oracle[key] = value;
+    } else if (op < 8) {
+      RecordPointer old;
+      WriteStatus status = tree.Remove(key, &old);
+      auto it = oracle.find(key);
+      BPT_CHECK(status == (it == oracle.end() ? WriteStatus::kNotFound : WriteStatus::kRemoved));
+      if (it != oracle.end()) {
+        BPT_CHECK(sameValue(old, it->second));
+        oracle.erase(it);
+      }
+    } else if (op < 9) {
+      RecordPointer found;
+      auto it = oracle.find(key);
+      BPT_CHECK(tree.GetValue(key, found) == (it != oracle.end()));
+      if (it != oracle.end()) BPT_CHECK(sameValue(found, it->second));
+    } else {
+      Key other = make_key(static_cast<int>(rng() % key_range));
+      Key low = key < other ? key : other;
+      Key high = key < other ? other : key;
+      size_t limit = rng() % 8 ? rng() % 64 : SIZE_MAX;
+      size_t offset = rng() % 4 ? 0 : rng() % 32;
+      bool reverse = rng() % 2;
+      std::vector<RecordPointer> scanned;
+      if (reverse) {
+        tree.ReverseRangeScan(low, high, scanned, limit, offset);
+      } else {
+        tree.RangeScan(low, high, scanned, limit, offset);
+      }
+      std::vector<RecordPointer> expected = expectedScan(oracle, low, high, limit, offset, reverse);
+      BPT_CHECK(scanned.size() == expected.size());
+      for (size_t j = 0; j < expected.size(); j++) BPT_CHECK(sameValue(scanned[j], expected[j]));
+    }
+    if (compact && i % 1000 == 999) tree.Compact(16);
+    if (i % kCheckEvery == kCheckEvery - 1) checkContents(tree, oracle);
+  }
+  checkContents(tree, oracle);
+
+  for (auto &entry : oracle) BPT_CHECK(tree.Remove(entry.first, nullptr) == WriteStatus::kRemoved);
+  oracle.clear();
+  if (compact) {
+    while (!tree.Compact(64).done) {
+    }
+  }
+  checkContents(tree, oracle);
+  BPT_CHECK(tree.IsEmpty());
+  BPT_CHECK(tree.GetAllocatorStats().live_nodes == 0);
+  std::printf("%-8s ok\n", name);
+}
+
+// MultiGet against a std::map: on an empty tree, then for batches below, at
+// and above the group size with missing and repeated keys, and through a
+// frozen snapshot and in thread-safe mode. Results of missing keys must stay
+// untouched.
+template <typename Tree, typename MakeKey>
+static void runMultiGet(const char *name, Tree &tree, MakeKey make_key, int key_range) {
+  using Key = std::decay_t<decltype(make_key(0))>;
+  const RecordPointer untouched(-1, -1);
+  std::map<Key, RecordPointer> oracle;
+  std::mt19937 rng(9);
+  auto check = [&](auto &index, const std::vector<Key> &keys) {
+    std::vector<RecordPointer> results(keys.size(), untouched);
+    std::vector<bool> found;
+    size_t hits = index.MultiGet(std::span<const Key>(keys), std::span<RecordPointer>(results), found);
+    BPT_CHECK(found.size() == keys.size());
+    size_t expected_hits = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+      auto it = oracle.find(keys[i]);
+      BPT_CHECK(found[i] == (it != oracle.end()));
+      BPT_CHECK(sameValue(results[i], it != oracle.end() ? it->second : untouched));
+      expected_hits += it != oracle.end();
+    }
+    BPT_CHECK(hits == expected_hits);
+  };
+  auto batch = [&](size_t n) {
+    std::vector<Key> keys;
+    for (size_t i = 0; i < n; i++) keys.push_back(make_key(static_cast<int>(rng() % key_range)));
+    return keys;
+  };
+  check(tree, batch(40));
+  for (int i = 0; i < key_range / 2; i++) {
+    int k = static_cast<int>(rng() % key_range);
+    RecordPointer value(k, i);
+    if (oracle.emplace(make_key(k), value).second) BPT_CHECK(tree.Insert(make_key(k), value));
+  }
+  for (size_t n : {0, 1, 15, 16, 17, 100, 5000}) {
+    std::vector<Key> keys = batch(n);
+    check(tree, keys);
+    auto frozen = tree.Freeze();
+    check(frozen, keys);
+  }
+  if constexpr (std::is_trivially_copyable_v<Key>) {
+    BPT_CHECK(tree.SetThreadSafe(true));
+    check(tree, batch(100));
+    tree.SetThreadSafe(false);
+  }
+  std::printf("%-8s ok\n", name);
+}
+
+// Ascending inserts take the append path: leaves and internal nodes off the
+// right edge have to stay nearly full rather than half full. Removes and
+// shuffled inserts afterwards still have to agree with a std::map.
+template <typename Tree>
+static void runAppend(const char *name) {
+  constexpr int kKeys = 100000;
+  Tree tree;
+  std::map<int, RecordPointer> oracle;
+  for (int k = 0; k < kKeys; k++) {
+    BPT_CHECK(tree.Insert(k, RecordPointer(k, 0)));
+    oracle.emplace(k, RecordPointer(k, 0));
+  }
+  TreeShape shape = tree.GetShape();
+  BPT_CHECK(shape.AverageLeafFill() >= 0.8);
+  size_t full_leaves = 0;
+  size_t full_internal = 0;
+  for (int b = 7; b < TreeShape::kFillBuckets; b++) {
+    full_leaves += shape.leaf_fill[b];
+    full_internal += shape.internal_fill[b];
+  }
+  // only the right edge may be left emptier, one node per level
+  BPT_CHECK(full_leaves + 1 >= shape.leaf_nodes);
+  BPT_CHECK(full_internal + static_cast<size_t>(shape.height) >= shape.internal_nodes);
+  checkContents(tree, oracle);
+
+  std::mt19937 rng(21);
+  for (int i = 0; i < kKeys; i++) {
+    int k = static_cast<int>(rng() % kKeys);
+    if (i % 3 == 2) {
+      BPT_CHECK(tree.Insert(k, RecordPointer(k, i)) == oracle.emplace(k, RecordPointer(k, i)).second);
+    } else {
+      BPT_CHECK((tree.Remove(k, nullptr) == WriteStatus::kRemoved) == (oracle.erase(k) == 1));
+    }
+    if (i % kCheckEvery == kCheckEvery - 1) checkContents(tree, oracle);
+  }
+  for (int k = kKeys; k < 2 * kKeys; k++) {
+    BPT_CHECK(tree.Insert(k, RecordPointer(k, 0)));
+    oracle.emplace(k, RecordPointer(k, 0));
+  }
+  checkContents(tree, oracle);
+  for (int probe = 0; probe < 1000; probe++) {
+    int low = static_cast<int>(rng() % (2 * kKeys));
+    int high = low + static_cast<int>(rng() % 5000);
+    std::vector<RecordPointer> scanned;
+    tree.RangeScan(low, high, scanned);
+    std::vector<RecordPointer> expected = expectedScan(oracle, low, high, SIZE_MAX, 0, false);
+    BPT_CHECK(scanned.size() == expected.size());
+    for (size_t j = 0; j < expected.size(); j++) BPT_CHECK(sameValue(scanned[j], expected[j]));
+  }
+  for (auto &entry : oracle) BPT_CHECK(tree.Remove(entry.first, nullptr) == WriteStatus::kRemoved);
+  BPT_CHECK(tree.IsEmpty());
+  BPT_CHECK(tree.GetAllocatorStats().live_nodes == 0);
+  std::printf("%-8s ok\n", name);
+}
+
+// Fingers against a std::map. A local walk of small steps in both directions
+// keeps the finger on its leaf or moves it to a neighbour; jumps and writes
+// through the tree itself make it descend again. Compact, BulkLoad and Clear
+// change the structure under it in between, and its writes split and merge
+// leaves through the path it cached.
+template <typename Tree>
+static void runFinger(const char *name) {
+  constexpr int kKeys = 20000;
+  Tree tree;
+  std::map<int, RecordPointer> oracle;
+  std::mt19937 rng(17);
+  auto finger = tree.MakeFinger();
+  int k = 0;
+  for (int i = 0; i < kOps; i++) {
+    bool removing = (i / (kOps / 8)) % 2 == 1;
+    bool jump = rng() % 16 == 0;
+    k = jump ? static_cast<int>(rng() % kKeys) : (k + static_cast<int>(rng() % 9) + kKeys - 4) % kKeys;
+    RecordPointer value(k, i);
+    int op = static_cast<int>(rng() % 10);
+    if (op < (removing ? 1 : 2)) {
+      BPT_CHECK(finger.Insert(k, value) == oracle.emplace(k, value).second);
+    } else if (op < (removing ? 2 : 4)) {
+      RecordPointer existing;
+      WriteStatus status = finger.Insert(k, value, &existing);
+      auto [it, inserted] = oracle.emplace(k, value);
+      BPT_CHECK(status == (inserted ? WriteStatus::kInserted : WriteStatus::kDuplicate));
+      if (!inserted) BPT_CHECK(sameValue(existing, it->second));
+    } else if (op < 5) {
+      RecordPointer old;
+      WriteStatus status = finger.InsertOrAssign(k, value, &old);
+      auto it = oracle.find(k);
+      BPT_CHECK(status == (it == oracle.end() ? WriteStatus::kInserted : WriteStatus::kUpdated));
+      if (it != oracle.end()) BPT_CHECK(sameValue(old, it->second));
+      oracle[k] = value;
+    } else if (op < 7) {
+      RecordPointer old;
+      WriteStatus status = finger.Remove(k, &old);
+      auto it = oracle.find(k);
+      BPT_CHECK(status == (it == oracle.end() ? WriteStatus::kNotFound : WriteStatus::kRemoved));
+      if (it != oracle.end()) {
+        BPT_CHECK(sameValue(old, it->second));
+        oracle.erase(it);
+      }
+    } else if (op < 9) {
+      RecordPointer found;
+      auto it = oracle.find(k);
+      BPT_CHECK(finger.GetValue(k, found) == (it != oracle.end()));
+      if (it != oracle.end()) BPT_CHECK(sameValue(found, it->second));
+    } else {
+      // the tree changes behind the finger
+      int other = static_cast<int>(rng() % kKeys);
+      if (rng() % 2) {
+        BPT_CHECK(tree.InsertOrAssign(other, value) ==
+                  (oracle.count(other) ? WriteStatus::kUpdated : WriteStatus::kInserted));
+        oracle[other] = value;
+      } else {
+        BPT_CHECK((tree.Remove(other, nullptr) == WriteStatus::kRemoved) == (oracle.erase(other) == 1));
+      }
+    }
+    if (i % 5000 == 4999) tree.Compact(16);
+    if (i % 40000 == 39999) {
+      std::vector<std::pair<int, RecordPointer>> entries(oracle.begin(), oracle.end());
+      tree.Clear();
+      BPT_CHECK(tree.BulkLoad(entries, 0.5 + (i / 40000) % 2 * 0.5));
+    }
+    if (i % kCheckEvery == kCheckEvery - 1) checkContents(tree, oracle);
+  }
+  checkContents(tree, oracle);
+  const FingerStats &stats = finger.Stats();
+  BPT_CHECK(stats.hits > 0 && stats.neighbor_hits > 0 && stats.misses > 0);
+  BPT_CHECK(stats.Operations() > static_cast<size_t>(kOps) * 8 / 10);
+
+  tree.Clear();
+  oracle.clear();
+  RecordPointer found;
+  BPT_CHECK(!finger.GetValue(k, found));
+  BPT_CHECK(finger.Remove(k) == WriteStatus::kNotFound);
+  for (int i = 0; i < kKeys; i++) {
+    int key = (i % 2 ? kKeys - i : i);
+    BPT_CHECK(finger.Insert(key, RecordPointer(key, i)));
+    oracle.emplace(key, RecordPointer(key, i));
+  }
+  checkContents(tree, oracle);
+  for (auto &entry : oracle) BPT_CHECK(finger.Remove(entry.first) == WriteStatus::kRemoved);
+  BPT_CHECK(tree.IsEmpty());
+  BPT_CHECK(tree.GetAllocatorStats().live_nodes == 0);
+  std::printf("%-8s ok\n", name);
+}
+
+// WorkStealingPool::ParallelFor has to run every index exactly once, also
+// for batches from several threads at once and for a batch a task of the
+// same pool starts, which runs inline rather than waiting on the pool
+static void runPool() {
+  for (size_t threads : {1, 2, 4}) {
+    WorkStealingPool pool(threads);
+    BPT_CHECK(pool.Threads() == threads);
+    for (size_t tasks : {0, 1, 3, 1000}) {
+      std::vector<std::atomic<int>> runs(tasks);
+      pool.ParallelFor(tasks, [&](size_t i) { runs[i]++; });
+      for (auto &count : runs) BPT_CHECK(count.load() == 1);
+    }
+    std::vector<std::atomic<int>> runs(4 * 500);
+    std::vector<std::thread> callers;
+    for (size_t c = 0; c < 4; c++) {
+      callers.emplace_back([&, c] { pool.ParallelFor(500, [&, c](size_t i) { runs[c * 500 + i]++; }); });
+    }
+    for (auto &caller : callers) caller.join();
+    for (auto &count : runs) BPT_CHECK(count.load() == 1);
+    std::vector<std::atomic<int>> nested(8 * 100);
+    pool.ParallelFor(8, [&](size_t outer) { pool.ParallelFor(100, [&](size_t i) { nested[outer * 100 + i]++; }); });
+    for (auto &count : nested) BPT_CHECK(count.load() == 1);
+  }
+  std::printf("%-8s ok\n", "pool");
+}
+
+// ParallelRangeScan and ParallelReduce against RangeScan and the map for
+// several pool sizes and partition counts, on whole, random, single-leaf,
+// empty and inverted ranges. PartitionRange has to return the range's ends
+// around strictly increasing cuts inside it.
+template <typename Tree>
+static void runParallelScan(const char *name) {
+  constexpr int kKeys = 100000;
+  std::mt19937 rng(31);
+  for (int entries : {0, 3, 50000}) {
+    Tree tree;
+    std::map<int, RecordPointer> oracle;
+    while (oracle.size() < static_cast<size_t>(entries)) {
+      int k = static_cast<int>(rng() % kKeys);
+      RecordPointer value(k, static_cast<int>(oracle.size()));
+      BPT_CHECK(tree.Insert(k, value) == oracle.emplace(k, value).second);
+    }
+    std::vector<std::pair<int, int>> ranges = {{INT_MIN, INT_MAX}, {0, 0}, {kKeys, 0}, {5, 4}};
+    if (!oracle.empty()) {
+      int first = oracle.begin()->first;
+      ranges.push_back({first, first + 1});
+      ranges.push_back({first, std::next(oracle.begin())->first});
+    }
+    for (int r = 0; r < 20; r++) {
+      int low = static_cast<int>(rng() % kKeys);
+      ranges.push_back({low, low + static_cast<int>(rng() % (kKeys / (r % 4 == 0 ? 1 : 100)))});
+    }
+    for (size_t threads : {1, 3, 8}) {
+      WorkStealingPool pool(threads);
+      for (size_t partitions : {0, 1, 2, 5, 64}) {
+        for (auto [low, high] : ranges) {
+          std::vector<int> bounds = tree.PartitionRange(low, high, partitions);
+          BPT_CHECK(bounds.size() >= 2 && bounds.front() == low && bounds.back() == high);
+          if (partitions > 0) BPT_CHECK(bounds.size() <= partitions + 1);
+          // the whole range of a large tree has separators to cut at
+          if (entries > 1000 && partitions > 1 && low == INT_MIN) BPT_CHECK(bounds.size() > 2);
+          for (size_t b = 1; b + 1 < bounds.size(); b++) BPT_CHECK(bounds[b - 1] < bounds[b] && bounds[b] < high);
+
+          std::vector<RecordPointer> expected = expectedScan(oracle, low, high, SIZE_MAX, 0, false);
+          std::vector<RecordPointer> scanned;
+          tree.RangeScan(low, high, scanned);
+          BPT_CHECK(scanned.size() == expected.size());
+          std::vector<std::vector<RecordPointer>> parts;
+          BPT_CHECK(tree.ParallelRangeScan(low, high, pool, parts, partitions) == expected.size());
+          size_t j = 0;
+          for (auto &part : parts) {
+            for (auto &value : part) {
+              BPT_CHECK(j < expected.size() && sameValue(value, expected[j]) && sameValue(value, scanned[j]));
+              j++;
+            }
+          }
+          BPT_CHECK(j == expected.size());
+
+          std::pair<size_t, int64_t> sum = tree.ParallelReduce(
+              low, high, pool, std::pair<size_t, int64_t>(0, 0),
+              [](std::pair<size_t, int64_t> &acc, const int &key, const RecordPointer &value) {
+                acc.first++;
+                acc.second += key + value.record_id;
+              },
+              [](std::pair<size_t, int64_t> &acc, const std::pair<size_t, int64_t> &partial) {
+                acc.first += partial.first;
+                acc.second += partial.second;
+              },
+              partitions);
+          int64_t expected_sum = 0;
+          for (auto it = oracle.lower_bound(low); low < high && it != oracle.end() && it->first < high; ++it) {
+            expected_sum += it->first + it->second.record_id;
+          }
+          BPT_CHECK(sum.first == expected.size() && sum.second == expected_sum);
+        }
+      }
+    }
+  }
+  std::printf("%-8s ok\n", name);
+}
+
+// ParallelBulkLoad on unsorted input with repeated keys against one Insert
+// after another: the first entry of every key in input order stays, and the
+// shape is the one BulkLoad gives the sorted, deduplicated entries. Inputs
+// run up to several sort buckets per pool thread, so the sample sort splits.
+template <typename Tree, typename MakeKey>
+static void runParallelBulkLoad(const char *name, MakeKey make_key) {
+  using Key = std::decay_t<decltype(make_key(0))>;
+  std::mt19937 rng(37);
+  for (size_t threads : {1, 4}) {
+    WorkStealingPool pool(threads);
+    for (int n : {0, 1, 7, 1000, 200000}) {
+      for (int pattern = 0; pattern < 3; pattern++) {
+        double fill_factor = pattern == 1 ? 0.6 : 1.0;
+        std::vector<std::pair<Key, RecordPointer>> entries;
+        for (int i = 0; i < n; i++) {
+          // random keys repeated about four times, a short period, descending
+          int k = pattern == 0 ? static_cast<int>(rng() % (n / 4 + 1)) : pattern == 1 ? i % 97 : n - i / 2;
+          entries.emplace_back(make_key(k), RecordPointer(k, i));
+        }
+        Tree inserted;
+        std::map<Key, RecordPointer> oracle;
+        for (auto &entry : entries) {
+          BPT_CHECK(inserted.Insert(entry.first, entry.second) == oracle.emplace(entry).second);
+        }
+        Tree tree;
+        BPT_CHECK(tree.ParallelBulkLoad(entries, pool, fill_factor) == oracle.size());
+        checkContents(tree, oracle);
+        checkContents(inserted, oracle);
+
+        Tree sorted;
+        std::vector<std::pair<Key, RecordPointer>> unique(oracle.begin(), oracle.end());
+        BPT_CHECK(sorted.BulkLoad(unique, fill_factor));
+        TreeShape shape = tree.GetShape();
+        TreeShape expected = sorted.GetShape();
+        BPT_CHECK(shape.height == expected.height && shape.leaf_nodes == expected.leaf_nodes &&
+                  shape.internal_nodes == expected.internal_nodes && shape.leaf_fill == expected.leaf_fill);
+
+        // the loaded tree takes writes like any other
+        for (int i = 0; i < 100 && !oracle.empty(); i++) {
+          int k = static_cast<int>(rng() % (n + 1));
+          BPT_CHECK((tree.Remove(make_key(k), nullptr) == WriteStatus::kRemoved) == (oracle.erase(make_key(k)) == 1));
+          BPT_CHECK(tree.Insert(make_key(n + 1 + i), RecordPointer(n + 1 + i, 0)));
+          oracle.emplace(make_key(n + 1 + i), RecordPointer(n + 1 + i, 0));
+        }
+        checkContents(tree, oracle);
+      }
+    }
+  }
+  std::printf("%-8s ok\n", name);
+}
+
+// Leaves BulkLoad cuts n sorted entries into: target entries each, except
+// that a tail below the minimum shares the entries of the leaf before it, or
+// joins it when the two together are too few to split
+static size_t bulkLoadLeaves(size_t n, size_t target, size_t minimum) {
+  size_t full = n / target, tail = n % target;
+  if (tail == 0 || full == 0) return full + (tail == 0 ? 0 : 1);
+  if (tail >= minimum) return full + 1;
+  return target + tail < 2 * minimum ? full : full + 1;
+}
+
+// BulkLoad from sorted input at several sizes and fill factors, checked
+// against the oracle and the leaf count and fill it should give, then worked
+// with removes and inserts; unsorted or duplicate input must return false
+// and leave the tree empty.
+static void runBulkLoad() {
+  using Tree = BPlusTree<int, RecordPointer, 8>;
+  constexpr int kCapacity = Tree::MAX_FANOUT - 1;
+  constexpr int kMinKeys = Tree::MAX_FANOUT / 2;
+  std::mt19937 rng(3);
+  for (double fill_factor : {0.0, 0.5, 0.7, 1.0}) {
+    int target = std::min(kCapacity, std::max(kMinKeys, static_cast<int>(fill_factor * kCapacity + 0.5)));
+    for (int n : {0, 1, kMinKeys, kCapacity, kCapacity + 1, target + 1, target + kMinKeys - 1, 2 * target - 1,
+                  2 * target, 1000, 1001, 1003, 30000}) {
+      Tree tree;
+      std::map<int, RecordPointer> oracle;
+      std::vector<std::pair<int, RecordPointer>> entries;
+      for (int i = 0; i < n; i++) {
+        entries.emplace_back(i * 3, RecordPointer(i * 3, i));
+        oracle.emplace(i * 3, RecordPointer(i * 3, i));
+      }
+      BPT_CHECK(tree.BulkLoad(entries, fill_factor));
+      checkContents(tree, oracle);
+      TreeShape shape = tree.GetShape();
+      BPT_CHECK(shape.leaf_nodes == bulkLoadLeaves(n, target, kMinKeys));
+      if (shape.leaf_nodes > 1) {
+        // no leaf below the minimum, the last two included
+        for (int b = 0; b < TreeShape::FillBucket(kMinKeys, kCapacity); b++) BPT_CHECK(shape.leaf_fill[b] == 0);
+      }
+      for (int i = 0; i < n; i++) {
+        int k = static_cast<int>(rng() % (3 * n + 3));
+        if (rng() % 2) {
+          BPT_CHECK((tree.Remove(k, nullptr) == WriteStatus::kRemoved) == (oracle.erase(k) == 1));
+        } else {
+          BPT_CHECK(tree.Insert(k, RecordPointer(k, -1)) == oracle.emplace(k, RecordPointer(k, -1)).second);
+        }
+      }
+      checkContents(tree, oracle);
+      for (auto &entry : oracle) BPT_CHECK(tree.Remove(entry.first, nullptr) == WriteStatus::kRemoved);
+      BPT_CHECK(tree.IsEmpty());
+      BPT_CHECK(tree.GetAllocatorStats().live_nodes == 0);
+    }
+  }
+
+  for (bool duplicate : {false, true}) {
+    Tree tree;
+    std::vector<std::pair<int, RecordPointer>> entries;
+    for (int i = 0; i < 5000; i++) entries.emplace_back(i, RecordPointer(i, i));
+    BPT_CHECK(tree.BulkLoad(entries));
+    // a bad entry deep enough that leaves have been cut before it
+    if (duplicate) {
+      entries[3000].first = entries[2999].first;
+    } else {
+      std::swap(entries[3000], entries[3001]);
+    }
+    BPT_CHECK(!tree.BulkLoad(entries));
+    BPT_CHECK(tree.IsEmpty() && tree.size == 0);
+    BPT_CHECK(!tree.Begin().Valid());
+    BPT_CHECK(tree.GetAllocatorStats().live_nodes == 0);
+    RecordPointer found;
+    BPT_CHECK(!tree.GetValue(0, found));
+    BPT_CHECK(tree.Insert(7, RecordPointer(7, 7)) && tree.GetValue(7, found) && found.record_id == 7);
+  }
+  std::printf("%-8s ok\n", "bulkload");
+}
+
+// A frozen snapshot against the std::map it was built from, including
+// ranges whose end is before their start
+static void runFrozen() {
+  BPlusTree<int, RecordPointer> tree;
+  std::map<int, RecordPointer> oracle;
+  std::mt19937 rng(5);
+  for (int i = 0; i < 100000; i++) {
+    int k = static_cast<int>(rng() % 400000);
+    RecordPointer value(k, i);
+    BPT_CHECK(tree.Insert(k, value) == oracle.emplace(k, value).second);
+  }
+  auto frozen = tree.Freeze();
+  BPT_CHECK(frozen.Size() == oracle.size());
+  for (int i = 0; i < 20000; i++) {
+    int k = static_cast<int>(rng() % 400000);
+    RecordPointer found;
+    auto it = oracle.find(k);
+    BPT_CHECK(frozen.GetValue(k, found) == (it != oracle.end()));
+    if (it != oracle.end()) BPT_CHECK(sameValue(found, it->second));
+
+    int end = k + static_cast<int>(rng() % 2000) - 500;
+    std::vector<RecordPointer> scanned;
+    frozen.RangeScan(k, end, scanned);
+    std::vector<RecordPointer> expected = expectedScan(oracle, k, end, SIZE_MAX, 0, false);
+    BPT_CHECK(scanned.size() == expected.size());
+    for (size_t j = 0; j < expected.size(); j++) BPT_CHECK(sameValue(scanned[j], expected[j]));
+  }
+  std::printf("%-8s ok\n", "frozen");
+}
+
+// The buffered tree against a std::map, with buffers from one message up, so
+// runs merge and partial flushes apply one key range while the rest stays
+// buffered. Lookups and scans, including empty and inverted ranges, have to
+// see every write; after Flush the tree itself has to hold the map.
+static void runBuffered() {
+  constexpr int kKeys = 5000;
+  for (size_t buffer_entries : {1, 7, 100, 3000}) {
+    BufferedBPlusTree<int, RecordPointer, 8> tree(buffer_entries);
+    std::map<int, RecordPointer> oracle;
+    std::mt19937 rng(41);
+    for (int i = 0; i < kOps / 2; i++) {
+      int k = static_cast<int>(rng() % kKeys);
+      RecordPointer value(k, i);
+      bool removing = (i / (kOps / 16)) % 2 == 1;
+      int op = static_cast<int>(rng() % 10);
+      if (op < (removing ? 2 : 4)) {
+        tree.Insert(k, value);
+        oracle.emplace(k, value);
+      } else if (op < 5) {
+        tree.InsertOrAssign(k, value);
+        oracle[k] = value;
+      } else if (op < 7) {
+        tree.Remove(k);
+        oracle.erase(k);
+      } else if (op < 9) {
+        RecordPointer found;
+        auto it = oracle.find(k);
+        BPT_CHECK(tree.GetValue(k, found) == (it != oracle.end()));
+        if (it != oracle.end()) BPT_CHECK(sameValue(found, it->second));
+      } else {
+        // a quarter of the scans have an empty or inverted range
+        int high = rng() % 4 ? k + static_cast<int>(rng() % 200) : k - static_cast<int>(rng() % 50);
+        std::vector<RecordPointer> scanned;
+        tree.RangeScan(k, high, scanned);
+        std::vector<RecordPointer> expected = expectedScan(oracle, k, high, SIZE_MAX, 0, false);
+        BPT_CHECK(scanned.size() == expected.size());
+        for (size_t j = 0; j < expected.size(); j++) BPT_CHECK(sameValue(scanned[j], expected[j]));
+      }
+      BPT_CHECK(tree.BufferedMessages() <= buffer_entries);
+    }
+    BPT_CHECK(tree.Flushes() > 0);
+    std::vector<RecordPointer> scanned;
+    tree.RangeScan(INT_MIN, INT_MAX, scanned);
+    BPT_CHECK(scanned.size() == oracle.size());
+    tree.Flush();
+    BPT_CHECK(tree.BufferedMessages() == 0);
+    checkContents(tree.Tree(), oracle);
+  }
+  std::printf("%-8s ok\n", "buffered");
+}
+
+static size_t fileBytes(const std::string &path) {
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+// The disk tree against a std::map under a sliding window of keys. Once the
+// window has moved past its first position the pages of the keys it leaves
+// behind are reused, so the file stays near its size at that point instead of
+// growing by a window's worth of pages per round; a reopened file must hold
+// the same entries.
+static void runDisk() {
+  char dir[] = "/tmp/bpt_differential_XXXXXX";
+  BPT_CHECK(::mkdtemp(dir) != nullptr);
+  std::string path = std::string(dir) + "/index.db";
+  std::map<int, RecordPointer> oracle;
+  std::mt19937 rng(7);
+  constexpr int kWindow = 20000;
+  auto check = [&](DiskBPlusTree<int, RecordPointer> &tree) {
+    BPT_CHECK(tree.Size() == oracle.size());
+    std::vector<RecordPointer> scanned;
+    tree.RangeScan(INT_MIN, INT_MAX, scanned);
+    BPT_CHECK(scanned.size() == oracle.size());
+    size_t j = 0;
+    for (auto &entry : oracle) {
+      BPT_CHECK(sameValue(scanned[j++], entry.second));
+      RecordPointer found;
+      BPT_CHECK(tree.GetValue(entry.first, found) && sameValue(found, entry.second));
+    }
+  };
+  {
+    DiskBPlusTree<int, RecordPointer> tree(path, 64);
+    BPT_CHECK(tree.IsOpen());
+    size_t settled_bytes = 0;
+    for (int round = 0; round < 12; round++) {
+      int base = round * kWindow;
+      for (int i = 0; i < kWindow; i++) {
+        int k = base + static_cast<int>(rng() % kWindow);
+        RecordPointer value(k, i);
+        BPT_CHECK(tree.Insert(k, value) == oracle.emplace(k, value).second);
+      }
+      for (auto it = oracle.begin(); it != oracle.end() && it->first < base;) {
+        BPT_CHECK(tree.Remove(it->first));
+        it = oracle.erase(it);
+      }
+      BPT_CHECK(!tree.Remove(base - 1));
+      BPT_CHECK(tree.Flush());
+      if (round == 1) settled_bytes = fileBytes(path);
+      if (round > 1) BPT_CHECK(fileBytes(path) <= settled_bytes * 5 / 4);
+      check(tree);
+    }
+    for (auto &entry : oracle) BPT_CHECK(tree.Remove(entry.first));
+    oracle.clear();
+    check(tree);
+    for (int i = 0; i < kWindow; i++) {
+      int k = static_cast<int>(rng() % (4 * kWindow));
+      RecordPointer value(k, i);
+      BPT_CHECK(tree.Insert(k, value) == oracle.emplace(k, value).second);
+    }
+    BPT_CHECK(tree.Flush());
+    BPT_CHECK(fileBytes(path) <= settled_bytes * 5 / 4);
+  }
+  DiskBPlusTree<int, RecordPointer> reopened(path, 64);
+  BPT_CHECK(reopened.IsOpen());
+  check(reopened);
+  std::remove(path.c_str());
+  ::rmdir(dir);
+  std::printf("%-8s ok\n", "disk");
+}
+
+int main() {
+  auto int_key = [](int k) { return k; };
+  {
+    BPlusTree<int, RecordPointer> tree;
+    runDifferential("plain", tree, int_key, 50000, false, false);
+  }
+  {
+    // a small fanout splits, borrows and merges on almost every write
+    BPlusTree<int, RecordPointer, 4> tree;
+    runDifferential("plain-4", tree, int_key, 5000, false, false);
+  }
+  {
+    PackedBPlusTree<int64_t, 32> tree;
+    runDifferential("packed", tree, [](int k) { return static_cast<int64_t>(k) * 1000003; }, 50000, false, false);
+  }
+  {
+    StringBPlusTree<RecordPointer, 16> tree;
+    runDifferential("string", tree, stringKey, 20000, false, false);
+  }
+  {
+    BPlusTree<int, RecordPointer, 8> tree;
+    runDifferential("compact", tree, int_key, 20000, true, false);
+  }
+  {
+    BPlusTree<int, RecordPointer, 8> tree;
+    runDifferential("lazy", tree, int_key, 20000, true, true);
+  }
+  {
+    // nodes of 64 to 127 keys, above the size where interpolation takes over
+    using InterpolatedTree = BPlusTree<int64_t, RecordPointer, 128, InterpolatingLess<int64_t>>;
+    InterpolatedTree uniform;
+    runDifferential("interp-uniform", uniform, [](int k) { return static_cast<int64_t>(k) * 7919; }, 50000, false,
+                    false);
+    // four dense clusters far apart
+    InterpolatedTree clustered;
+    runDifferential("interp-clustered", clustered,
+                    [](int k) { return static_cast<int64_t>(k % 4) * 1000000000000LL + k; }, 50000, false, false);
+    InterpolatedTree cubic;
+    runDifferential("interp-cubic", cubic, [](int k) { return static_cast<int64_t>(k) * k * k; }, 50000, false, false);
+  }
+  runAppend<BPlusTree<int, RecordPointer>>("append");
+  runAppend<BPlusTree<int, RecordPointer, 8>>("append-8");
+  runFinger<BPlusTree<int, RecordPointer>>("finger");
+  runFinger<BPlusTree<int, RecordPointer, 4>>("finger-4");
+  runPool();
+  runParallelScan<BPlusTree<int, RecordPointer>>("parallel");
+  runParallelScan<BPlusTree<int, RecordPointer, 4>>("parallel-4");
+  {
+    BPlusTree<int, RecordPointer> tree;
+    runMultiGet("multiget", tree, int_key, 50000);
+  }
+  {
+    BPlusTree<int, RecordPointer, 4> tree;
+    runMultiGet("multiget-4", tree, int_key, 5000);
+  }
+  {
+    StringBPlusTree<RecordPointer, 16> tree;
+    runMultiGet("multiget-string", tree, stringKey, 20000);
+  }
+  {
+    // nothing to look up, so every result stays untouched
+    BPlusTree<int, RecordPointer> empty;
+    auto frozen = empty.Freeze();
+    std::vector<int> keys(40, 1);
+    std::vector<RecordPointer> results(keys.size(), RecordPointer(-1, -1));
+    std::vector<bool> found;
+    BPT_CHECK(frozen.MultiGet(std::span<const int>(keys), std::span<RecordPointer>(results), found) == 0);
+    for (size_t i = 0; i < keys.size(); i++) BPT_CHECK(!found[i] && results[i].page_id == -1);
+  }
+  runBulkLoad();
+  runParallelBulkLoad<BPlusTree<int, RecordPointer>>("parallel-bulkload", int_key);
+  runParallelBulkLoad<BPlusTree<int, RecordPointer, 4>>("parallel-bulkload-4", int_key);
+  runParallelBulkLoad<StringBPlusTree<RecordPointer, 16>>("parallel-bulkload-string", stringKey);
+  runFrozen();
+  runBuffered();
+  runDisk();
+  return 0;
+}
@@ -0,0 +1,140 @@
+// The intra-node search kernels against std::lower_bound/upper_bound. Every
+// counting kernel is called directly at window lengths 0 to 64, the SIMD ones
+// only where the CPU has them, on distinct keys, on long runs of a few keys
+// and on the key type's minimum and maximum; NodeLowerBound and
+// NodeUpperBound are checked on the same arrays and on whole nodes, and so
+// is the interpolating search InterpolatingLess selects.
+#include "include/node_search.h"
+#include "tests/test_util.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+using node_search_detail::countScalar;
+
+// Sorted keys: spread over the whole type, duplicate-heavy, or only the
+// minimum, zero and the maximum
+template <typename K>
+static std::vector<K> sortedKeys(int len, int pattern, std::mt19937_64 &rng) {
+  std::vector<K> keys;
+  for (int i = 0; i < len; i++) {
+    uint64_t x = rng();
+    if (pattern == 0) {
+      keys.push_back(static_cast<K>(x));
+    } else if (pattern == 1) {
+      keys.push_back(static_cast<K>(x % 4));
+    } else {
+      keys.push_back(x % 3 == 0 ? std::numeric_limits<K>::min() : x % 3 == 1 ? K(0) : std::numeric_limits<K>::max());
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+// Each kernel must count the keys below key (lower) and not above it (upper)
+template <typename K>
+static void checkCounts(const std::vector<K> &keys, K key) {
+  const int len = static_cast<int>(keys.size());
+  const int lower = static_cast<int>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+  const int upper = static_cast<int>(std::upper_bound(keys.begin(), keys.end(), key) - keys.begin());
+  std::less<K> comp;
+  BPT_CHECK(countScalar<false>(keys.data(), len, key, comp) == lower);
+  BPT_CHECK(countScalar<true>(keys.data(), len, key, comp) == upper);
+#if defined(BPT_X86_SIMD)
+  if constexpr (std::is_signed_v<K> && (sizeof(K) == 4 || sizeof(K) == 8)) {
+    if (__builtin_cpu_supports("avx2")) {
+      BPT_CHECK(node_search_detail::countAvx2<false>(keys.data(), len, key) == lower);
+      BPT_CHECK(node_search_detail::countAvx2<true>(keys.data(), len, key) == upper);
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+      BPT_CHECK(node_search_detail::countSse42<false>(keys.data(), len, key) == lower);
+      BPT_CHECK(node_search_detail::countSse42<true>(keys.data(), len, key) == upper);
+    }
+  } else if constexpr (std::is_unsigned_v<K>) {
+    if (__builtin_cpu_supports("avx2")) {
+      BPT_CHECK(node_search_detail::countAvx2Unsigned<false>(keys.data(), len, key) == lower);
+      BPT_CHECK(node_search_detail::countAvx2Unsigned<true>(keys.data(), len, key) == upper);
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+      BPT_CHECK(node_search_detail::countSse42Unsigned<false>(keys.data(), len, key) == lower);
+      BPT_CHECK(node_search_detail::countSse42Unsigned<true>(keys.data(), len, key) == upper);
+    }
+  }
+#endif
+  BPT_CHECK(NodeLowerBound(keys.data(), len, key) == lower);
+  BPT_CHECK(NodeUpperBound(keys.data(), len, key) == upper);
+}
+
+// Probes every key in the array and its neighbours, the type's limits and
+// random keys
+template <typename K>
+static void checkProbes(const std::vector<K> &keys, std::mt19937_64 &rng) {
+  using Limits = std::numeric_limits<K>;
+  for (K key : keys) {
+    checkCounts(keys, key);
+    if (key != Limits::min()) checkCounts(keys, static_cast<K>(key - 1));
+    if (key != Limits::max()) checkCounts(keys, static_cast<K>(key + 1));
+  }
+  for (K key : {Limits::min(), K(0), Limits::max(), static_cast<K>(rng()), static_cast<K>(rng() % 4)}) {
+    checkCounts(keys, key);
+  }
+}
+
+template <typename K>
+static void runKernels(const char *name) {
+  std::mt19937_64 rng(sizeof(K));
+  for (int pattern = 0; pattern < 3; pattern++) {
+    for (int len = 0; len <= 64; len++) checkProbes(sortedKeys<K>(len, pattern, rng), rng);
+    // whole nodes, where the binary search narrows the window first
+    for (int len : {100, 255, 1000}) checkProbes(sortedKeys<K>(len, pattern, rng), rng);
+  }
+  std::printf("%-8s ok\n", name);
+}
+
+// The interpolating node search against std::lower_bound/upper_bound on
+// sorted arrays on both sides of the size where it takes over, for uniform,
+// clustered and cubic keys, so the prediction lands close, gallops and falls
+// back to the normal search
+static void runInterpolationSearch() {
+  std::mt19937_64 rng(13);
+  InterpolatingLess<int64_t> comp;
+  for (int n = 0; n < 300; n += 1 + n / 16) {
+    for (int shape = 0; shape < 3; shape++) {
+      std::vector<int64_t> keys;
+      for (int i = 0; i < n; i++) {
+        int64_t x = static_cast<int64_t>(rng() % 1000000);
+        keys.push_back(shape == 0 ? x : shape == 1 ? (x % 4) * 1000000000000LL + x : x * x * x);
+      }
+      std::sort(keys.begin(), keys.end());
+      keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+      int len = static_cast<int>(keys.size());
+      for (int probe = 0; probe < 200; probe++) {
+        int64_t key = len > 0 && probe % 2 ? keys[rng() % len] + static_cast<int64_t>(rng() % 3) - 1
+                                           : static_cast<int64_t>(rng());
+        auto lower = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+        auto upper = std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+        BPT_CHECK(NodeLowerBound(keys.data(), len, key, comp) == lower);
+        BPT_CHECK(NodeUpperBound(keys.data(), len, key, comp) == upper);
+      }
+    }
+  }
+  std::printf("%-8s ok\n", "interp");
+}
+
+int main() {
+  __builtin_cpu_init();
+  runKernels<int32_t>("int32");
+  runKernels<int64_t>("int64");
+  runKernels<uint8_t>("uint8");
+  runKernels<uint16_t>("uint16");
+  runKernels<uint32_t>("uint32");
+  runKernels<uint64_t>("uint64");
+  runInterpolationSearch();
+  return 0;
+}
@@ -0,0 +1,154 @@
+// Crash recovery of DurableBPlusTree. A child process recovers the tree and
+// writes to it from several threads, reporting each write through a pipe
+// before it starts and again once Insert or Remove has returned; the parent
+// kills it with SIGKILL at a random point, recovers the files itself and
+// checks that every acknowledged write survived. A key whose last write was
+// started but not acknowledged may hold either state. Each round continues
+// from the files the previous one left, and the first round also checkpoints
+// so recovery has to combine a checkpoint with the log after it.
+#include "include/durable_b_plus_tree.h"
+#include "tests/test_util.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Tree = DurableBPlusTree<int, RecordPointer>;
+
+constexpr int kRounds = 4;
+constexpr int kWriters = 4;
+constexpr int kKeysPerWriter = 2000;
+constexpr int kKeys = kKeysPerWriter * kWriters;
+
+enum class Event : int32_t { kStarted, kInserted, kRemoved };
+
+// One pipe message; smaller than PIPE_BUF, so writes from the threads never
+// interleave
+struct Message {
+  Event event;
+  int32_t key;
+  int32_t value;
+};
+
+// What the parent knows about a key
+struct KeyState {
+  bool present = false;
+  int32_t value = 0;
+  // a write was started after the last acknowledged one
+  bool pending = false;
+};
+
+static void report(int fd, Event event, int key, int value) {
+  Message message{event, key, value};
+  if (::write(fd, &message, sizeof(message)) != sizeof(message)) _exit(2);
+}
+
+[[noreturn]] static void runChild(const std::string &path, int fd, int round) {
+  Tree tree(path);
+  if (!tree.Recover()) _exit(3);
+  if (round == 0) {
+    // half the writes before a checkpoint, so it has something to snapshot
+    for (int k = 0; k < kKeys; k += 2) {
+      report(fd, Event::kStarted, k, -1);
+      if (!tree.Insert(k, RecordPointer(k, -1))) _exit(4);
+      report(fd, Event::kInserted, k, -1);
+    }
+    if (!tree.Checkpoint()) _exit(5);
+  }
+  tree.Tree().SetThreadSafe(true);
+  std::vector<std::thread> writers;
+  for (int w = 0; w < kWriters; w++) {
+    writers.emplace_back([&, w] {
+      std::mt19937 rng(round * kWriters + w);
+      for (int i = 0;; i++) {
+        int k = static_cast<int>(rng() % kKeysPerWriter) * kWriters + w;
+        report(fd, Event::kStarted, k, i);
+        if (tree.Insert(k, RecordPointer(k, i))) {
+          report(fd, Event::kInserted, k, i);
+        } else if (tree.Remove(k)) {
+          report(fd, Event::kRemoved, k, i);
+        } else {
+          _exit(6);
+        }
+      }
+    });
+  }
+  for (auto &writer : writers) writer.join();
+  _exit(0);
+}
+
+int main() {
+  char dir[] = "/tmp/bpt_recovery_XXXXXX";
+  BPT_CHECK(::mkdtemp(dir) != nullptr);
+  std::string path = std::string(dir) + "/tree";
+  std::vector<KeyState> keys(kKeys);
+  std::mt19937 rng(11);
+
+  for (int round = 0; round < kRounds; round++) {
+    int fds[2];
+    BPT_CHECK(::pipe(fds) == 0);
+    pid_t pid = ::fork();
+    BPT_CHECK(pid >= 0);
+    if (pid == 0) {
+      ::close(fds[0]);
+      runChild(path, fds[1], round);
+    }
+    ::close(fds[1]);
+
+    // kill the child somewhere after the first few thousand writes
+    size_t kill_after = 5000 + rng() % 20000;
+    size_t acknowledged = 0;
+    bool killed = false;
+    Message message;
+    while (::read(fds[0], &message, sizeof(message)) == sizeof(message)) {
+      KeyState &state = keys[message.key];
+      if (message.event == Event::kStarted) {
+        state.pending = true;
+        continue;
+      }
+      state.present = message.event == Event::kInserted;
+      state.value = message.value;
+      state.pending = false;
+      if (++acknowledged == kill_after && !killed) {
+        ::kill(pid, SIGKILL);
+        killed = true;
+      }
+    }
+    ::close(fds[0]);
+    int status = 0;
+    BPT_CHECK(::waitpid(pid, &status, 0) == pid);
+    BPT_CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+
+    Tree tree(path);
+    BPT_CHECK(tree.Recover());
+    size_t pending = 0;
+    for (int k = 0; k < kKeys; k++) {
+      KeyState &state = keys[k];
+      RecordPointer found;
+      bool present = tree.GetValue(k, found);
+      if (state.pending) {
+        // either outcome is allowed; the next round starts from this one
+        pending++;
+        state.present = present;
+        state.value = found.record_id;
+        state.pending = false;
+        continue;
+      }
+      BPT_CHECK(present == state.present);
+      if (present) BPT_CHECK(found.page_id == k && found.record_id == state.value);
+    }
+    std::printf("round %d: %zu writes acknowledged, %zu in flight\n", round, acknowledged, pending);
+  }
+  std::remove((path + ".ckpt").c_str());
+  std::remove((path + ".wal").c_str());
+  ::rmdir(dir);
+  return 0;
+}
@@ -0,0 +1,213 @@
+// Statistics against the trees they describe. Every node is the first leaf
+// or was made by a split, and leaves only through a merge or a root collapse,
+// so while a tree is not empty the counters give its node count:
+//   leaves   = 1 + leaf_splits - leaf_merges
+//   internal = internal_splits + root_splits - internal_merges - root_collapses
+// and they have to agree with GetShape(), also when compaction repacks
+// leaves and when lazy deletes put rebalancing off. CMake builds this file as configured and again as stats_test_enabled with
+// BPT_STATS=1; with statistics compiled out the snapshot has to say so and
+// stay zero. ToJson() has to be valid JSON either way.
+#include "include/b_plus_tree.h"
+#include "tests/test_util.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Minimal JSON syntax check: one value and nothing after it
+class JsonChecker {
+ public:
+  explicit JsonChecker(const std::string &text) : text_(text) {}
+
+  bool Valid() {
+    pos_ = 0;
+    return value() && (skipSpace(), pos_ == text_.size());
+  }
+
+ private:
+  void skipSpace() {
+    while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) pos_++;
+  }
+
+  bool consume(char c) {
+    skipSpace();
+    if (pos_ < text_.size() && text_[pos_] == c) {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool literal(const char *word) {
+    std::string w(word);
+    if (text_.compare(pos_, w.size(), w) != 0) return false;
+    pos_ += w.size();
+    return true;
+  }
+
+  bool string() {
+    if (!consume('"')) return false;
+    while (pos_ < text_.size() && text_[pos_] != '"') {
+      if (static_cast<unsigned char>(text_[pos_]) < 0x20) return false;
+      pos_ += text_[pos_] == '\\' ? 2 : 1;
+    }
+    return consume('"');
+  }
+
+  bool number() {
+    size_t start = pos_;
+    if (pos_ < text_.size() && text_[pos_] == '-') pos_++;
+    size_t digits = pos_;
+    while (pos_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_]))) pos_++;
+    if (pos_ == digits) return false;
+    if (pos_ < text_.size() && text_[pos_] == '.') {
+      size_t fraction = ++pos_;
+      while (pos_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_]))) pos_++;
+      if (pos_ == fraction) return false;
+    }
+    if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+      pos_++;
+      if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) pos_++;
+      size_t exponent = pos_;
+      while (pos_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_]))) pos_++;
+      if (pos_ == exponent) return false;
+    }
+    return pos_ > start;
+  }
+
+  bool value() {
+    skipSpace();
+    if (pos_ >= text_.size()) return false;
+    char c = text_[pos_];
+    if (c == '{') {
+      pos_++;
+      if (consume('}')) return true;
+      do {
+        if (!string() || !consume(':') || !value()) return false;
+      } while (consume(','));
+      return consume('}');
+    }
+    if (c == '[') {
+      pos_++;
+      if (consume(']')) return true;
+      do {
+        if (!value()) return false;
+      } while (consume(','));
+      return consume(']');
+    }
+    if (c == '"') return string();
+    if (c == 't') return literal("true");
+    if (c == 'f') return literal("false");
+    if (c == 'n') return literal("null");
+    return number();
+  }
+
+  const std::string &text_;
+  size_t pos_ = 0;
+};
+
+// Leaves and internal nodes the counters say a non-empty tree has
+static size_t countedLeaves(const TreeStatsSnapshot &stats) {
+  return static_cast<size_t>(1 + stats.Counter(TreeCounter::kLeafSplits) - stats.Counter(TreeCounter::kLeafMerges));
+}
+
+static size_t countedInternal(const TreeStatsSnapshot &stats) {
+  return static_cast<size_t>(stats.Counter(TreeCounter::kInternalSplits) + stats.Counter(TreeCounter::kRootSplits) -
+                             stats.Counter(TreeCounter::kInternalMerges) - stats.Counter(TreeCounter::kRootCollapses));
+}
+
+// Phases of inserts and removes so nodes split and merge at every level,
+// checking the counters against the tree's shape throughout
+template <typename Tree, typename MakeKey>
+static void runStats(const char *name, Tree &tree, MakeKey make_key, int key_range, bool compact, bool lazy) {
+  using Key = decltype(make_key(0));
+  std::map<Key, RecordPointer> oracle;
+  std::mt19937 rng(11);
+  if (lazy) tree.SetLazyDeletes(true);
+  for (int i = 0; i < 100000; i++) {
+    int k = static_cast<int>(rng() % key_range);
+    bool removing = (i / 12500) % 2 == 1;
+    int op = static_cast<int>(rng() % 10);
+    if (op < (removing ? 3 : 6)) {
+      RecordPointer value(k, i);
+      BPT_CHECK(tree.Insert(make_key(k), value) == oracle.emplace(make_key(k), value).second);
+    } else if (op < 9) {
+      BPT_CHECK((tree.Remove(make_key(k), nullptr) == WriteStatus::kRemoved) == (oracle.erase(make_key(k)) == 1));
+    } else {
+      RecordPointer found;
+      BPT_CHECK(tree.GetValue(make_key(k), found) == (oracle.count(make_key(k)) == 1));
+      std::vector<RecordPointer> scanned;
+      tree.RangeScan(make_key(k), make_key(k + 100), scanned);
+    }
+    if (compact && i % 1000 == 499) tree.Compact(16);
+    if (i % 1000 == 999 && BPT_STATS && !tree.IsEmpty()) {
+      TreeStatsSnapshot stats = tree.GetStats();
+      TreeShape shape = tree.GetShape();
+      BPT_CHECK(countedLeaves(stats) == shape.leaf_nodes);
+      BPT_CHECK(countedInternal(stats) == shape.internal_nodes);
+      BPT_CHECK(shape.leaf_nodes + shape.internal_nodes == tree.GetAllocatorStats().live_nodes);
+    }
+  }
+
+  TreeStatsSnapshot stats = tree.GetStats();
+  BPT_CHECK(stats.enabled == (BPT_STATS != 0));
+  for (TreeOp op : {TreeOp::kGetValue, TreeOp::kInsert, TreeOp::kRemove, TreeOp::kRangeScan}) {
+    const LatencyHistogram &latency = stats.Latency(op);
+    uint64_t bucketed = 0;
+    for (uint64_t count : latency.buckets) bucketed += count;
+    BPT_CHECK(bucketed == latency.count);
+    if (BPT_STATS) {
+      BPT_CHECK(latency.count > 0 && latency.PercentileNs(0.99) >= latency.PercentileNs(0.5));
+    } else {
+      BPT_CHECK(latency.count == 0);
+    }
+  }
+  for (int c = 0; c < kTreeCounters; c++) {
+    if (!BPT_STATS) BPT_CHECK(stats.counters[c] == 0);
+  }
+  if (BPT_STATS) {
+    BPT_CHECK(stats.Counter(TreeCounter::kLeafSplits) > 0 && stats.Counter(TreeCounter::kLeafMerges) > 0);
+    BPT_CHECK(stats.Counter(TreeCounter::kDescents) > 0);
+  }
+  BPT_CHECK(JsonChecker(stats.ToJson()).Valid());
+
+  for (auto &entry : oracle) BPT_CHECK(tree.Remove(entry.first, nullptr) == WriteStatus::kRemoved);
+  BPT_CHECK(tree.GetAllocatorStats().live_nodes == 0);
+  tree.ResetStats();
+  stats = tree.GetStats();
+  BPT_CHECK(stats.Latency(TreeOp::kInsert).count == 0 && stats.Counter(TreeCounter::kLeafSplits) == 0);
+  BPT_CHECK(JsonChecker(stats.ToJson()).Valid());
+  std::printf("%-8s ok\n", name);
+}
+
+int main() {
+  BPT_CHECK(JsonChecker("{\"a\": [1, -2.5e+3, true, null], \"b\": {}}").Valid());
+  BPT_CHECK(!JsonChecker("{\"a\": nan}").Valid());
+  BPT_CHECK(!JsonChecker("{\"a\": 1,}").Valid());
+  auto int_key = [](int k) { return k; };
+  {
+    BPlusTree<int, RecordPointer> tree;
+    runStats("plain", tree, int_key, 50000, false, false);
+  }
+  {
+    BPlusTree<int, RecordPointer, 4> tree;
+    runStats("plain-4", tree, int_key, 5000, false, false);
+  }
+  {
+    PackedBPlusTree<int64_t, 32> tree;
+    runStats("packed", tree, [](int k) { return static_cast<int64_t>(k) * 1000003; }, 50000, false, false);
+  }
+  {
+    BPlusTree<int, RecordPointer, 8> tree;
+    runStats("compact", tree, int_key, 20000, true, false);
+  }
+  {
+    BPlusTree<int, RecordPointer, 8> tree;
+    runStats("lazy", tree, int_key, 20000, true, true);
+  }
+  return 0;
+}
@@ -0,0 +1,15 @@
+// Shared by the programs in tests/: each one is a plain executable that
+// returns non-zero on the first failed check, so ctest needs no framework.
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Checks hold in release builds too, unlike assert
+#define BPT_CHECK(condition)                                                          \
+  do {                                                                                \
+    if (!(condition)) {                                                               \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      std::exit(1);                                                                   \
+    }                                                                                 \
+  } while (0)